@@ -9,6 +9,17 @@ const REQUEST_TIMEOUT_MS: Record<RequestType, number> = {
   test: 45000,
 };
 
+// Minimax streams `progress` messages while it searches. They come before the
+// response to the request, so they neither answer nor end it.
+export const isInterimResponse = (rawData: unknown) => {
+  if (typeof rawData !== "string" || !rawData.includes('"progress"')) return false;
+  try {
+    return JSON.parse(rawData).type === "progress";
+  } catch {
+    return false;
+  }
+};
+
 type UseWebSocketReliabilityParams = {
   status: Ref<string>;
   open: () => void;
@@ -37,7 +37,7 @@ export type GameResult = {
   winner?: Stone;
 };
 export type RequestType = "move" | "evaluate" | "test";
-export type ResponseType = "move" | "evaluate" | "error";
+export type ResponseType = "move" | "evaluate" | "error" | "progress" | "cancelled";
 export type SocketMoveRequest = {
   type: RequestType;
   difficulty?: "easy" | "medium" | "hard"; // minimax only
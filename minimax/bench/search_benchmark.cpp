@@ -1,5 +1,3 @@
-#include <sys/time.h>
-
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
@@ -36,16 +34,34 @@ struct Variant {
 struct Options {
   int iterations;
   int warmup;
+  int threads;
+  int ttMegabytes;
+  int evalCacheMegabytes;
+  int candidateRadius;
+  unsigned long long nodeLimit;
+  SearchTuning tuning;
   bool clearTTEachRun;
+  bool evalThroughput;
+  bool threadScaling;
+  bool batchSimd;
   bool quietEngineLogs;
   bool listOnly;
+  std::string ttSnapshot;
   std::vector<std::string> scenarioKeys;
   std::vector<std::string> variantKeys;
 
   Options()
       : iterations(1),
         warmup(0),
+        threads(1),
+        ttMegabytes(TT_DEFAULT_MB),
+        evalCacheMegabytes(EVAL_CACHE_DEFAULT_MB),
+        candidateRadius(DEFAULT_CANDIDATE_RADIUS),
+        nodeLimit(0),
         clearTTEachRun(true),
+        evalThroughput(false),
+        threadScaling(false),
+        batchSimd(true),
         quietEngineLogs(true),
         listOnly(false) {}
 };
@@ -57,9 +73,18 @@ struct Summary {
   double p95Ms;
   double maxMs;
   std::pair<int, int> lastMove;
+  unsigned long long avgNodes;
+  double evalHitRate;  // percent of evaluator calls answered by the eval cache
 
   Summary()
-      : minMs(0.0), avgMs(0.0), p50Ms(0.0), p95Ms(0.0), maxMs(0.0), lastMove(-1, -1) {}
+      : minMs(0.0),
+        avgMs(0.0),
+        p50Ms(0.0),
+        p95Ms(0.0),
+        maxMs(0.0),
+        lastMove(-1, -1),
+        avgNodes(0),
+        evalHitRate(0.0) {}
 };
 
 class ScopedCoutSilencer {
@@ -78,11 +103,7 @@ class ScopedCoutSilencer {
   std::ostringstream nullStream_;
 };
 
-double nowMs() {
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  return tv.tv_sec * 1000.0 + static_cast<double>(tv.tv_usec) / 1000.0;
-}
+double nowMs() { return TimeManager::nowMs(); }
 
 bool parseInt(const std::string& text, int minValue, int& outValue) {
   char* end = NULL;
@@ -95,6 +116,15 @@ bool parseInt(const std::string& text, int minValue, int& outValue) {
   return true;
 }
 
+bool parseNodeCount(const std::string& text, unsigned long long& outValue) {
+  char* end = NULL;
+  const unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+  if (text.empty() || text[0] == '-' || end == text.c_str() || *end != '\0' || value == 0)
+    return false;
+  outValue = value;
+  return true;
+}
+
 std::string trim(const std::string& s) {
   std::string::size_type start = 0;
   while (start < s.size() && (s[start] == ' ' || s[start] == '\t')) start++;
@@ -135,7 +165,27 @@ void printUsage(const char* prog) {
             << "  --warmup N             Warmup runs per variant/scenario (default: 0)\n"
             << "  --scenario a,b,c       Scenario keys, or 'all' (default: all)\n"
             << "  --variant a,b,c        Variant keys, or 'all' (default: easy,medium,hard)\n"
+            << "  --threads N            Lazy-SMP search threads (default: 1)\n"
+            << "  --tt-mb N              Transposition table size in MB (default: 64)\n"
+            << "  --eval-cache-mb N      Evaluation cache size in MB, 0 = off (default: 16)\n"
+            << "  --candidate-radius N   Candidate moves within N of a stone, 1 or 2 (default: 1)\n"
+            << "  --node-limit N         Stop each search after N main-thread nodes instead of\n"
+            << "                         the medium/hard time limits (reproducible runs)\n"
+            << "  --no-quiescence        Disable the threat quiescence search at depth 0\n"
+            << "  --null-move            Enable null-move pruning in PVS\n"
+            << "  --null-move-r N        Null-move depth reduction, even (default: 2)\n"
+            << "  --lmr                  Enable late-move reductions in PVS\n"
+            << "  --lmr-r N              Late-move reduction in plies, even (default: 2)\n"
+            << "  --lmr-depth N          Reduce only with at least N plies left (default: 4)\n"
+            << "  --lmr-moves N          Never reduce the first N moves of a node (default: 4)\n"
+            << "  --symmetric-hashing    Share TT and threat-cache entries across board symmetries\n"
             << "  --no-tt-clear          Keep TT across runs (default: clear every run)\n"
+            << "  --tt-snapshot FILE     Start from the TT snapshot in FILE (implies --no-tt-clear);\n"
+            << "                         if FILE does not load, save the TT to it at the end\n"
+            << "  --eval-throughput      Also report evaluation calls/sec per scenario\n"
+            << "  --thread-scaling       Also report time and nodes to each depth with 1 thread\n"
+            << "                         and with --threads N (needs N > 1)\n"
+            << "  --no-simd              Score move batches without AVX2\n"
             << "  --verbose-engine       Show search logs printed by engine\n"
             << "  --list                 Print available scenarios/variants\n"
             << "  --help                 Show this help\n";
@@ -152,7 +202,11 @@ bool parseArgs(int argc, char** argv, Options& opts) {
       opts.listOnly = true;
       continue;
     }
-    if (arg == "--iterations" || arg == "--warmup" || arg == "--scenario" || arg == "--variant") {
+    if (arg == "--iterations" || arg == "--warmup" || arg == "--threads" || arg == "--tt-mb" ||
+        arg == "--eval-cache-mb" || arg == "--candidate-radius" || arg == "--node-limit" ||
+        arg == "--null-move-r" || arg == "--lmr-r" || arg == "--lmr-depth" ||
+        arg == "--lmr-moves" || arg == "--scenario" || arg == "--variant" ||
+        arg == "--tt-snapshot") {
       if (i + 1 >= argc) {
         std::cerr << "Missing value for " << arg << "\n";
         return false;
@@ -168,10 +222,59 @@ bool parseArgs(int argc, char** argv, Options& opts) {
           std::cerr << "Invalid --warmup value: " << value << "\n";
           return false;
         }
+      } else if (arg == "--threads") {
+        if (!parseInt(value, 1, opts.threads) || opts.threads > MAX_SEARCH_THREADS) {
+          std::cerr << "Invalid --threads value: " << value << "\n";
+          return false;
+        }
+      } else if (arg == "--tt-mb") {
+        if (!parseInt(value, 1, opts.ttMegabytes)) {
+          std::cerr << "Invalid --tt-mb value: " << value << "\n";
+          return false;
+        }
+      } else if (arg == "--eval-cache-mb") {
+        if (!parseInt(value, 0, opts.evalCacheMegabytes)) {
+          std::cerr << "Invalid --eval-cache-mb value: " << value << "\n";
+          return false;
+        }
+      } else if (arg == "--candidate-radius") {
+        if (!parseInt(value, 1, opts.candidateRadius) ||
+            opts.candidateRadius > MAX_CANDIDATE_RADIUS) {
+          std::cerr << "Invalid --candidate-radius value: " << value << "\n";
+          return false;
+        }
+      } else if (arg == "--node-limit") {
+        if (!parseNodeCount(value, opts.nodeLimit)) {
+          std::cerr << "Invalid --node-limit value: " << value << "\n";
+          return false;
+        }
+      } else if (arg == "--null-move-r") {
+        if (!parseInt(value, 2, opts.tuning.nullMoveReduction) ||
+            opts.tuning.nullMoveReduction % 2 != 0) {
+          std::cerr << "Invalid --null-move-r value (even, >= 2): " << value << "\n";
+          return false;
+        }
+      } else if (arg == "--lmr-r") {
+        if (!parseInt(value, 2, opts.tuning.lmrReduction) || opts.tuning.lmrReduction % 2 != 0) {
+          std::cerr << "Invalid --lmr-r value (even, >= 2): " << value << "\n";
+          return false;
+        }
+      } else if (arg == "--lmr-depth") {
+        if (!parseInt(value, 1, opts.tuning.lmrMinDepth)) {
+          std::cerr << "Invalid --lmr-depth value: " << value << "\n";
+          return false;
+        }
+      } else if (arg == "--lmr-moves") {
+        if (!parseInt(value, 1, opts.tuning.lmrFullDepthMoves)) {
+          std::cerr << "Invalid --lmr-moves value: " << value << "\n";
+          return false;
+        }
       } else if (arg == "--scenario") {
         opts.scenarioKeys = splitCsv(value);
       } else if (arg == "--variant") {
         opts.variantKeys = splitCsv(value);
+      } else if (arg == "--tt-snapshot") {
+        opts.ttSnapshot = value;
       }
       continue;
     }
@@ -179,6 +282,34 @@ bool parseArgs(int argc, char** argv, Options& opts) {
       opts.clearTTEachRun = false;
       continue;
     }
+    if (arg == "--no-quiescence") {
+      opts.tuning.quiescence = false;
+      continue;
+    }
+    if (arg == "--symmetric-hashing") {
+      opts.tuning.symmetricHashing = true;
+      continue;
+    }
+    if (arg == "--null-move") {
+      opts.tuning.nullMove = true;
+      continue;
+    }
+    if (arg == "--lmr") {
+      opts.tuning.lateMoveReductions = true;
+      continue;
+    }
+    if (arg == "--eval-throughput") {
+      opts.evalThroughput = true;
+      continue;
+    }
+    if (arg == "--thread-scaling") {
+      opts.threadScaling = true;
+      continue;
+    }
+    if (arg == "--no-simd") {
+      opts.batchSimd = false;
+      continue;
+    }
     if (arg == "--verbose-engine") {
       opts.quietEngineLogs = false;
       continue;
@@ -186,6 +317,10 @@ bool parseArgs(int argc, char** argv, Options& opts) {
     std::cerr << "Unknown option: " << arg << "\n";
     return false;
   }
+  if (opts.threadScaling && opts.threads < 2) {
+    std::cerr << "--thread-scaling needs --threads 2 or more\n";
+    return false;
+  }
   return true;
 }
 
@@ -347,12 +482,12 @@ std::vector<Variant> buildVariants() {
 
   Variant medium;
   medium.key = "medium";
-  medium.description = "Iterative deepening depth<=10, time=0.4s + evaluatePosition";
+  medium.description = "Iterative-deepening PVS depth<=10, time=0.4s + evaluatePosition";
   out.push_back(medium);
 
   Variant hard;
   hard.key = "hard";
-  hard.description = "PVS depth=10 + evaluatePositionHard";
+  hard.description = "Iterative-deepening PVS depth<=10, time=2s + evaluatePositionHard";
   out.push_back(hard);
   return out;
 }
@@ -386,23 +521,40 @@ std::vector<std::vector<char> > toBoardData(const Scenario& s) {
   return boardData;
 }
 
-Board* createBoard(const Scenario& s) {
+Board* createBoard(const Scenario& s, int candidateRadius = DEFAULT_CANDIDATE_RADIUS) {
   const int lastPlayer = (s.nextPlayer == PLAYER_1) ? PLAYER_2 : PLAYER_1;
   std::vector<std::vector<char> > boardData = toBoardData(s);
-  return new Board(boardData, s.goal, lastPlayer, s.nextPlayer, s.lastScore, s.nextScore,
-                   s.enableCapture, s.enableDoubleThreeRestriction);
+  Board* board = new Board(boardData, s.goal, lastPlayer, s.nextPlayer, s.lastScore, s.nextScore,
+                           s.enableCapture, s.enableDoubleThreeRestriction);
+  board->setCandidateRadius(candidateRadius);
+  return board;
+}
+
+// A node limit replaces the time budgets, so results do not depend on machine speed.
+SearchLimits variantLimits(double timeLimitMs, const Options& opts) {
+  if (opts.nodeLimit > 0) {
+    SearchLimits limits;
+    limits.nodes = opts.nodeLimit;
+    return limits;
+  }
+  return timeLimitMs > 0.0 ? SearchLimits::fromTime(timeLimitMs) : SearchLimits();
 }
 
-std::pair<int, int> runVariant(const Variant& variant, Board* board) {
+std::pair<int, int> runVariant(EngineContext& engine, const Variant& variant, Board* board,
+                               const Options& opts) {
   if (variant.key == "easy") {
-    Minimax::initKillerMoves();
-    return Minimax::getBestMove(board, 5, &Evaluation::evaluatePosition);
+    return Minimax::getBestMove(engine, board, 5, &Evaluation::evaluatePosition, opts.threads,
+                                variantLimits(0.0, opts));
   }
   if (variant.key == "medium") {
-    return Minimax::iterativeDeepening(board, MAX_DEPTH, 0.4, &Evaluation::evaluatePosition);
+    return Minimax::iterativeDeepening(engine, board, MAX_DEPTH,
+                                       variantLimits(MEDIUM_TIME_LIMIT_MS, opts),
+                                       &Evaluation::evaluatePosition, opts.threads);
   }
   if (variant.key == "hard") {
-    return Minimax::getBestMovePVS(board, MAX_DEPTH, &Evaluation::evaluatePositionHard);
+    return Minimax::iterativeDeepening(engine, board, MAX_DEPTH,
+                                       variantLimits(HARD_TIME_LIMIT_MS, opts),
+                                       &Evaluation::evaluatePositionHard, opts.threads);
   }
   return std::make_pair(-1, -1);
 }
@@ -499,44 +651,196 @@ void printCatalog(const std::vector<Scenario>& scenarios, const std::vector<Vari
   }
 }
 
-Summary runBenchmark(const Scenario& scenario, const Variant& variant, const Options& opts) {
+Summary runBenchmark(EngineContext& engine, const Scenario& scenario, const Variant& variant,
+                     const Options& opts) {
   std::vector<double> samples;
   std::pair<int, int> lastMove(-1, -1);
+  unsigned long long totalNodes = 0;
+  unsigned long long evalProbes = 0;
+  unsigned long long evalHits = 0;
 
   const int totalRuns = opts.warmup + opts.iterations;
   for (int run = 0; run < totalRuns; ++run) {
-    if (opts.clearTTEachRun) transTable.clear();
+    if (opts.clearTTEachRun) {
+      engine.transTable.clear();
+      engine.evalCache.clear();
+    }
 
-    Board* board = createBoard(scenario);
+    Board* board = createBoard(scenario, opts.candidateRadius);
     double elapsed = 0.0;
     {
       ScopedCoutSilencer silencer(opts.quietEngineLogs);
       const double t0 = nowMs();
-      lastMove = runVariant(variant, board);
+      lastMove = runVariant(engine, variant, board, opts);
       const double t1 = nowMs();
       elapsed = t1 - t0;
     }
 
     delete board;
-    if (run >= opts.warmup) samples.push_back(elapsed);
+    if (run >= opts.warmup) {
+      samples.push_back(elapsed);
+      totalNodes += Minimax::lastSearchNodes(engine);
+      evalProbes += Minimax::lastEvalProbes(engine);
+      evalHits += Minimax::lastEvalHits(engine);
+    }
+  }
+
+  Summary out = summarize(samples, lastMove);
+  if (!samples.empty()) out.avgNodes = totalNodes / samples.size();
+  if (evalProbes > 0) out.evalHitRate = 100.0 * evalHits / evalProbes;
+  return out;
+}
+
+// Calls `evalFn` for both players on every empty cell until ~200ms have passed.
+double measureEvalRate(Board* board, EvalFn evalFn) {
+  std::vector<std::pair<int, int> > cells;
+  for (int y = 0; y < BOARD_SIZE; ++y)
+    for (int x = 0; x < BOARD_SIZE; ++x)
+      if (board->getValueBit(x, y) == EMPTY_SPACE) cells.push_back(std::make_pair(x, y));
+
+  long long calls = 0;
+  volatile int sink = 0;
+  const double t0 = nowMs();
+  double elapsed = 0.0;
+  while (elapsed < 200.0) {
+    for (std::vector<std::pair<int, int> >::size_type i = 0; i < cells.size(); ++i) {
+      sink += evalFn(board, PLAYER_1, cells[i].first, cells[i].second);
+      sink += evalFn(board, PLAYER_2, cells[i].first, cells[i].second);
+    }
+    calls += 2 * static_cast<long long>(cells.size());
+    elapsed = nowMs() - t0;
+  }
+  (void)sink;
+  return calls / (elapsed / 1000.0);
+}
+
+// The same cells and players through evaluatePositionBatch.
+double measureBatchEvalRate(Board* board) {
+  std::vector<std::pair<int, int> > cells;
+  for (int y = 0; y < BOARD_SIZE; ++y)
+    for (int x = 0; x < BOARD_SIZE; ++x)
+      if (board->getValueBit(x, y) == EMPTY_SPACE) cells.push_back(std::make_pair(x, y));
+  if (cells.empty()) return 0.0;
+
+  std::vector<int> scores(cells.size());
+  const int count = static_cast<int>(cells.size());
+  long long calls = 0;
+  volatile int sink = 0;
+  const double t0 = nowMs();
+  double elapsed = 0.0;
+  while (elapsed < 200.0) {
+    Evaluation::evaluatePositionBatch(board, PLAYER_1, &cells[0], count, &scores[0]);
+    sink += scores[0];
+    Evaluation::evaluatePositionBatch(board, PLAYER_2, &cells[0], count, &scores[0]);
+    sink += scores[0];
+    calls += 2 * static_cast<long long>(cells.size());
+    elapsed = nowMs() - t0;
+  }
+  (void)sink;
+  return calls / (elapsed / 1000.0);
+}
+
+void printEvalThroughput(const Scenario& scenario) {
+  Board* board = createBoard(scenario);
+  const double easyRate = measureEvalRate(board, &Evaluation::evaluatePosition);
+  const double batchRate = measureBatchEvalRate(board);
+  const double hardRate = measureEvalRate(board, &Evaluation::evaluatePositionHard);
+  delete board;
+  std::cout << "  eval/s: easy " << std::fixed << std::setprecision(2) << easyRate / 1e6
+            << "M, easy batch " << batchRate / 1e6 << "M, hard " << hardRate / 1e6 << "M\n";
+}
+
+// Time and main-thread nodes when an iteration of depth `depth` completed.
+struct DepthSample {
+  int depth;
+  double ms;
+  unsigned long long nodes;
+};
+
+struct ScalingRun {
+  std::vector<DepthSample> depths;
+  double totalMs;
+  unsigned long long totalNodes;  // all threads
+
+  ScalingRun() : totalMs(0.0), totalNodes(0) {}
+};
+
+void recordDepth(const SearchProgress& progress, void* arg) {
+  DepthSample sample = {progress.depth, progress.elapsedMs, progress.nodes};
+  static_cast<std::vector<DepthSample>*>(arg)->push_back(sample);
+}
+
+// One search of `variant` with `threads` threads. The fixed-depth easy search
+// reports no iterations, so its only sample is the whole search at depth 5.
+ScalingRun runScaling(EngineContext& engine, const Scenario& scenario, const Variant& variant,
+                      const Options& opts, int threads) {
+  Options scaled = opts;
+  scaled.threads = threads;
+  if (opts.clearTTEachRun) {
+    engine.transTable.clear();
+    engine.evalCache.clear();
+  }
+  ScalingRun run;
+  engine.progress = recordDepth;
+  engine.progressArg = &run.depths;
+  Board* board = createBoard(scenario, opts.candidateRadius);
+  {
+    ScopedCoutSilencer silencer(opts.quietEngineLogs);
+    const double t0 = nowMs();
+    runVariant(engine, variant, board, scaled);
+    run.totalMs = nowMs() - t0;
   }
+  delete board;
+  engine.progress = NULL;
+  engine.progressArg = NULL;
+  run.totalNodes = Minimax::lastSearchNodes(engine);
+  if (variant.key == "easy") {
+    DepthSample sample = {5, run.totalMs, run.totalNodes};
+    run.depths.push_back(sample);
+  }
+  return run;
+}
 
-  return summarize(samples, lastMove);
+// Time to depth with one thread against opts.threads, for the depths both reached.
+void printThreadScaling(EngineContext& engine, const Scenario& scenario, const Variant& variant,
+                        const Options& opts) {
+  const ScalingRun single = runScaling(engine, scenario, variant, opts, 1);
+  const ScalingRun smp = runScaling(engine, scenario, variant, opts, opts.threads);
+  std::ostringstream smpLabel;
+  smpLabel << opts.threads << "T";
+  std::cout << "  " << variant.key << " thread scaling:\n"
+            << std::right << std::setw(9) << "depth" << std::setw(11) << "1T(ms)"
+            << std::setw(12) << "1T nodes" << std::setw(11) << smpLabel.str() + "(ms)"
+            << std::setw(12) << smpLabel.str() + " nodes" << std::setw(10) << "speedup" << "\n";
+  const std::vector<DepthSample>::size_type rows =
+      std::min(single.depths.size(), smp.depths.size());
+  for (std::vector<DepthSample>::size_type i = 0; i < rows; ++i) {
+    const DepthSample& a = single.depths[i];
+    const DepthSample& b = smp.depths[i];
+    std::cout << std::setw(9) << a.depth << std::fixed << std::setprecision(2) << std::setw(11)
+              << a.ms << std::setw(12) << a.nodes << std::setw(11) << b.ms << std::setw(12)
+              << b.nodes << std::setw(10) << (b.ms > 0.0 ? a.ms / b.ms : 0.0) << "\n";
+  }
+  std::cout << std::setw(9) << "total" << std::setw(11) << single.totalMs << std::setw(12)
+            << single.totalNodes << std::setw(11) << smp.totalMs << std::setw(12)
+            << smp.totalNodes << std::setw(10)
+            << (smp.totalMs > 0.0 ? single.totalMs / smp.totalMs : 0.0) << "\n";
 }
 
 void printHeader() {
   std::cout << std::left << std::setw(12) << "variant" << std::right << std::setw(11) << "avg(ms)"
             << std::setw(11) << "min(ms)" << std::setw(11) << "p50(ms)" << std::setw(11)
-            << "p95(ms)" << std::setw(11) << "max(ms)" << std::setw(10) << "move" << "\n";
-  std::cout << std::string(77, '-') << "\n";
+            << "p95(ms)" << std::setw(11) << "max(ms)" << std::setw(12) << "nodes"
+            << std::setw(10) << "evalhit%" << std::setw(10) << "move" << "\n";
+  std::cout << std::string(99, '-') << "\n";
 }
 
 void printRow(const Variant& variant, const Summary& summary) {
   std::cout << std::left << std::setw(12) << variant.key << std::right << std::fixed
             << std::setprecision(2) << std::setw(11) << summary.avgMs << std::setw(11)
             << summary.minMs << std::setw(11) << summary.p50Ms << std::setw(11) << summary.p95Ms
-            << std::setw(11) << summary.maxMs << std::setw(10) << moveToString(summary.lastMove)
-            << "\n";
+            << std::setw(11) << summary.maxMs << std::setw(12) << summary.avgNodes << std::setw(10)
+            << summary.evalHitRate << std::setw(10) << moveToString(summary.lastMove) << "\n";
 }
 
 }  // namespace
@@ -577,13 +881,44 @@ int main(int argc, char** argv) {
   }
 
   initZobrist();
+  EngineContext engine;
+  if (!engine.transTable.resize(opts.ttMegabytes)) {
+    std::cerr << "Failed to allocate a " << opts.ttMegabytes << " MB transposition table.\n";
+    return 1;
+  }
+  if (!engine.evalCache.resize(opts.evalCacheMegabytes)) {
+    std::cerr << "Failed to allocate a " << opts.evalCacheMegabytes << " MB evaluation cache.\n";
+    return 1;
+  }
   Evaluation::initCombinedPatternScoreTables();
   Evaluation::initCombinedPatternScoreTablesHard();
+  engine.tuning = opts.tuning;
+  const SearchTuning& tuning = engine.tuning;
+  const bool avx2 = Evaluation::setBatchSimd(opts.batchSimd);
+  const bool warmStart =
+      !opts.ttSnapshot.empty() && Minimax::loadTTSnapshot(engine, opts.ttSnapshot.c_str());
+  if (warmStart) opts.clearTTEachRun = false;
 
   std::cout << "Search benchmark\n";
   std::cout << "  iterations: " << opts.iterations << ", warmup: " << opts.warmup
+            << ", threads: " << opts.threads
+            << ", tt_mb: " << (engine.transTable.sizeInBytes() >> 20)
+            << ", eval_cache_mb: " << (engine.evalCache.sizeInBytes() >> 20)
             << ", clear_tt_each_run: " << (opts.clearTTEachRun ? "true" : "false") << "\n";
-  std::cout << "  quiet_engine_logs: " << (opts.quietEngineLogs ? "true" : "false") << "\n";
+  std::cout << "  quiet_engine_logs: " << (opts.quietEngineLogs ? "true" : "false")
+            << ", batch_eval: " << (avx2 ? "avx2" : "scalar") << "\n";
+  std::cout << "  quiescence: " << (tuning.quiescence ? "on" : "off") << ", null_move: ";
+  if (tuning.nullMove)
+    std::cout << "R=" << tuning.nullMoveReduction;
+  else
+    std::cout << "off";
+  std::cout << ", lmr: ";
+  if (tuning.lateMoveReductions)
+    std::cout << "R=" << tuning.lmrReduction << " from depth " << tuning.lmrMinDepth
+              << " after " << tuning.lmrFullDepthMoves << " moves";
+  else
+    std::cout << "off";
+  std::cout << "\n";
 
   for (std::vector<Scenario>::size_type i = 0; i < scenarios.size(); ++i) {
     const Scenario& scenario = scenarios[i];
@@ -591,13 +926,21 @@ int main(int argc, char** argv) {
 
     std::cout << "\nScenario: " << scenario.key << " (" << scenario.description << ")\n";
     std::cout << "  stones: " << countStones(scenario) << ", next: " << nextStone << "\n";
+    if (opts.evalThroughput) printEvalThroughput(scenario);
     printHeader();
 
     for (std::vector<Variant>::size_type j = 0; j < variants.size(); ++j) {
-      const Summary result = runBenchmark(scenario, variants[j], opts);
+      const Summary result = runBenchmark(engine, scenario, variants[j], opts);
       printRow(variants[j], result);
     }
+    if (opts.threadScaling)
+      for (std::vector<Variant>::size_type j = 0; j < variants.size(); ++j)
+        printThreadScaling(engine, scenario, variants[j], opts);
   }
 
+  if (!opts.ttSnapshot.empty() && !warmStart) {
+    if (!Minimax::saveTTSnapshot(engine, opts.ttSnapshot.c_str())) return 1;
+    std::cout << "\nTT snapshot saved to " << opts.ttSnapshot << "\n";
+  }
   return 0;
 }
@@ -2,16 +2,84 @@
 // Consolidated Test Suite for Double Three Logic
 // Verifies CForbiddenPointFinder against specific known cases
 
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 #include <vector>
 #include <sys/time.h>
+#include <unistd.h>
 #include <string>
 
 #include "Gomoku.hpp"
 #include "Board.hpp"
+#include "Evaluation.hpp"
 #include "ForbiddenPointFinder.h"
+#include "Minimax.hpp"
+#include "OpeningBook.hpp"
+#include "engine_pool.hpp"
+#include "request_handlers.hpp"
+#include "request_workers.hpp"
+#include "websocket_handler.hpp"
+
+// The websocket code runs without libwebsockets here: these take the place of
+// the calls it makes, recording what each connection is sent and whether a
+// worker woke the service loop.
+namespace {
+std::map<struct lws*, std::vector<std::string> > socketWrites;
+std::set<struct lws*> writableSockets;
+volatile bool serviceWoken = false;
+}  // namespace
+
+int lws_write(struct lws* wsi, unsigned char* buf, size_t len, enum lws_write_protocol protocol) {
+  (void)protocol;
+  socketWrites[wsi].push_back(std::string(reinterpret_cast<char*>(buf), len));
+  return static_cast<int>(len);
+}
+
+int lws_hdr_copy(struct lws* wsi, char* dest, int len, enum lws_token_indexes h) {
+  (void)wsi;
+  (void)len;
+  (void)h;
+  dest[0] = '\0';
+  return 0;
+}
+
+void lws_cancel_service(struct lws_context* context) {
+  (void)context;
+  storeFlag(&serviceWoken, true);
+}
+
+int lws_callback_on_writable(struct lws* wsi) {
+  writableSockets.insert(wsi);
+  return 0;
+}
+
+// Reads and writes slot words directly, to forge what a racing store leaves.
+class TranspositionTableTest {
+ public:
+  static bool readSlot(const TranspositionTable& table, uint64_t key, int index, uint64_t& check,
+                       uint64_t& data) {
+    check = slot(table, key, index).check;
+    data = slot(table, key, index).data;
+    return (check | data) != 0;
+  }
+  static void writeSlot(TranspositionTable& table, uint64_t key, int index, uint64_t check,
+                        uint64_t data) {
+    slot(table, key, index).check = check;
+    slot(table, key, index).data = data;
+  }
+
+ private:
+  static TranspositionTable::Slot& slot(const TranspositionTable& table, uint64_t key, int index) {
+    return table.buckets_[key & (table.bucketCount_ - 1)].slots[index];
+  }
+};
 
 namespace {
 
@@ -245,9 +313,26 @@ bool test_namuwiki_3() {
 
 // --------------------------------------------------------
 
+// Prints the summary of `results`; false if any of them failed.
+bool reportResults(const std::vector<TestResult>& results) {
+  int passed = 0, failed = 0;
+  double totalTime = 0;
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const TestResult& r = results[i];
+    if (r.passed) ++passed;
+    else ++failed;
+    totalTime += r.time;
+  }
+
+  std::cout << "\nPassed: " << passed << "/" << results.size();
+  std::cout << " (Avg: " << (totalTime/results.size()) << "ms)\n\n";
+  return failed == 0;
+}
+
 void RunSpecificTests() {
   std::cout << "========================================\n";
-  std::cout << "    [1/1] Specific Test Cases\n";
+  std::cout << "    [1/2] Specific Test Cases\n";
   std::cout << "========================================\n";
 
   test_double_three_basic();
@@ -262,21 +347,859 @@ void RunSpecificTests() {
   test_namuwiki_1();
   test_namuwiki_3();
 
-  int passed = 0, failed = 0;
-  double totalTime = 0;
+  if (!reportResults(specificResults)) {
+    std::cout << "[ERROR] Specific tests failed! Aborting.\n";
+    exit(1);
+  }
+}
 
-  for (size_t i = 0; i < specificResults.size(); ++i) {
-    const TestResult& r = specificResults[i];
-    if (r.passed) ++passed;
-    else ++failed;
-    totalTime += r.time;
+// ============================================================================
+// Engine Test Cases
+// ============================================================================
+std::vector<TestResult> engineResults;
+
+// Keeps the search logs out of the test output while it lives.
+class QuietOutput {
+ public:
+  QuietOutput() : saved_(std::cout.rdbuf(sink_.rdbuf())) {}
+  ~QuietOutput() { std::cout.rdbuf(saved_); }
+
+ private:
+  std::ostringstream sink_;
+  std::streambuf* saved_;
+};
+
+// Runs `test`, which prints its own failure details; an exception fails it.
+void runEngineCase(const std::string& testName, bool (*test)()) {
+  double t0 = getTimeMs();
+  bool passed = false;
+  std::string error;
+  try {
+    passed = test();
+  } catch (const std::exception& e) {
+    error = e.what();
   }
+  double t1 = getTimeMs();
 
-  std::cout << "\nPassed: " << passed << "/" << specificResults.size();
-  std::cout << " (Avg: " << (totalTime/specificResults.size()) << "ms)\n\n";
+  if (!passed) {
+    std::cout << "\n[FAIL] Test: " << testName << "\n";
+    if (!error.empty()) std::cout << "Exception: " << error << "\n";
+  }
 
-  if (failed > 0) {
-    std::cout << "[ERROR] Specific tests failed! Aborting.\n";
+  TestResult tr;
+  tr.name = testName;
+  tr.passed = passed;
+  tr.time = t1 - t0;
+  engineResults.push_back(tr);
+}
+
+// Capture points around the board, each taking two pairs: {x, y, dx1, dy1, dx2, dy2}.
+// Owners alternate between the players, so captures answer captures.
+const int kDoubleCapturePoints[5][6] = {{3, 3, 1, 0, 0, 1},   {15, 3, -1, 0, 0, 1},
+                                        {3, 15, 1, 0, 0, -1}, {15, 15, -1, 0, 0, -1},
+                                        {9, 9, 1, 1, -1, -1}};
+
+// Plays a capture-heavy game in which every search of a move starts from the
+// hash moves of the previous depth, on one context. A search must leave the
+// board as it found it, with no capture pending.
+bool test_captures_through_hash_moves() {
+  Board board(10, PLAYER_2, PLAYER_1, 0, 0, true, true);
+  for (int i = 0; i < 5; ++i) {
+    const int* p = kDoubleCapturePoints[i];
+    int owner = (i % 2 == 0) ? PLAYER_1 : PLAYER_2;
+    for (int k = 0; k < 2; ++k) {
+      int dx = p[2 + 2 * k], dy = p[3 + 2 * k];
+      board.setValueBit(p[0] + dx, p[1] + dy, OPPONENT(owner));
+      board.setValueBit(p[0] + 2 * dx, p[1] + 2 * dy, OPPONENT(owner));
+      board.setValueBit(p[0] + 3 * dx, p[1] + 3 * dy, owner);
+    }
+  }
+
+  EngineContext engine(4, 1);
+  for (int ply = 0; ply < 6; ++ply) {
+    uint64_t hash = board.getHash();
+    std::pair<int, int> move;
+    for (int depth = 1; depth <= 2; ++depth) {
+      {
+        QuietOutput quiet;
+        move = Minimax::getBestMove(engine, &board, depth, &Evaluation::evaluatePosition);
+      }
+      if (board.getHash() != hash || !board.getCapturedStones().empty()) {
+        std::cout << "Search at depth " << depth << " of ply " << ply << " changed the board\n";
+        return false;
+      }
+    }
+    if (!Board::isValidCoordinate(move.first, move.second)) return false;
+    board.makeMove(move.first, move.second);
+    board.flushCaptures();
+  }
+  return true;
+}
+
+// Overwrites `size` bytes at `offset` of `path` with `value`.
+bool patchFile(const char* path, long offset, const void* value, size_t size) {
+  FILE* file = std::fopen(path, "r+b");
+  if (!file) return false;
+  bool ok = std::fseek(file, offset, SEEK_SET) == 0 && std::fwrite(value, size, 1, file) == 1;
+  return std::fclose(file) == 0 && ok;
+}
+
+// A snapshot round-trips, and a damaged one leaves the context cold instead of
+// failing. Offsets follow SnapshotHeader in TranspositionTable.cpp: the 32-bit
+// rule set at 24, the 64-bit entry count at 32.
+// Why the snapshot checks of test_snapshot_rejects_corrupt_files failed, or NULL.
+const char* corruptSnapshotFailure(const EngineContext& engine, const char* path) {
+  const uint64_t hugeCount = 0x0FFFFFFFFFFFFFFFULL;
+  const uint32_t rules = 0x12345;
+  EngineContext cold(1, 1);
+  TTSnapshot snapshot;
+  if (!Minimax::saveTTSnapshot(engine, path) ||
+      !Minimax::readTTSnapshot(cold, path, snapshot) || snapshot.entryCount() == 0)
+    return "valid snapshot rejected";
+  const uint64_t extraEntry = snapshot.entryCount() + 1;
+  if (!patchFile(path, 32, &hugeCount, sizeof(hugeCount)) || Minimax::loadTTSnapshot(cold, path))
+    return "huge entry count accepted";
+  if (!patchFile(path, 32, &extraEntry, sizeof(extraEntry)) || Minimax::loadTTSnapshot(cold, path))
+    return "entry count beyond the file size accepted";
+  if (!Minimax::saveTTSnapshot(engine, path) || !patchFile(path, 24, &rules, sizeof(rules)) ||
+      Minimax::loadTTSnapshot(cold, path))
+    return "changed rule set accepted";
+  if (Minimax::loadTTSnapshot(cold, "doublethree_test.missing")) return "missing file accepted";
+  return NULL;
+}
+
+bool test_snapshot_rejects_corrupt_files() {
+  const char* path = "doublethree_test.snapshot";
+  Board board(5, PLAYER_2, PLAYER_1, 0, 0, true, true);
+  board.setValueBit(9, 9, PLAYER_1);
+  board.setValueBit(10, 10, PLAYER_2);
+  EngineContext engine(1, 1);
+  {
+    QuietOutput quiet;
+    Minimax::getBestMove(engine, &board, 3, &Evaluation::evaluatePosition);
+  }
+  const char* failure = corruptSnapshotFailure(engine, path);
+  std::remove(path);
+  if (failure == NULL) return true;
+  std::cout << "Snapshot: " << failure << "\n";
+  return false;
+}
+
+// Entries in the snapshot of `engines`, as a fresh context reads it back.
+size_t snapshotEntries(const std::vector<const EngineContext*>& engines, const char* path) {
+  EngineContext reader(1, 1);
+  TTSnapshot snapshot;
+  if (!Minimax::saveTTSnapshot(engines, path) || !Minimax::readTTSnapshot(reader, path, snapshot))
+    return 0;
+  return snapshot.entryCount();
+}
+
+// Saving several contexts keeps the deep entries of each, once per position.
+bool test_snapshot_merges_contexts() {
+  const char* path = "doublethree_test.snapshot";
+  EngineContext first(1, 1);
+  EngineContext second(1, 1);
+  Board board(5, PLAYER_2, PLAYER_1, 0, 0, true, true);
+  board.setValueBit(9, 9, PLAYER_1);
+  board.setValueBit(10, 10, PLAYER_2);
+  {
+    QuietOutput quiet;
+    Minimax::getBestMove(first, &board, 4, &Evaluation::evaluatePosition);
+    board.setValueBit(3, 3, PLAYER_1);
+    board.setValueBit(4, 4, PLAYER_2);
+    Minimax::getBestMove(second, &board, 4, &Evaluation::evaluatePosition);
+  }
+  std::vector<const EngineContext*> engines(1, &first);
+  size_t firstCount = snapshotEntries(engines, path);
+  engines[0] = &second;
+  size_t secondCount = snapshotEntries(engines, path);
+  engines.push_back(&first);
+  size_t mergedCount = snapshotEntries(engines, path);
+  // Both contexts searched this position again: it goes in once.
+  engines[1] = &second;
+  size_t sameCount = snapshotEntries(engines, path);
+  std::remove(path);
+  std::cout << "Snapshot entries: " << firstCount << " + " << secondCount << " -> " << mergedCount
+            << ", same context twice -> " << sameCount << "\n";
+  return firstCount > 0 && secondCount > 0 && mergedCount > std::max(firstCount, secondCount) &&
+         mergedCount <= firstCount + secondCount && sameCount == secondCount;
+}
+
+// Plays `moves` random moves on the 5x5 center of a capture board, and undoes
+// them all, calling `check` on the board after every move and every undo.
+// Returns the number of stones captured, or -1 once `check` fails.
+int capturePlayout(unsigned int seed, int moves, int candidateRadius,
+                   bool (*check)(const Board& board)) {
+  Board board(5, PLAYER_2, PLAYER_1, 0, 0, true, false);
+  board.setCandidateRadius(candidateRadius);
+  std::srand(seed);
+  std::vector<UndoInfo> undos;
+  int captured = 0;
+  for (int i = 0; i < moves; ++i) {
+    int x = 7 + std::rand() % 5, y = 7 + std::rand() % 5;
+    if (board.getValueBit(x, y) != EMPTY_SPACE) continue;
+    undos.push_back(board.makeMove(x, y));
+    board.flushCaptures();
+    captured += (int)undos.back().capturedStonesInfo.size();
+    if (!check(board)) return -1;
+  }
+  while (!undos.empty()) {
+    board.undoMove(undos.back());
+    undos.pop_back();
+    if (!check(board)) return -1;
+  }
+  return captured;
+}
+
+// The 9-cell window code of extractLineCode, read stone by stone: two bits per
+// cell from 4 steps back to 4 steps ahead, the center empty, off-board cells 3.
+unsigned int windowCode(const Board& board, int col, int row, int dx, int dy) {
+  unsigned int code = 0;
+  for (int k = -4; k <= 4; ++k)
+    code = (code << 2) | (k == 0 ? EMPTY_SPACE : board.getValueBit(col + k * dx, row + k * dy));
+  return code;
+}
+
+bool lineCodesMatchStones(const Board& board) {
+  for (int axis = 0; axis < 4; ++axis) {
+    const unsigned int* codes = board.getLineCodes(axis);
+    for (int row = 0; row < BOARD_SIZE; ++row)
+      for (int col = 0; col < BOARD_SIZE; ++col)
+        if (codes[row * BOARD_SIZE + col] !=
+            windowCode(board, col, row, DIRECTIONS[axis][0], DIRECTIONS[axis][1])) {
+          std::cout << "Line code of (" << col << "," << row << ") on axis " << axis
+                    << " is stale\n";
+          return false;
+        }
+  }
+  return true;
+}
+
+// The cached line codes follow placements, captures and their undos.
+bool test_line_codes_follow_captures() {
+  int captured = 0;
+  for (unsigned int seed = 1; seed <= 40; ++seed) {
+    int stones = capturePlayout(seed, 40, DEFAULT_CANDIDATE_RADIUS, lineCodesMatchStones);
+    if (stones < 0) return false;
+    captured += stones;
+  }
+  std::cout << "Line codes checked through " << captured << " captured stones\n";
+  return captured > 0;
+}
+
+// Empty cells within the board's candidate radius of a stone, found by scanning.
+bool candidateMaskMatchesStones(const Board& board) {
+  uint64_t mask[BOARD_SIZE];
+  board.getCandidateMask(mask);
+  const int r = board.getCandidateRadius();
+  for (int row = 0; row < BOARD_SIZE; ++row)
+    for (int col = 0; col < BOARD_SIZE; ++col) {
+      bool expected = false;
+      if (board.getValueBit(col, row) == EMPTY_SPACE)
+        for (int dy = -r; dy <= r && !expected; ++dy)
+          for (int dx = -r; dx <= r && !expected; ++dx) {
+            int stone = board.getValueBit(col + dx, row + dy);
+            expected = stone == PLAYER_1 || stone == PLAYER_2;
+          }
+      if (((mask[row] >> col) & 1) != (uint64_t)expected) {
+        std::cout << "Candidate (" << col << "," << row << ") at radius " << r << " is "
+                  << (expected ? "missing" : "stale") << "\n";
+        return false;
+      }
+    }
+  return true;
+}
+
+// The neighbour counts behind the candidate mask follow captures and undos at
+// both radii; a count left behind would keep a cell once the board is empty.
+bool test_candidates_follow_captures() {
+  int captured = 0;
+  for (int radius = 1; radius <= MAX_CANDIDATE_RADIUS; ++radius)
+    for (unsigned int seed = 1; seed <= 40; ++seed) {
+      int stones = capturePlayout(seed, 40, radius, candidateMaskMatchesStones);
+      if (stones < 0) return false;
+      captured += stones;
+    }
+  return captured > 0;
+}
+
+// A board with symmetric hashing on: its images under all 8 symmetries share
+// one canonical hash, and each image's symmetry maps it onto the same board,
+// so a TT move stored from one image lands on the same stone from any other.
+bool test_canonical_hash_symmetries() {
+  for (int col = 0; col < BOARD_SIZE; ++col)
+    for (int row = 0; row < BOARD_SIZE; ++row)
+      for (int s = 0; s < BOARD_SYMMETRIES; ++s) {
+        std::pair<int, int> image = symmetricMove(s, col, row);
+        if (inverseSymmetricMove(s, image.first, image.second) != std::make_pair(col, row))
+          return false;
+      }
+  for (unsigned int seed = 1; seed <= 5; ++seed) {
+    std::srand(seed);
+    std::vector<std::pair<int, int> > stones;
+    Board board(5, PLAYER_2, PLAYER_1, 0, 0, false, false);
+    board.setSymmetricHashing(true);
+    for (int i = 0; i < 12; ++i) {
+      int x = std::rand() % BOARD_SIZE, y = std::rand() % BOARD_SIZE;
+      if (board.getValueBit(x, y) != EMPTY_SPACE) continue;
+      board.setValueBit(x, y, i % 2 == 0 ? PLAYER_1 : PLAYER_2);
+      stones.push_back(std::make_pair(x, y));
+    }
+    int symmetry;
+    uint64_t canonical = board.getCanonicalHash(symmetry);
+    for (int s = 1; s < BOARD_SYMMETRIES; ++s) {
+      Board image(5, PLAYER_2, PLAYER_1, 0, 0, false, false);
+      image.setSymmetricHashing(true);
+      for (size_t i = 0; i < stones.size(); ++i) {
+        const std::pair<int, int>& stone = stones[i];
+        std::pair<int, int> at = symmetricMove(s, stone.first, stone.second);
+        image.setValueBit(at.first, at.second, board.getValueBit(stone.first, stone.second));
+      }
+      int imageSymmetry;
+      if (image.getCanonicalHash(imageSymmetry) != canonical) {
+        std::cout << "Seed " << seed << ": symmetry " << s << " changes the canonical hash\n";
+        return false;
+      }
+      for (size_t i = 0; i < stones.size(); ++i) {
+        std::pair<int, int> at = symmetricMove(s, stones[i].first, stones[i].second);
+        if (symmetricMove(imageSymmetry, at.first, at.second) !=
+            symmetricMove(symmetry, stones[i].first, stones[i].second)) {
+          std::cout << "Seed " << seed << ": symmetry " << s << " maps a stone elsewhere\n";
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Batch scores of every empty cell, with and without AVX2, against one
+// evaluatePosition call per cell, for both players on random capture boards.
+// Counts not divisible by 8 also cover the scalar tail of the batch.
+bool test_batch_scores_match_scalar() {
+  bool passed = true;
+  for (unsigned int seed = 1; seed <= 20 && passed; ++seed) {
+    std::srand(seed);
+    Board board(5, PLAYER_2, PLAYER_1, std::rand() % 5, std::rand() % 5, true, false);
+    for (int i = 0; i < 40; ++i) {
+      int x = 4 + std::rand() % 11, y = 4 + std::rand() % 11;
+      if (board.getValueBit(x, y) == EMPTY_SPACE)
+        board.setValueBit(x, y, i % 2 == 0 ? PLAYER_1 : PLAYER_2);
+    }
+    std::vector<std::pair<int, int> > moves;
+    for (int y = 0; y < BOARD_SIZE; ++y)
+      for (int x = 0; x < BOARD_SIZE; ++x)
+        if (board.getValueBit(x, y) == EMPTY_SPACE) moves.push_back(std::make_pair(x, y));
+    moves.resize(moves.size() - seed % 8);
+    const int count = (int)moves.size();
+    std::vector<int> scores(count);
+    for (int simd = 1; simd >= 0 && passed; --simd) {
+      bool avx2 = Evaluation::setBatchSimd(simd != 0);
+      for (int player = PLAYER_1; player <= PLAYER_2; ++player) {
+        Evaluation::evaluatePositionBatch(&board, player, &moves[0], count, &scores[0]);
+        for (int i = 0; i < count; ++i) {
+          const std::pair<int, int>& move = moves[i];
+          int expected = Evaluation::evaluatePosition(&board, player, move.first, move.second);
+          if (scores[i] != expected) {
+            std::cout << "Seed " << seed << (avx2 ? ", AVX2" : ", scalar") << ": player "
+                      << player << " at (" << move.first << "," << move.second << ") scores "
+                      << scores[i] << ", not " << expected << "\n";
+            passed = false;
+            break;
+          }
+        }
+      }
+    }
+  }
+  Evaluation::setBatchSimd(true);
+  return passed;
+}
+
+// Appends one byte to `path`, as a file cut or grown in transit would differ.
+bool growFile(const char* path) {
+  FILE* file = std::fopen(path, "ab");
+  if (!file) return false;
+  bool ok = std::fputc(0, file) != EOF;
+  return std::fclose(file) == 0 && ok;
+}
+
+// Builds a book of the 1- and 2-stone positions with small searches, maps it and
+// looks up a position and a rotated copy, then damages the file. Offsets follow
+// FileHeader in OpeningBook.cpp: the entry size at 20, the entries from 40.
+bool test_opening_book_round_trip() {
+  const char* path = "doublethree_test.book";
+  const int center = BOARD_SIZE / 2;
+  OpeningBook::BuildOptions options;
+  options.maxStones = 2;
+  options.limits = SearchLimits();
+  options.limits.nodes = 2000;
+  bool built;
+  {
+    QuietOutput quiet;
+    built = OpeningBook::build(path, options);
+  }
+  if (!built || !OpeningBook::mapBook(path) || OpeningBook::entryCount() == 0) {
+    std::remove(path);
+    return false;
+  }
+
+  // The engine's answer to the opponent's first stone, seen from a rotated board.
+  const int rotation = 5;
+  Board board(5, PLAYER_2, PLAYER_1, 0, 0, true, true);
+  Board rotated(board);
+  board.setValueBit(center, center, PLAYER_1);
+  board.setValueBit(center + 1, center - 1, PLAYER_2);
+  std::pair<int, int> stone = symmetricMove(rotation, center + 1, center - 1);
+  rotated.setValueBit(center, center, PLAYER_1);
+  rotated.setValueBit(stone.first, stone.second, PLAYER_2);
+  std::pair<int, int> move, rotatedMove;
+  bool found = OpeningBook::lookup(board, move) && OpeningBook::lookup(rotated, rotatedMove);
+  if (found) {
+    // Both answers lead to the same book position, up to symmetry.
+    board.setValueBit(move.first, move.second, board.getNextPlayer());
+    rotated.setValueBit(rotatedMove.first, rotatedMove.second, rotated.getNextPlayer());
+    uint64_t key, rotatedKey;
+    int symmetry;
+    found = OpeningBook::canonicalKey(board, key, symmetry) &&
+            OpeningBook::canonicalKey(rotated, rotatedKey, symmetry) && key == rotatedKey;
+  }
+
+  const uint32_t entrySize = 1;
+  const unsigned char flipped = 0xFF;
+  bool rejected = patchFile(path, 40, &flipped, 1) && !OpeningBook::mapBook(path);
+  {
+    QuietOutput quiet;
+    rejected = OpeningBook::build(path, options) && growFile(path) &&
+               !OpeningBook::mapBook(path) && rejected;
+    rejected = OpeningBook::build(path, options) && patchFile(path, 20, &entrySize, 4) &&
+               !OpeningBook::mapBook(path) && rejected;
+  }
+  std::remove(path);
+  if (!found) std::cout << "Opening book: no matching move for the rotated position\n";
+  if (!rejected) std::cout << "Opening book: a damaged file was mapped\n";
+  return found && rejected;
+}
+
+// Keys that differ only above the bucket index bits share a bucket.
+uint64_t bucketKey(int index) { return 0x5A5AULL + ((uint64_t)(index + 1) << 40); }
+
+bool probeMatches(const TranspositionTable& table, uint64_t key, int score, int depth,
+                  BoundType flag, std::pair<int, int> move) {
+  TTEntry entry;
+  return table.probe(key, entry) && entry.score == score && entry.depth == depth &&
+         entry.flag == flag && entry.bestMove == move;
+}
+
+// Store and probe by key; a much shallower result does not replace an exact
+// entry of the current search, a nearly as deep or later one does and keeps
+// its move; a full bucket evicts its shallowest entry.
+bool test_tt_store_probe_replace() {
+  TranspositionTable table(1);
+  const uint64_t key = bucketKey(0);
+  const std::pair<int, int> move(3, 4), noMove(-1, -1);
+  table.store(key, TTEntry(-77, 6, move, EXACT));
+  if (!probeMatches(table, key, -77, 6, EXACT, move)) return false;
+  TTEntry entry;
+  if (table.probe(bucketKey(1), entry)) return false;
+
+  table.store(key, TTEntry(5, 6 - TT_EXACT_KEEP_MARGIN - 1, noMove, LOWERBOUND));
+  if (!probeMatches(table, key, -77, 6, EXACT, move)) return false;
+  table.store(key, TTEntry(5, 6 - TT_EXACT_KEEP_MARGIN, noMove, LOWERBOUND));
+  if (!probeMatches(table, key, 5, 6 - TT_EXACT_KEEP_MARGIN, LOWERBOUND, move)) return false;
+  table.store(key, TTEntry(8, 9, move, EXACT));
+  table.newSearch();
+  table.store(key, TTEntry(9, 1, noMove, UPPERBOUND));
+  if (!probeMatches(table, key, 9, 1, UPPERBOUND, move)) return false;
+
+  // The first key, now at depth 1, is the shallowest of the bucket.
+  for (int i = 1; i < TT_BUCKET_ENTRIES; ++i)
+    table.store(bucketKey(i), TTEntry(i, 4 + i, noMove, EXACT));
+  table.store(bucketKey(TT_BUCKET_ENTRIES), TTEntry(0, 4, noMove, EXACT));
+  if (table.probe(key, entry)) return false;
+  for (int i = 1; i <= TT_BUCKET_ENTRIES; ++i)
+    if (!table.probe(bucketKey(i), entry) || entry.score != i % TT_BUCKET_ENTRIES) return false;
+  return true;
+}
+
+// One slot from two stores, as a reader racing a writer can see it: the check
+// word of key A's store beside the data word of key B's. Neither key may hit.
+bool test_tt_rejects_torn_slots() {
+  TranspositionTable table(1);
+  const uint64_t first = bucketKey(0), second = bucketKey(1);
+  table.store(first, TTEntry(1, 3, std::make_pair(1, 1), EXACT));
+  table.store(second, TTEntry(2, 4, std::make_pair(2, 2), LOWERBOUND));
+  uint64_t firstCheck, firstData, secondCheck, secondData;
+  if (!TranspositionTableTest::readSlot(table, first, 0, firstCheck, firstData) ||
+      !TranspositionTableTest::readSlot(table, first, 1, secondCheck, secondData))
+    return false;
+  TranspositionTableTest::writeSlot(table, first, 0, firstCheck, secondData);
+  TranspositionTableTest::writeSlot(table, first, 1, secondCheck, firstData);
+  TTEntry entry;
+  return !table.probe(first, entry) && !table.probe(second, entry);
+}
+
+// A five made by the side the node minimizes for scores against the root side,
+// in minimax() and pvs() alike; one made by the root side scores for it.
+bool test_terminal_scores_follow_the_mover() {
+  const int fiveRow = 7;
+  bool passed = true;
+  for (int mover = PLAYER_1; mover <= PLAYER_2; ++mover) {
+    Board board(5, OPPONENT(mover), mover, 0, 0, false, false);
+    for (int x = 5; x < 9; ++x) board.setValueBit(x, fiveRow, mover);
+    board.setValueBit(3, 3, OPPONENT(mover));
+    board.setValueBit(12, 12, OPPONENT(mover));
+    board.makeMove(9, fiveRow);
+    board.flushCaptures();
+    // The root side maximizes: the node after its own five minimizes.
+    bool rootMoved = mover == PLAYER_1;
+    EngineContext engine(1, 1);
+    SearchThread thread(engine);
+    int next = board.getNextPlayer();
+    int alpha = std::numeric_limits<int>::min();
+    int beta = std::numeric_limits<int>::max();
+    int viaMinimax = Minimax::minimax(&board, 2, alpha, beta, next, 9, fiveRow, !rootMoved,
+                                      &Evaluation::evaluatePosition, thread);
+    int viaPvs = Minimax::pvs(&board, 2, alpha, beta, next, 9, fiveRow, !rootMoved,
+                              &Evaluation::evaluatePosition, thread);
+    if ((viaMinimax > 0) != rootMoved || (viaPvs > 0) != rootMoved) {
+      std::cout << "Five by player " << mover << ": minimax " << viaMinimax << ", pvs " << viaPvs
+                << "\n";
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+// Deterministic quiet positions: `stones` stones around the center, no captures.
+Board quietPosition(unsigned int seed, int stones) {
+  Board board(5, PLAYER_2, PLAYER_1, 0, 0, false, false);
+  std::srand(seed);
+  for (int placed = 0; placed < stones;) {
+    int x = 6 + std::rand() % 7, y = 6 + std::rand() % 7;
+    if (board.getValueBit(x, y) != EMPTY_SPACE) continue;
+    board.setValueBit(x, y, placed % 2 == 0 ? PLAYER_1 : PLAYER_2);
+    ++placed;
+  }
+  return board;
+}
+
+// Scores are relative to the side a search starts from, so a context that has
+// searched from one side must not reuse those entries from the other: searching
+// the next position then costs what it costs on a fresh context.
+bool test_tt_keeps_root_sides_apart() {
+  bool passed = true;
+  for (unsigned int seed = 1; seed <= 3; ++seed) {
+    Board board = quietPosition(seed, 6);
+    EngineContext used(1, 1), fresh(1, 1);
+    used.tuning.quiescence = fresh.tuning.quiescence = false;
+    std::pair<int, int> reply, freshReply;
+    {
+      QuietOutput quiet;
+      std::pair<int, int> move =
+          Minimax::getBestMove(used, &board, 3, &Evaluation::evaluatePosition);
+      board.makeMove(move.first, move.second);
+      board.flushCaptures();
+      reply = Minimax::getBestMove(used, &board, 3, &Evaluation::evaluatePosition);
+      freshReply = Minimax::getBestMove(fresh, &board, 3, &Evaluation::evaluatePosition);
+    }
+    if (reply != freshReply || used.nodes != fresh.nodes) {
+      std::cout << "Seed " << seed << ": reused context " << used.nodes << " nodes, fresh "
+                << fresh.nodes << "\n";
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+// With reductions and null moves off, PVS is exact: its null-window probes and
+// re-searches must give the full-window alpha-beta score of minimax().
+bool test_pvs_matches_minimax() {
+  bool passed = true;
+  for (unsigned int seed = 1; seed <= 4; ++seed) {
+    for (int depth = 2; depth <= 3; ++depth) {
+      Board board = quietPosition(seed, 6);
+      EngineContext forMinimax(1, 1), forPvs(1, 1);
+      forMinimax.tuning.quiescence = forPvs.tuning.quiescence = false;
+      SearchThread minimaxThread(forMinimax), pvsThread(forPvs);
+      int next = board.getNextPlayer();
+      int alpha = std::numeric_limits<int>::min();
+      int beta = std::numeric_limits<int>::max();
+      int expected = Minimax::minimax(&board, depth, alpha, beta, next, -1, -1, true,
+                                      &Evaluation::evaluatePosition, minimaxThread);
+      int score = Minimax::pvs(&board, depth, alpha, beta, next, -1, -1, true,
+                               &Evaluation::evaluatePosition, pvsThread);
+      if (score != expected) {
+        std::cout << "Seed " << seed << ", depth " << depth << ": pvs " << score << ", minimax "
+                  << expected << "\n";
+        passed = false;
+      }
+    }
+  }
+  return passed;
+}
+
+// Node counts jump by whole threat solver runs and may never land on a multiple
+// of TM_POLL_INTERVAL again; the hard limit must still be seen.
+bool test_hard_limit_survives_node_jumps() {
+  TimeManager timer;
+  timer.start(SearchLimits::fromTime(20));
+  if (timer.poll(1)) return false;
+  usleep(30 * 1000);
+  unsigned long long nodes = 1;
+  for (int jumps = 0; jumps < 3 && !timer.stopped(); ++jumps) {
+    nodes += THREAT_NODE_LIMIT + 1;
+    timer.poll(nodes);
+  }
+  return timer.stopped();
+}
+
+// A ponder hit that comes after the hard limit has passed since pondering
+// began: the limits count from the hit, so the search goes on.
+bool test_ponder_hit_restarts_clock() {
+  volatile bool hit = false;
+  SearchLimits limits = SearchLimits::fromTime(40);
+  limits.ponderHit = &hit;
+  TimeManager timer;
+  timer.start(limits);
+  usleep(60 * 1000);
+  if (timer.poll(0) || !timer.canStartIteration(0)) return false;  // still pondering
+  storeFlag(&hit, true);
+  // Seen first between iterations, then by the node poll.
+  if (!timer.canStartIteration(0) || timer.poll(TM_POLL_INTERVAL) || timer.elapsedMs() >= 20)
+    return false;
+  usleep(60 * 1000);
+  return !timer.canStartIteration(0) && timer.poll(2 * TM_POLL_INTERVAL);
+}
+
+// The node limit also counts from the hit, not from the start of pondering.
+bool test_ponder_hit_restarts_node_count() {
+  const unsigned long long pondered = 100000;
+  volatile bool hit = false;
+  SearchLimits limits;
+  limits.nodes = 5000;
+  limits.ponderHit = &hit;
+  TimeManager timer;
+  timer.start(limits);
+  if (timer.poll(pondered)) return false;  // no node limit before the hit
+  storeFlag(&hit, true);
+  if (timer.poll(pondered) || timer.poll(pondered + limits.nodes - 1)) return false;
+  return timer.poll(pondered + limits.nodes);
+}
+
+// Two connections served on this thread as the server's loop would: worker
+// results on a wake-up, then one reply per writeable socket.
+const int kFakeConnections = 2;
+char fakeSockets[kFakeConnections];
+psd_debug* fakeSessions[kFakeConnections];
+
+struct lws* fakeSocket(int conn) { return reinterpret_cast<struct lws*>(&fakeSockets[conn]); }
+
+void openFakeConnections() {
+  configureEnginePool(kFakeConnections, 16, 4, "");
+  startRequestWorkers(NULL, 2);
+  for (int i = 0; i < kFakeConnections; ++i)
+    callbackWebsocket(fakeSocket(i), LWS_CALLBACK_ESTABLISHED, &fakeSessions[i], NULL, 0);
+}
+
+// Closes the connections first, so their running searches stop.
+void closeFakeConnections() {
+  for (int i = 0; i < kFakeConnections; ++i)
+    callbackWebsocket(fakeSocket(i), LWS_CALLBACK_CLOSED, &fakeSessions[i], NULL, 0);
+  stopRequestWorkers();
+  completeWorkerRequests();
+  destroyEnginePool();
+  socketWrites.clear();
+  writableSockets.clear();
+  storeFlag(&serviceWoken, false);
+}
+
+void receive(int conn, const std::string& message) {
+  callbackWebsocket(fakeSocket(conn), LWS_CALLBACK_RECEIVE, &fakeSessions[conn],
+                    const_cast<char*>(message.data()), message.size());
+}
+
+void serviceOnce() {
+  if (loadFlag(&serviceWoken)) {
+    storeFlag(&serviceWoken, false);
+    callbackWebsocket(NULL, LWS_CALLBACK_EVENT_WAIT_CANCELLED, NULL, NULL, 0);
+  }
+  std::vector<struct lws*> ready(writableSockets.begin(), writableSockets.end());
+  writableSockets.clear();
+  for (size_t i = 0; i < ready.size(); ++i) {
+    int conn = reinterpret_cast<char*>(ready[i]) - fakeSockets;
+    callbackWebsocket(ready[i], LWS_CALLBACK_SERVER_WRITEABLE, &fakeSessions[conn], NULL, 0);
+  }
+}
+
+// The types of the replies `conn` was sent, progress messages left out.
+std::vector<std::string> replyTypes(int conn) {
+  const std::string prefix = "{\"type\":\"";
+  std::vector<std::string> types;
+  const std::vector<std::string>& sent = socketWrites[fakeSocket(conn)];
+  for (size_t i = 0; i < sent.size(); ++i) {
+    if (sent[i].compare(0, prefix.size(), prefix) != 0) continue;
+    size_t end = sent[i].find('"', prefix.size());
+    std::string type = sent[i].substr(prefix.size(), end - prefix.size());
+    if (type != "progress") types.push_back(type);
+  }
+  return types;
+}
+
+// Serves until `conn` has `count` replies; false if that takes over `limitMs`.
+bool serveReplies(int conn, size_t count, double limitMs) {
+  double t0 = getTimeMs();
+  while (replyTypes(conn).size() < count) {
+    if (getTimeMs() - t0 > limitMs) return false;
+    usleep(1000);
+    serviceOnce();
+  }
+  return true;
+}
+
+bool replyTypesAre(int conn, const char* const* expected, size_t count) {
+  std::vector<std::string> types = replyTypes(conn);
+  if (types == std::vector<std::string>(expected, expected + count)) return true;
+  std::cerr << "  connection " << conn << " got:";
+  for (size_t i = 0; i < types.size(); ++i) std::cerr << " " << types[i];
+  std::cerr << "\n";
+  return false;
+}
+
+// O to move after X's last play, three stones around the center.
+std::string positionFields() {
+  std::string board = "[";
+  for (int y = 0; y < BOARD_SIZE; ++y) {
+    board += y == 0 ? "[" : ",[";
+    for (int x = 0; x < BOARD_SIZE; ++x) {
+      const char* cell = ".";
+      if ((x == 9 && y == 9) || (x == 9 && y == 10)) cell = "X";
+      if (x == 10 && y == 9) cell = "O";
+      board += std::string(x == 0 ? "\"" : ",\"") + cell + "\"";
+    }
+    board += "]";
+  }
+  board += "]";
+  return "\"nextPlayer\":\"O\",\"lastPlay\":{\"coordinate\":{\"x\":9,\"y\":10},\"stone\":\"X\"},"
+         "\"goal\":5,\"enableDoubleThreeRestriction\":true,\"enableCapture\":true,"
+         "\"scores\":[{\"player\":\"O\",\"score\":0},{\"player\":\"X\",\"score\":0}],"
+         "\"board\":" + board;
+}
+
+std::string moveRequest(int timeLimitMs) {
+  std::ostringstream request;
+  request << "{\"type\":\"move\",\"difficulty\":\"hard\",\"timeLimitMs\":" << timeLimitMs << ","
+          << positionFields() << "}";
+  return request.str();
+}
+
+std::string evaluateRequest() { return "{\"type\":\"evaluate\"," + positionFields() + "}"; }
+
+const std::string kPingRequest = "{\"type\":\"ping\"}";
+
+// A connection's replies keep the order of its requests, even those answered
+// without a worker; another connection is served while its search runs.
+bool test_workers_keep_request_order() {
+  QuietOutput quiet;
+  openFakeConnections();
+  receive(0, moveRequest(400));
+  receive(0, kPingRequest);
+  receive(1, evaluateRequest());
+  receive(1, kPingRequest);
+  bool served = serveReplies(1, 2, 2000);
+  bool searching = replyTypes(0).empty();
+  bool searched = serveReplies(0, 2, 5000);
+  const char* const first[] = {"move", "pong"};
+  const char* const second[] = {"evaluate", "pong"};
+  bool ordered = replyTypesAre(0, first, 2) && replyTypesAre(1, second, 2);
+  closeFakeConnections();
+  return served && searching && searched && ordered;
+}
+
+// A cancel, or a newer search, answers every search it stops with `cancelled`,
+// in the place of its reply; other requests are answered as usual.
+bool test_cancel_answers_each_search() {
+  QuietOutput quiet;
+  openFakeConnections();
+  double t0 = getTimeMs();
+  receive(0, moveRequest(5000));
+  receive(0, kPingRequest);
+  receive(0, moveRequest(5000));  // stops the running search
+  receive(0, evaluateRequest());
+  receive(0, "{\"type\":\"cancel\"}");  // before the second search has started
+  bool served = serveReplies(0, 4, 3000);
+  double servedMs = getTimeMs() - t0;
+  // Nothing else comes, and nothing is left running to ponder.
+  serveReplies(0, 5, 200);
+  const char* const expected[] = {"cancelled", "pong", "cancelled", "evaluate"};
+  bool answered = replyTypesAre(0, expected, 4);
+  bool idle = requestWorkersIdle();
+  closeFakeConnections();
+  return served && servedMs < 2000 && answered && idle;
+}
+
+// Serves until the connection's ponder search has ended on its own.
+bool servePonderDone(int conn, double limitMs) {
+  double t0 = getTimeMs();
+  while (fakeSessions[conn]->pondering || fakeSessions[conn]->ponder == NULL) {
+    if (getTimeMs() - t0 > limitMs) return false;
+    usleep(1000);
+    serviceOnce();
+  }
+  return true;
+}
+
+// A move request other than the predicted one stops a running ponder search and
+// is searched as usual once it has, as it is after a finished ponder search.
+bool test_ponder_miss_searches_the_request() {
+  QuietOutput quiet;
+  openFakeConnections();
+  receive(0, moveRequest(300));
+  bool replied = serveReplies(0, 1, 3000);
+  PonderSearch* ponder = fakeSessions[0]->ponder;
+  bool pondering = fakeSessions[0]->pondering;
+  setPonderTime(50);  // for the ponder searches started from here on
+  // The position before the AI's reply is never the predicted one. The ponder
+  // search is only freed once the service loop sees its worker is done.
+  receive(0, moveRequest(300));
+  bool stopped = pondering && loadFlag(&ponder->stop) && !loadFlag(&ponder->hit);
+  bool searched = serveReplies(0, 2, 3000);
+  bool finished = servePonderDone(0, 2000);
+  receive(0, moveRequest(300));
+  searched = serveReplies(0, 3, 3000) && searched;
+  setPonderTime(PONDER_DEFAULT_MS);
+  const char* const expected[] = {"move", "move", "move"};
+  bool answered = replyTypesAre(0, expected, 3);
+  closeFakeConnections();
+  return replied && stopped && searched && finished && answered;
+}
+
+void RunEngineTests() {
+  std::cout << "========================================\n";
+  std::cout << "    [2/2] Engine Test Cases\n";
+  std::cout << "========================================\n";
+
+  runEngineCase("Captures Through Hash Moves", test_captures_through_hash_moves);
+  runEngineCase("Line Codes Follow Captures", test_line_codes_follow_captures);
+  runEngineCase("Candidates Follow Captures", test_candidates_follow_captures);
+  runEngineCase("Canonical Hash Symmetries", test_canonical_hash_symmetries);
+  runEngineCase("Batch Scores Match Scalar", test_batch_scores_match_scalar);
+  runEngineCase("Opening Book Round Trip", test_opening_book_round_trip);
+  runEngineCase("Snapshot Rejects Corrupt Files", test_snapshot_rejects_corrupt_files);
+  runEngineCase("Snapshot Merges Contexts", test_snapshot_merges_contexts);
+  runEngineCase("TT Store Probe Replace", test_tt_store_probe_replace);
+  runEngineCase("TT Rejects Torn Slots", test_tt_rejects_torn_slots);
+  runEngineCase("Terminal Scores Follow The Mover", test_terminal_scores_follow_the_mover);
+  runEngineCase("TT Keeps Root Sides Apart", test_tt_keeps_root_sides_apart);
+  runEngineCase("PVS Matches Minimax", test_pvs_matches_minimax);
+  runEngineCase("Hard Limit Survives Node Jumps", test_hard_limit_survives_node_jumps);
+  runEngineCase("Ponder Hit Restarts The Clock", test_ponder_hit_restarts_clock);
+  runEngineCase("Ponder Hit Restarts The Node Count", test_ponder_hit_restarts_node_count);
+  runEngineCase("Workers Keep Request Order", test_workers_keep_request_order);
+  runEngineCase("Cancel Answers Each Search", test_cancel_answers_each_search);
+  runEngineCase("Ponder Miss Searches The Request", test_ponder_miss_searches_the_request);
+
+  if (!reportResults(engineResults)) {
+    std::cout << "[ERROR] Engine tests failed! Aborting.\n";
     exit(1);
   }
 }
@@ -288,8 +1211,11 @@ int main() {
   // but if Board depends on it for something, good to have.
   // Board constructor might not need it, but let's call it if available.
   initZobrist();
+  Evaluation::initCombinedPatternScoreTables();
+  Evaluation::initCombinedPatternScoreTablesHard();
 
   RunSpecificTests();
+  RunEngineTests();
 
   return 0;
 }
@@ -20,12 +20,49 @@ struct CapturedStone {
   int player;
 };
 
+// Empty cells within this Chebyshev distance of a stone are move candidates.
+#define DEFAULT_CANDIDATE_RADIUS 1
+#define MAX_CANDIDATE_RADIUS 2
+
+// A move captures at most one pair in each of the 8 directions.
+#define MAX_CAPTURED_STONES 16
+
+// Board symmetries: bit 2 transposes, then bit 0 mirrors the column and bit 1 the row.
+#define BOARD_SYMMETRIES 8
+
+// Fixed-capacity capture buffer, so makeMove/undoMove never allocate.
+// Copies only transfer the stones in use.
+struct CaptureList {
+  CapturedStone stones[MAX_CAPTURED_STONES];
+  int count;
+
+  CaptureList() : count(0) {}
+  CaptureList(const CaptureList &other) : count(other.count) {
+    for (int i = 0; i < count; ++i) stones[i] = other.stones[i];
+  }
+  CaptureList &operator=(const CaptureList &other) {
+    count = other.count;
+    for (int i = 0; i < count; ++i) stones[i] = other.stones[i];
+    return *this;
+  }
+
+  void push_back(const CapturedStone &cs) {
+    if (count >= MAX_CAPTURED_STONES)
+      throw std::runtime_error("Capture list overflow: captures were not flushed");
+    stones[count++] = cs;
+  }
+  void clear() { count = 0; }
+  bool empty() const { return count == 0; }
+  size_t size() const { return (size_t)count; }
+  const CapturedStone &operator[](size_t i) const { return stones[i]; }
+};
+
 struct UndoInfo {
   // The move that was made
   std::pair<int, int> move;
 
   // List of stones captured BY this move (player is the one whose stone was removed)
-  std::vector<CapturedStone> capturedStonesInfo;  // Stores {x, y, player} for each stone captured
+  CaptureList capturedStonesInfo;  // Stores {x, y, player} for each stone captured
 
   // Score of the player *who made the move* BEFORE any captures in this move occurred.
   // Needed to correctly revert the score and score hash update.
@@ -48,14 +85,36 @@ class Board {
   bool enable_capture;
   bool enable_double_three_restriction;
 
-  std::vector<CapturedStone> captured_stones;
+  CaptureList captured_stones;
 
   uint64_t last_player_board[BOARD_SIZE];
   uint64_t next_player_board[BOARD_SIZE];
 
+  // Combined 9-cell window code (the pattern-table index) of every cell on each
+  // of the 4 axes DIRECTIONS[0..3]; the center is always encoded as empty.
+  // Kept in sync by setValueBit, so placements, captures and undos all update it.
+  unsigned int line_codes[4][BOARD_SIZE * BOARD_SIZE];
+
+  // Number of stones within candidate_radius of each cell, and a row bitmask of
+  // the cells where that count is non-zero. Reference counts let a capture
+  // remove a stone without rescanning its neighbours.
+  int candidate_radius;
+  unsigned char neighbor_counts[BOARD_SIZE * BOARD_SIZE];
+  uint64_t neighbor_mask[BOARD_SIZE];
+
   uint64_t currentHash;
 
+  // With symmetric hashing on, symmetry_deltas[s] ^ currentHash is the hash of the
+  // board mapped through symmetry s. Scores and turn hash the same in every
+  // orientation, so only stones change the deltas; [0] is always 0.
+  bool symmetric_hashing;
+  uint64_t symmetry_deltas[BOARD_SYMMETRIES];
+
   void reset_bitboard();
+  void updateSymmetryDeltas(int col, int row, int stone);
+  void updateLineCodes(int col, int row, unsigned int cell);
+  void updateNeighborCounts(int col, int row, int delta);
+  unsigned int extractLineCode(int col, int row, int dx, int dy) const;
   void init_bitboard_from_data(const std::vector<std::vector<char> > &board_data);
 
  public:
@@ -73,6 +132,15 @@ class Board {
   uint64_t *getBitboardByPlayer(int player);                // Get pointer to player's bitboard
   void getOccupancy(uint64_t occupancy[BOARD_SIZE]) const;  // Get combined occupancy
   uint64_t getHash() const;                                 // Get the current Zobrist hash
+  // Smallest hash over the 8 symmetries; `symmetry` maps this board onto that
+  // orientation (see symmetricMove). Without symmetric hashing: getHash() and 0.
+  uint64_t getCanonicalHash(int &symmetry) const;
+  bool getSymmetricHashing() const;
+  void setSymmetricHashing(bool enable);  // turning it on hashes the stones on the board
+  // Empty cells within the candidate radius of any stone, one bitmask per row.
+  void getCandidateMask(uint64_t candidates[BOARD_SIZE]) const;
+  int getCandidateRadius() const;
+  void setCandidateRadius(int radius);  // 1 or 2; recounts from the stones on the board
 
   // Player & Score Information
   int getLastPlayer() const;  // Player who made the last move
@@ -89,8 +157,7 @@ class Board {
   void setValueBit(int col, int row, int stone);      // Place a stone (updates hash internally)
   void storeCapturedStone(int x, int y, int player);  // Record a capture event
   void applyCapture(bool clearCaptureList);           // Process stored captures (updates hash)
-  const std::vector<CapturedStone> &getCapturedStones()
-      const;          // Get list of captures from last move
+  const CaptureList &getCapturedStones() const;  // Get list of captures from last move
   void switchTurn();  // Switches players (updates hash)
   void flushCaptures();
 
@@ -98,6 +165,10 @@ class Board {
   static bool isValidCoordinate(int col, int row);
   static std::string convertIndexToCoordinates(int col, int row);
   unsigned int extractLineAsBits(int x, int y, int dx, int dy, int length) const;
+  // Pattern-table index for the window centered on (col, row) along (dx, dy).
+  unsigned int getLineCode(int col, int row, int dx, int dy) const;
+  // Codes of every cell along axis DIRECTIONS[axis], indexed row * BOARD_SIZE + col.
+  const unsigned int *getLineCodes(int axis) const;
   static unsigned int getCellCount(unsigned int pattern, int windowLength);
 
   // For debug
@@ -111,4 +182,73 @@ class Board {
   void undoMove(const UndoInfo &undo_data);
 };
 
+// (col, row) mapped through a board symmetry, and back.
+inline std::pair<int, int> symmetricMove(int symmetry, int col, int row) {
+  if (symmetry & 4) std::swap(col, row);
+  if (symmetry & 1) col = BOARD_SIZE - 1 - col;
+  if (symmetry & 2) row = BOARD_SIZE - 1 - row;
+  return std::make_pair(col, row);
+}
+
+inline std::pair<int, int> inverseSymmetricMove(int symmetry, int col, int row) {
+  if (symmetry & 1) col = BOARD_SIZE - 1 - col;
+  if (symmetry & 2) row = BOARD_SIZE - 1 - row;
+  if (symmetry & 4) std::swap(col, row);
+  return std::make_pair(col, row);
+}
+
+// Maps a direction vector to its axis in line_codes (0..3), or -1 if the vector
+// points the opposite way (the caller mirrors the code) or is not an axis.
+inline int lineAxisIndex(int dx, int dy) {
+  if (dx == 0 && dy == -1) return 0;
+  if (dx == 1 && dy == -1) return 1;
+  if (dx == 1 && dy == 0) return 2;
+  if (dx == 1 && dy == 1) return 3;
+  return -1;
+}
+
+// Packs the even bits of an 18-bit window code into the low 9 bits. Plain shifts
+// rather than BMI2's pext: the build does not target BMI2, and a runtime check
+// would cost more than these few steps inline.
+inline unsigned int compressCellBits(unsigned int bits) {
+  bits &= 0x15555;
+  bits = (bits | (bits >> 1)) & 0x33333333;
+  bits = (bits | (bits >> 2)) & 0x0F0F0F0F;
+  bits = (bits | (bits >> 4)) & 0x00FF00FF;
+  return (bits | (bits >> 8)) & 0x1FF;
+}
+
+// Bit 4 - k is set where the cell k steps along the axis from the center of a
+// 9-cell window code (k in -4..4) holds `cell`: EMPTY_SPACE, PLAYER_1 or
+// PLAYER_2. Off-board cells match none of them.
+inline unsigned int lineCellMask(unsigned int code, int cell) {
+  unsigned int differ = code ^ (0x15555u * (unsigned int)cell);
+  return compressCellBits(~(differ | (differ >> 1)));
+}
+
+inline bool Board::isValidCoordinate(int col, int row) {
+  return (unsigned int)col < BOARD_SIZE && (unsigned int)row < BOARD_SIZE;
+}
+
+inline int Board::getValueBit(int col, int row) const {
+  if (!isValidCoordinate(col, row)) return OUT_OF_BOUNDS;
+  uint64_t mask = 1ULL << col;
+  if (last_player_board[row] & mask) return PLAYER_1;
+  if (next_player_board[row] & mask) return PLAYER_2;
+  return EMPTY_SPACE;
+}
+
+inline unsigned int Board::getLineCode(int col, int row, int dx, int dy) const {
+  int axis = lineAxisIndex(dx, dy);
+  if (axis >= 0 && isValidCoordinate(col, row)) return line_codes[axis][row * BOARD_SIZE + col];
+  return extractLineCode(col, row, dx, dy);
+}
+
+inline const unsigned int *Board::getLineCodes(int axis) const { return line_codes[axis]; }
+
+inline void Board::getCandidateMask(uint64_t candidates[BOARD_SIZE]) const {
+  for (int i = 0; i < BOARD_SIZE; i++)
+    candidates[i] = neighbor_mask[i] & ~(last_player_board[i] | next_player_board[i]);
+}
+
 #endif  // BOARD_HPP
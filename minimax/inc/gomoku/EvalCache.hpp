@@ -0,0 +1,45 @@
+#ifndef EVALCACHE_HPP
+#define EVALCACHE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EVAL_CACHE_DEFAULT_MB 16
+
+// Direct-mapped cache of evaluator results, shared by all search threads.
+//
+// Each slot is two 64-bit words: `data` packs score(32) | generation(16), and
+// `check` holds key ^ data. As in the transposition table, nothing is locked and
+// a slot torn by a concurrent store reads as a miss. A new entry always replaces
+// the old one. clear() only starts a new generation, and slots of older
+// generations read as misses.
+class EvalCache {
+ public:
+  explicit EvalCache(size_t megabytes = EVAL_CACHE_DEFAULT_MB);
+  ~EvalCache();
+
+  // Reallocates to the largest power-of-two slot count that fits in `megabytes`;
+  // 0 turns the cache off. Must not be called while a search is running.
+  bool resize(size_t megabytes);
+  void clear();
+
+  bool probe(uint64_t key, int &score) const;
+  void store(uint64_t key, int score);
+
+  size_t sizeInBytes() const { return slotCount_ * sizeof(Slot); }
+
+ private:
+  struct Slot {
+    uint64_t check;
+    uint64_t data;
+  };
+
+  Slot *slots_;
+  size_t slotCount_;
+  uint16_t generation_;  // never 0, so zeroed slots are misses
+
+  EvalCache(const EvalCache &);
+  EvalCache &operator=(const EvalCache &);
+};
+
+#endif  // EVALCACHE_HPP
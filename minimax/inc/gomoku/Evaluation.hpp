@@ -3,6 +3,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <utility>
+
+#include "Gomoku.hpp"
 
 class Board;
 
@@ -57,9 +60,9 @@ class Board;
 #define SIDE_WINDOW_SIZE 4
 // Combined window size always equals 2*SIDE_WINDOW_SIZE + 1 (center cell + cells on both sides).
 #define COMBINED_WINDOW_SIZE (2 * SIDE_WINDOW_SIZE + 1)
-// - Shifting 1 left by (2 * COMBINED_WINDOW_SIZE) is equivalent to 2^(2 * COMBINED_WINDOW_SIZE),
-//   which is the total number of unique patterns that can be represented.
-#define LOOKUP_TABLE_SIZE (1 << (2 * COMBINED_WINDOW_SIZE))
+// The center of a combined window is always empty, so pattern tables are indexed by the two
+// sides only: 2^(2 * 2 * SIDE_WINDOW_SIZE) entries (see patternIndex).
+#define LOOKUP_TABLE_SIZE (1 << (4 * SIDE_WINDOW_SIZE))
 
 namespace Evaluation {
 
@@ -121,6 +124,34 @@ struct PatternCounts {
         perfect(0) {}
 };
 
+// Per-axis pattern facts precomputed for one side window pair, always from PLAYER_1's point of
+// view (player 2 looks up the color-swapped index). Counters never exceed 3 on one axis.
+struct PatternEntry {
+  int16_t score;
+
+  // attack
+  uint8_t gomokuCount;
+  uint8_t openFourCount;
+  uint8_t closedFourCount;
+  uint8_t openThreeCount;
+  uint8_t closedThreeCount;
+  uint8_t openTwoCount;
+  uint8_t captureCount;
+
+  // block
+  uint8_t gomokuBlockCount;
+  uint8_t closedThreeBlockCount;
+  uint8_t openThreeBlockCount;
+  uint8_t openTwoBlockCount;
+  uint8_t openOneBlockCount;
+  uint8_t emptyThenOpenTwoBlockCount;
+
+  // capture
+  uint8_t captureVulnerable;
+  uint8_t captureBlockCount;
+  uint8_t captureThreatCount;
+};
+
 struct EvaluationEntry {
   int score;
   PatternCounts counts;
@@ -128,43 +159,54 @@ struct EvaluationEntry {
   EvaluationEntry() : score(0), counts() {}
 
   EvaluationEntry(int s, const PatternCounts &pc) : score(s), counts(pc) {}
-  // Overload operator += to combine two EvaluationEntries.
-  EvaluationEntry &operator+=(const EvaluationEntry &other) {
+  // Accumulate one axis worth of table counters.
+  EvaluationEntry &operator+=(const PatternEntry &other) {
     score += other.score;
-    counts.openFourCount += other.counts.openFourCount;
-    counts.closedFourCount += other.counts.closedFourCount;
-    counts.openThreeCount += other.counts.openThreeCount;
-    counts.closedThreeCount += other.counts.closedThreeCount;
-    counts.openTwoCount += other.counts.openTwoCount;
-    counts.emptyThenOpenTwoBlockCount += other.counts.emptyThenOpenTwoBlockCount;
-    counts.captureCount += other.counts.captureCount;
-    counts.fourBlockCount += other.counts.fourBlockCount;
-    counts.gomokuBlockCount += other.counts.gomokuBlockCount;
-    counts.openThreeBlockCount += other.counts.openThreeBlockCount;
-    counts.openTwoBlockCount += other.counts.openTwoBlockCount;
-    counts.openOneBlockCount += other.counts.openOneBlockCount;
-    counts.closedThreeBlockCount += other.counts.closedThreeBlockCount;
-    counts.captureVulnerable += other.counts.captureVulnerable;
-    counts.captureBlockCount += other.counts.captureBlockCount;
-    counts.captureThreatCount += other.counts.captureThreatCount;
-    counts.captureCriticalCount += other.counts.captureCriticalCount;
-    counts.captureBlockCriticalCount += other.counts.captureBlockCriticalCount;
-    counts.captureWin += other.counts.captureWin;
-    counts.gomokuCount += other.counts.gomokuCount;
-    counts.fixBreakableGomoku += other.counts.fixBreakableGomoku;
-    counts.perfectCritical += other.counts.perfectCritical;
-    counts.perfect += other.counts.perfect;
+    counts.gomokuCount += other.gomokuCount;
+    counts.openFourCount += other.openFourCount;
+    counts.closedFourCount += other.closedFourCount;
+    counts.openThreeCount += other.openThreeCount;
+    counts.closedThreeCount += other.closedThreeCount;
+    counts.openTwoCount += other.openTwoCount;
+    counts.captureCount += other.captureCount;
+    counts.gomokuBlockCount += other.gomokuBlockCount;
+    counts.closedThreeBlockCount += other.closedThreeBlockCount;
+    counts.openThreeBlockCount += other.openThreeBlockCount;
+    counts.openTwoBlockCount += other.openTwoBlockCount;
+    counts.openOneBlockCount += other.openOneBlockCount;
+    counts.emptyThenOpenTwoBlockCount += other.emptyThenOpenTwoBlockCount;
+    counts.captureVulnerable += other.captureVulnerable;
+    counts.captureBlockCount += other.captureBlockCount;
+    counts.captureThreatCount += other.captureThreatCount;
     return *this;
   }
 };
 
-const EvaluationEntry INVALID_ENTRY(INVALID_PATTERN, PatternCounts());
+// Active tables, LOOKUP_TABLE_SIZE entries each. They point either at the tables generated by
+// initCombinedPatternScoreTables*() or into a file mapped by mapPatternTables().
+extern const int *patternScoreTable;
+extern const PatternEntry *patternTable;
 
-extern int patternScoreTablePlayerOne[LOOKUP_TABLE_SIZE];
-extern int patternScoreTablePlayerTwo[LOOKUP_TABLE_SIZE];
+// Drops the (always empty) center cell from a combined window.
+inline unsigned int patternIndex(unsigned int combined) {
+  return ((combined >> (2 * (SIDE_WINDOW_SIZE + 1))) << (2 * SIDE_WINDOW_SIZE)) |
+         (combined & ((1u << (2 * SIDE_WINDOW_SIZE)) - 1));
+}
 
-static EvaluationEntry patternPlayerOne[LOOKUP_TABLE_SIZE];
-static EvaluationEntry patternPlayerTwo[LOOKUP_TABLE_SIZE];
+// Exchanges PLAYER_1 and PLAYER_2 cells (01 <-> 10); empty and out-of-board cells stay put.
+inline unsigned int swapPatternPlayers(unsigned int index) {
+  unsigned int differ = (index ^ (index >> 1)) & 0x55555555u;
+  return index ^ (differ | (differ << 1));
+}
+
+inline unsigned int playerPatternIndex(unsigned int combined, int player) {
+  unsigned int index = patternIndex(combined);
+  return player == PLAYER_1 ? index : swapPatternPlayers(index);
+}
+
+inline const PatternEntry &lookupPattern(unsigned int combined, int player) {
+  return patternTable[playerPatternIndex(combined, player)];
+}
 
 static const int continuousScores[6] = {
     0, CONTINUOUS_LINE_1, CONTINUOUS_LINE_2, CONTINUOUS_LINE_3, CONTINUOUS_LINE_4, GOMOKU};
@@ -184,12 +226,35 @@ void slideWindowContinuous(int side, int player, bool reverse, int &continuous,
 void initCombinedPatternScoreTables();
 void initCombinedPatternScoreTablesHard();
 
+// Pattern table file (PatternTableFile.cpp). Bump the version whenever the table generators
+// change what they compute.
+#define PATTERN_TABLE_FILE_VERSION 1
+// Writes the active tables to `path`.
+bool writePatternTables(const char *path);
+// Maps a file written by writePatternTables() read-only and makes it the active tables.
+bool mapPatternTables(const char *path);
+// Maps `path` when given and valid, otherwise generates the tables.
+void initPatternTables(const char *path);
+// Hash of the scoring constants; files of tables or scores derived from them carry it.
+uint64_t scoringFingerprint();
+
 int checkVPattern(Board *board, int player, int x, int y, int i);
 int checkCapture(unsigned int side, unsigned int player);
+// evaluatePosition's score of one axis with captures on: the table score plus the
+// capture bonus for the checkCapture() results of the two sides of the window.
+int addCaptureScore(Board *board, int player, int score, int forwardCapture, int backwardCapture);
 
 unsigned int reversePattern(unsigned int pattern, int windowSize);
 
 int evaluatePosition(Board *board, int player, int x, int y);
+// Scores `count` moves of `player` exactly as evaluatePosition would, into
+// scores[0..count). The window codes and table scores of up to 8 moves at a time
+// come from AVX2 gathers when the CPU supports them (see setBatchSimd).
+void evaluatePositionBatch(Board *board, int player, const std::pair<int, int> *moves, int count,
+                           int *scores);
+// Lets evaluatePositionBatch use AVX2 if the CPU has it (default), or forces the
+// scalar path. Returns whether AVX2 is used from now on.
+bool setBatchSimd(bool enable);
 
 int evaluatePositionHard(Board *board, int player, int x, int y);
 
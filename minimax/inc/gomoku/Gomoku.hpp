@@ -5,7 +5,6 @@
 
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
-#include <ctime>
 #include <iostream>
 
 #define PLAYER_1 1
@@ -52,6 +51,11 @@ inline unsigned int pack_cells_1(unsigned int a) { return a; }
  */
 
 typedef uint64_t ZobristKey;
+// The keys are drawn from a fixed seed, so a position hashes the same in every
+// process and TT snapshots survive a restart. Bump the version whenever the seed
+// or the way keys are drawn changes: it invalidates every snapshot.
+#define ZOBRIST_SEED 0x2545f491u
+#define ZOBRIST_KEY_VERSION 1
 namespace Zobrist {
 extern ZobristKey piece_keys[BOARD_SIZE][BOARD_SIZE][3];  //
 extern ZobristKey capture_keys[3][7 + 1];  // [player 0-2][score 0-7]: 7 = max UI capture goal, +1 for zero-indexed
@@ -2,7 +2,6 @@
 #define MINMAX_HPP
 
 #include <algorithm>
-#include <boost/unordered_map.hpp>
 #include <cmath>
 #include <limits>
 #include <string>
@@ -10,36 +9,74 @@
 #include <vector>
 
 #include "Board.hpp"
+#include "EvalCache.hpp"
+#include "ForbiddenPointFinder.h"
 #include "Gomoku.hpp"
 #include "Rules.hpp"
+#include "ThreatSearch.hpp"
+#include "TimeManager.hpp"
+#include "TranspositionTable.hpp"
 
 #define MAX_DEPTH 10
-// Bound types used for alpha-beta entries.
-enum BoundType { EXACT, LOWERBOUND, UPPERBOUND };
-
-// Structure for transposition table entries.
-struct TTEntry {
-  int score;                     // Evaluation score
-  int depth;                     // Depth at which the evaluation was computed
-  std::pair<int, int> bestMove;  // Best move from this state (if available)
-  BoundType flag;                // Flag indicating whether score is EXACT, a lower, or upper bound.
-
-  TTEntry() : score(0), depth(-1), bestMove(-1, -1), flag(EXACT) {}
-
-  // Parameterized constructor for convenience
-  TTEntry(int s, int d, std::pair<int, int> mv, BoundType f)
-      : score(s), depth(d), bestMove(mv), flag(f) {}
-};
-
+// Per-move search budgets of the timed difficulties, in milliseconds.
+#define MEDIUM_TIME_LIMIT_MS 400
+#define HARD_TIME_LIMIT_MS 2000
+// Initial half-width of the root aspiration window; it grows 4x per failure.
+#define ASPIRATION_WINDOW 512
+// Upper bound for Lazy-SMP search threads (main thread included).
+#define MAX_SEARCH_THREADS 64
+// Null-move pruning and late-move reduction defaults. Both reductions stay even:
+// leaf scores rate the last move for the side that played it, so a reduced
+// search must end on the same side as a full one.
+#define NULL_MOVE_REDUCTION 2
+#define NULL_MOVE_MIN_DEPTH 4
+// Quiet moves after the first LMR_FULL_DEPTH_MOVES are searched LMR_REDUCTION
+// plies shallower at nodes with at least LMR_MIN_DEPTH plies left.
+#define LMR_MIN_DEPTH 4
+#define LMR_FULL_DEPTH_MOVES 4
+#define LMR_REDUCTION 2
+// Plies of quiescence below depth 0: the threat quiescence (fours, four-blocks,
+// captures) and the capture quiescence of minimax().
+#define QUIESCENCE_MAX_PLY 8
 struct ScoredMove {
   int score;
   std::pair<int, int> move;
   bool is_killer;
+  int history;  // history + countermove bonus; breaks ties between equal scores
 
   // Constructor (C++98 style)
-  ScoredMove(int s, std::pair<int, int> m, bool ik) : score(s), move(m), is_killer(ik) {}
+  ScoredMove() : score(0), move(-1, -1), is_killer(false), history(0) {}
+  ScoredMove(int s, std::pair<int, int> m, bool ik, int h = 0)
+      : score(s), move(m), is_killer(ik), history(h) {}
 };
 
+// Every square of the board: an upper bound on the moves of any node.
+#define MAX_MOVES (BOARD_SIZE * BOARD_SIZE)
+
+// Fixed-capacity list for move generation and ordering; lets the search run
+// without touching the allocator. Iterators are plain pointers, so std::sort
+// and std::rotate work on it directly.
+template <typename T>
+struct FixedMoveList {
+  T items[MAX_MOVES];
+  int count;
+
+  FixedMoveList() : count(0) {}
+  void clear() { count = 0; }
+  void push_back(const T& item) { items[count++] = item; }
+  bool empty() const { return count == 0; }
+  size_t size() const { return (size_t)count; }
+  T& operator[](size_t i) { return items[i]; }
+  const T& operator[](size_t i) const { return items[i]; }
+  T* begin() { return items; }
+  T* end() { return items + count; }
+  const T* begin() const { return items; }
+  const T* end() const { return items + count; }
+};
+
+typedef FixedMoveList<std::pair<int, int> > MoveList;
+typedef FixedMoveList<ScoredMove> ScoredMoveList;
+
 struct SearchResult {
   std::pair<int, int> bestMove;
   int score;
@@ -50,49 +87,177 @@ struct SearchResult {
 
 typedef int (*EvalFn)(Board*, int, int, int);
 
-// Shared transposition table storage used by search and request handlers.
-extern boost::unordered_map<uint64_t, TTEntry> transTable;
+// State of an iterativeDeepening search after a completed iteration.
+struct SearchProgress {
+  int depth;
+  std::pair<int, int> bestMove;
+  int score;
+  unsigned long long nodes;  // main-thread nodes so far
+  double elapsedMs;
+};
+
+typedef void (*ProgressFn)(const SearchProgress& progress, void* arg);
+
+// Pruning switches of pvs(). Read by every search thread, so change them only
+// between searches. Reductions must be even (see NULL_MOVE_REDUCTION).
+// Both are off by default: with the per-move evaluators, iterative deepening
+// already reuses most of the tree through the TT, and in the benchmark scenarios
+// the null searches and re-searches cost more nodes than they save.
+// `quiescence` runs the threat quiescence search at depth 0 of minimax() and pvs().
+// `symmetricHashing` keys the TT and the threat cache by the canonical hash over
+// the 8 board symmetries, so mirrored positions share entries.
+struct SearchTuning {
+  bool quiescence;
+  bool nullMove;
+  int nullMoveReduction;
+  int nullMoveMinDepth;
+  bool lateMoveReductions;
+  int lmrMinDepth;
+  int lmrFullDepthMoves;
+  int lmrReduction;
+  bool symmetricHashing;
+
+  SearchTuning()
+      : quiescence(true),
+        nullMove(false),
+        nullMoveReduction(NULL_MOVE_REDUCTION),
+        nullMoveMinDepth(NULL_MOVE_MIN_DEPTH),
+        lateMoveReductions(false),
+        lmrMinDepth(LMR_MIN_DEPTH),
+        lmrFullDepthMoves(LMR_FULL_DEPTH_MOVES),
+        lmrReduction(LMR_REDUCTION),
+        symmetricHashing(false) {}
+};
+
+// Everything the searches of one game share: the tables, the settings, and the
+// bookkeeping of the current search. The server gives every websocket session
+// its own context, so concurrent games never clear or overwrite each other's
+// entries. Zobrist keys and pattern tables stay process-wide: they do not change
+// after startup. Searches on one context must not overlap.
+struct EngineContext {
+  TranspositionTable transTable;
+  EvalCache evalCache;  // evaluator results of every search thread
+  ThreatSearch::Cache threatCache;
+  SearchTuning tuning;  // read by every search thread, so change it only between searches
+
+  // Set by each search (see beginSearch in Minimax.cpp).
+  unsigned int rules;    // rule set the tables were filled under
+  uint64_t evalSalt;     // evaluator id, mixed into eval cache keys
+  uint64_t keySalt;      // evaluator and root side, mixed into TT keys
+  double searchStartMs;  // TimeManager::nowMs() at the last search start (0 = none yet)
+  unsigned long long nodes;
+  unsigned long long evalProbes;
+  unsigned long long evalHits;
+  SearchResult result;  // of the last iterativeDeepening call
+  // Called on the main search thread after each iteration iterativeDeepening
+  // completes, with `progressArg` (NULL = none). Set it between searches.
+  ProgressFn progress;
+  void* progressArg;
+
+  explicit EngineContext(size_t ttMegabytes = TT_DEFAULT_MB,
+                         size_t evalCacheMegabytes = EVAL_CACHE_DEFAULT_MB);
+
+ private:
+  EngineContext(const EngineContext&);
+  EngineContext& operator=(const EngineContext&);
+};
+
+// Per-thread search state. The main thread and every Lazy-SMP helper own one;
+// only the tables of their EngineContext are shared between threads.
+struct SearchThread {
+  EngineContext* context;
+  int id;  // 0 = main thread, 1.. = helpers
+  std::pair<int, int> killerMoves[MAX_DEPTH + 1][2];
+  // Butterfly history per player and square, and per player the reply that last
+  // refuted each opponent square. Both are updated on beta cutoffs.
+  int history[2][MAX_MOVES];
+  std::pair<int, int> counterMoves[2][MAX_MOVES];
+  // Move buffers indexed by remaining depth, like killerMoves: the current path
+  // has at most one node per depth, so a node's lists stay intact while its
+  // children search.
+  MoveList moveStack[MAX_DEPTH + 1];
+  ScoredMoveList scoredStack[MAX_DEPTH + 1];
+  MoveList quiescenceStack[QUIESCENCE_MAX_PLY];  // indexed by quiescence ply
+  CForbiddenPointFinder finder;  // scratch for double-three checks
+  ThreatSearch::Solver threats;  // VCF/VCT solver for the root and interior probes
+  volatile bool* stop;  // raised by the main thread to abort helpers (NULL for the main thread)
+  unsigned long long nodes;
+  unsigned long long evalProbes;  // evaluator calls, and those answered by the eval cache
+  unsigned long long evalHits;
+  TimeManager* timer;  // search limits, polled per node (main thread only; NULL = none)
+
+  explicit SearchThread(EngineContext& engine, int threadId = 0, volatile bool* stopFlag = NULL);
+  bool aborted() const { return (timer != NULL && timer->stopped()) || (stop != NULL && *stop); }
+};
 
 namespace Minimax {
 
-void initKillerMoves();
-std::vector<std::pair<int, int> > generateCandidateMoves(Board*& board);
+// Fills `moves`; `finder` is scratch space for the double-three check.
+void generateCandidateMoves(Board*& board, MoveList& moves, CForbiddenPointFinder& finder);
+
+void printBoardWithCandidates(Board*& board, const MoveList& candidates);
 
-void printBoardWithCandidates(Board*& board, const std::vector<std::pair<int, int> >& candidates);
+// Nodes visited by every thread of the most recent getBestMove, getBestMovePVS
+// or iterativeDeepening call on `engine`.
+unsigned long long lastSearchNodes(const EngineContext& engine);
+// Evaluator calls of the same search, and how many of them the cache answered.
+unsigned long long lastEvalProbes(const EngineContext& engine);
+unsigned long long lastEvalHits(const EngineContext& engine);
+// Move, root score and completed depth of the most recent iterativeDeepening call.
+SearchResult lastSearchResult(const EngineContext& engine);
+// The opponent reply the most recent search expects: the transposition-table move
+// of `board`, the position after that search's move. False when there is none.
+bool predictReply(const EngineContext& engine, const Board* board, std::pair<int, int>& reply);
+// Warm restarts: writes the deep entries of the transposition table to `path`
+// (between searches), or loads such a file into a fresh context. The snapshot
+// keeps the rule set it was searched under, so searches under the same rules
+// use the loaded entries. To warm several contexts of one size, read the file
+// once and restore it into each. A missing, mismatched or corrupt file, or one
+// larger than the table of `engine`, is not read: the context starts cold.
+// Saving several contexts merges those under the rule set of the one that
+// searched last, keeping the deepest entries that fit its table.
+bool saveTTSnapshot(const EngineContext& engine, const char* path);
+bool saveTTSnapshot(const std::vector<const EngineContext*>& engines, const char* path);
+bool loadTTSnapshot(EngineContext& engine, const char* path);
+bool readTTSnapshot(const EngineContext& engine, const char* path, TTSnapshot& snapshot);
+void restoreTTSnapshot(EngineContext& engine, const TTSnapshot& snapshot);
 
-std::pair<int, int> getBestMove(Board* board, int depth, EvalFn evalFn);
-std::pair<int, int> getBestMovePVS(Board* board, int depth, EvalFn evalFn);
-std::pair<int, int> iterativeDeepening(Board* board, int maxDepth, double timeLimitSeconds,
-                                       EvalFn evalFn);
+// `threads` is the total Lazy-SMP thread count (1 = single-threaded search).
+// A search stopped by `limits` returns the best root move it finished.
+std::pair<int, int> getBestMove(EngineContext& engine, Board* board, int depth, EvalFn evalFn,
+                                int threads = 1, const SearchLimits& limits = SearchLimits());
+std::pair<int, int> getBestMovePVS(EngineContext& engine, Board* board, int depth, EvalFn evalFn,
+                                   int threads = 1);
+// Iterative-deepening PVS with aspiration windows (medium and hard). Returns the
+// best move of the deepest iteration that completed within `limits`.
+std::pair<int, int> iterativeDeepening(EngineContext& engine, Board* board, int maxDepth,
+                                       const SearchLimits& limits, EvalFn evalFn,
+                                       int threads = 1);
 
 int minimax(Board* board, int depth, int alpha, int beta, int currentPlayer, int lastX, int lastY,
-            bool isMaximizing, EvalFn evalFn);
+            bool isMaximizing, EvalFn evalFn, SearchThread& thread);
+int pvs(Board* board, int depth, int alpha, int beta, int currentPlayer, int lastX, int lastY,
+        bool isMaximizing, EvalFn evalFn, SearchThread& thread);
 
-bool probeTT(Board* board, int depth, int& alpha, int& beta, std::pair<int, int>& bestMove,
-             int& scoreOut);
-void storeTT(uint64_t hash, int depth, const std::pair<int, int>& bestMove, int score, int alpha0,
-             int beta);
+bool probeTT(EngineContext& engine, Board* board, int depth, int& alpha, int& beta,
+             std::pair<int, int>& bestMove, int& scoreOut);
+// `key` and `symmetry` as returned for the node's board by its canonical hash.
+void storeTT(EngineContext& engine, uint64_t key, int symmetry, int depth,
+             const std::pair<int, int>& bestMove, int score, int alpha0, int beta);
 
-void scoreAndSortMoves(Board* board, const std::vector<std::pair<int, int> >& in, int player,
-                       int depth, bool maxSide, std::vector<ScoredMove>& out, EvalFn evalFn);
+// (lastX, lastY) is the opponent's previous move, or (-1, -1) at the root.
+void scoreAndSortMoves(Board* board, const MoveList& in, int player, int depth, bool maxSide,
+                       int lastX, int lastY, ScoredMoveList& out, EvalFn evalFn,
+                       SearchThread& thread);
 
 bool processHashMove(Board* board, const std::pair<int, int>& mv, int depth, int& alpha, int& beta,
                      bool isMaximizing, std::pair<int, int>& bestMoveOut, int& bestEvalOut,
-                     EvalFn evalFn);
+                     EvalFn evalFn, SearchThread& thread);
 
-// Timer-aware root search (used by iterativeDeepening).
+// Alpha-beta root search; returns true when the thread's limits cut it short.
 bool rootSearch(Board* board, int depth, int& alpha, int& beta, bool isMaximizing,
-                std::pair<int, int>& bestMoveOut, int& bestScoreOut, clock_t startTime,
-                clock_t timeLimitClocks, bool& timedOut, EvalFn evalFn);
-
-// Timer-free overload (used by getBestMove).
-inline bool rootSearch(Board* board, int depth, int& alpha, int& beta, bool isMaximizing,
-                       std::pair<int, int>& bestMoveOut, int& bestScoreOut, EvalFn evalFn) {
-  bool dummyTimedOut = false;
-  return rootSearch(board, depth, alpha, beta, isMaximizing, bestMoveOut, bestScoreOut,
-                    /*startTime=*/0,
-                    /*timeLimitClocks=*/std::numeric_limits<clock_t>::max(), dummyTimedOut, evalFn);
-}
+                std::pair<int, int>& bestMoveOut, int& bestScoreOut, EvalFn evalFn,
+                SearchThread& thread);
 
 }  // namespace Minimax
 
@@ -0,0 +1,64 @@
+#ifndef OPENINGBOOK_HPP
+#define OPENINGBOOK_HPP
+
+#include <stdint.h>
+
+#include <utility>
+
+#include "Board.hpp"
+#include "TimeManager.hpp"
+
+// Bump whenever the entry layout or the key scheme changes; older files are rejected.
+#define OPENING_BOOK_FILE_VERSION 1
+// Boards with more stones are never looked up, so the key is not even computed.
+#define OPENING_BOOK_MAX_STONES 12
+// Builder defaults: book positions up to this many stones, searched for this long.
+#define OPENING_BOOK_BUILD_STONES 6
+#define OPENING_BOOK_SEARCH_MS 10000
+
+namespace OpeningBook {
+
+// One book move. Entries are sorted by key, heaviest first within a key; the
+// move is stored in the orientation of the canonical key (see canonicalKey).
+struct Entry {
+  uint64_t key;
+  int32_t score;    // search score of the move, higher is better for the side to move
+  uint16_t weight;  // how many builder lines reached the position
+  uint8_t col;
+  uint8_t row;
+};
+
+// Position key shared by all 8 symmetries and both stone colors: stones are keyed
+// as "side to move" and "opponent", together with the capture scores and the rules.
+// `symmetry` receives the transform that maps the board onto the canonical one.
+// Returns false when the board cannot be in the book (too many stones, scores
+// beyond the key table).
+bool canonicalKey(const Board &board, uint64_t &key, int &symmetry);
+
+// Book move for the side to move, if the mapped book has one.
+bool lookup(const Board &board, std::pair<int, int> &move);
+size_t entryCount();
+
+// Maps a file written by build() read-only and makes it the active book.
+bool mapBook(const char *path);
+// Maps `path` when set; without a book every lookup misses.
+void initBook(const char *path);
+
+struct BuildOptions {
+  int maxStones;  // deepest book position, in stones on the board
+  int workers;    // search processes
+  SearchLimits limits;
+
+  BuildOptions();
+};
+
+// Offline builder: expands the tree from the center opening under the default
+// rules (captures, double three, goal 5). Every position where the engine is to
+// move gets the move of a hard-difficulty search, and every reply of the
+// opponent is followed up. Searches run in `workers` forked processes, since the
+// engine keeps its search state in globals.
+bool build(const char *path, const BuildOptions &options);
+
+}  // namespace OpeningBook
+
+#endif  // OPENINGBOOK_HPP
@@ -1,13 +1,23 @@
 #ifndef RULES_HPP
 #define RULES_HPP
 
+#include <stdint.h>
+
+#include "Gomoku.hpp"
+
 class Board;
+class CForbiddenPointFinder;
 class Rules {
  public:
   static bool detectCaptureStones(Board &board, int x, int y, int player);
   static bool detectCaptureStonesNotStore(Board &board, int x, int y, int player);
 
   static bool detectDoublethree(Board &board, int x, int y, int player);
+  // Row bitmask version: sets in `forbidden` every cell of `cells` where `player`
+  // would make a double three. The position is loaded into `finder` (scratch,
+  // reset here) at most once.
+  static void detectDoublethreeMask(Board &board, int player, const uint64_t cells[BOARD_SIZE],
+                                    uint64_t forbidden[BOARD_SIZE], CForbiddenPointFinder &finder);
   static bool isWinningMove(Board *board, int player, int x, int y);
 };
 
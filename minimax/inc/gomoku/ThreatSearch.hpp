@@ -0,0 +1,116 @@
+#ifndef THREATSEARCH_HPP
+#define THREATSEARCH_HPP
+
+#include <stdint.h>
+
+#include <utility>
+
+#include "Board.hpp"
+#include "ForbiddenPointFinder.h"
+#include "Gomoku.hpp"
+
+// Longest attack the root solver tries, in attacker moves.
+#define VCF_MAX_DEPTH 10
+#define VCT_MAX_DEPTH 4
+// Interior probes: fours only, at nodes with at least this much depth left.
+#define VCF_PROBE_DEPTH 4
+#define THREAT_PROBE_MIN_DEPTH 5
+// Node budgets of one solver call; an exhausted budget proves nothing.
+#define THREAT_NODE_LIMIT 20000
+#define THREAT_PROBE_NODE_LIMIT 500
+// Solver results are cached by Zobrist hash in 2^THREAT_CACHE_BITS slots.
+#define THREAT_CACHE_BITS 16
+// Deepest solver ply (attacker and defender moves).
+#define THREAT_MAX_PLY (2 * VCF_MAX_DEPTH + 2)
+
+namespace ThreatSearch {
+
+enum Mode {
+  VCF,  // victory by continuous fours
+  VCT   // victory by continuous fours and open threes
+};
+
+// One move list per solver ply; one entry per square at most.
+struct ThreatMoveList {
+  std::pair<int, int> items[BOARD_SIZE * BOARD_SIZE];
+  int count;
+
+  ThreatMoveList() : count(0) {}
+  void clear() { count = 0; }
+  void push_back(const std::pair<int, int> &item) { items[count++] = item; }
+  size_t size() const { return (size_t)count; }
+  const std::pair<int, int> &operator[](size_t i) const { return items[i]; }
+};
+
+// Solver results by canonical hash, shared by the solvers of one engine context.
+// Same lock-free layout as the transposition table: `check` holds key ^ data,
+// so a slot torn by a concurrent store reads as a miss. The rules (goal,
+// captures, double three) are not part of the board hash, so a rule change
+// must clear the cache.
+class Cache {
+ public:
+  Cache();
+  ~Cache();
+
+  void clear();
+  // A proven win holds for any deeper request, a failure for any shallower one.
+  // Moves are cached in the orientation of the board's canonical hash: `symmetry`
+  // maps the searched board onto it (0 without symmetric hashing).
+  bool probe(uint64_t key, int symmetry, int depth, bool &win, std::pair<int, int> &move) const;
+  void store(uint64_t key, int symmetry, int depth, bool win, const std::pair<int, int> &move);
+
+ private:
+  struct Slot {
+    uint64_t data;
+    uint64_t check;
+  };
+
+  Slot *slots_;
+
+  Cache(const Cache &);
+  Cache &operator=(const Cache &);
+};
+
+// Threat-space solver. The attacker only plays moves that make a four (VCF) or
+// an open three (VCT), classified with the pattern tables, and the defender
+// only the replies that can stop them: blocking the line, capturing one of its
+// stones or threatening to, and, against a three, a four of its own. A five
+// wins only if none of its stones can be captured and the defender cannot
+// reach the capture goal, so a breakable four is not forcing.
+//
+// One solver per search thread: it owns scratch space for move lists and
+// double-three checks. Results are shared between threads through `cache`.
+class Solver {
+ public:
+  explicit Solver(Cache &cache);
+
+  // True when the side to move wins by force within `maxDepth` attacker moves;
+  // `move` receives the first move. False means "not proven", not a loss.
+  bool findWin(Board *board, Mode mode, int maxDepth, unsigned long long nodeLimit,
+               std::pair<int, int> &move);
+  // Nodes visited by the last findWin call.
+  unsigned long long nodes() const { return nodes_; }
+
+ private:
+  Cache &cache_;
+  CForbiddenPointFinder finder_;
+  ThreatMoveList lists_[THREAT_MAX_PLY];
+  Mode mode_;
+  unsigned long long nodes_;
+  unsigned long long nodeLimit_;
+  bool aborted_;
+  std::pair<int, int> rootMove_;
+
+  bool attack(Board *board, int depth, int ply);
+  bool defend(Board *board, int col, int row, int depth, bool threes, int ply);
+  bool isForbidden(Board *board, int player, int col, int row);
+  bool findImmediateWin(Board *board, bool strict, std::pair<int, int> *move);
+  bool winsAfterPass(Board *board, const ThreatMoveList &fivePoints);
+
+  Solver(const Solver &);
+  Solver &operator=(const Solver &);
+};
+
+}  // namespace ThreatSearch
+
+#endif  // THREATSEARCH_HPP
@@ -0,0 +1,105 @@
+#ifndef TIMEMANAGER_HPP
+#define TIMEMANAGER_HPP
+
+#include <stddef.h>
+
+// The clock is read once per this many nodes.
+#define TM_POLL_INTERVAL 1024
+// Iterative deepening starts no new depth past this fraction of the time limit:
+// the next iteration would almost never finish in what is left.
+#define TM_SOFT_TIME_RATIO 0.5
+
+// Flags one thread raises for a search running on another (SearchLimits::cancel
+// and ponderHit). What the raising thread wrote before storeFlag is visible to a
+// thread whose loadFlag sees the flag.
+inline bool loadFlag(const volatile bool *flag) { return __atomic_load_n(flag, __ATOMIC_ACQUIRE); }
+inline void storeFlag(volatile bool *flag, bool value) {
+  __atomic_store_n(flag, value, __ATOMIC_RELEASE);
+}
+
+// Limits for one search. Zero disables a limit.
+struct SearchLimits {
+  double hardMs;             // abort the search once this much time has passed
+  double softMs;             // start no new iteration after this much time
+  unsigned long long nodes;  // abort after this many main-thread nodes
+  // Abort once another thread sets *cancel (NULL = never). Checked at every node,
+  // so a cancelled search stops within milliseconds.
+  const volatile bool *cancel;
+  // Pondering (NULL = a normal search): until another thread sets *ponderHit the
+  // search runs on the opponent's time, stopped only by `cancel` and `ponderMs`.
+  // From the hit on, the limits above apply with the clock and the node count
+  // restarted at the hit, so the search before it is free and the completed
+  // iterations are kept.
+  const volatile bool *ponderHit;
+  double ponderMs;
+
+  SearchLimits()
+      : hardMs(0.0), softMs(0.0), nodes(0), cancel(NULL), ponderHit(NULL), ponderMs(0.0) {}
+
+  // Hard deadline `ms` with the default soft target.
+  static SearchLimits fromTime(double ms) {
+    SearchLimits limits;
+    limits.hardMs = ms;
+    limits.softMs = ms * TM_SOFT_TIME_RATIO;
+    return limits;
+  }
+};
+
+// Enforces SearchLimits for the main search thread. Time is taken from
+// CLOCK_MONOTONIC, so it is neither the CPU time of every thread (clock()) nor
+// affected by wall-clock adjustments. The node budget does not depend on the
+// clock at all, which makes single-threaded searches reproducible.
+class TimeManager {
+ public:
+  TimeManager();
+
+  void start(const SearchLimits &limits);
+  double elapsedMs() const;
+
+  // Called once per node with the thread's node count; true once a hard limit is hit.
+  bool poll(unsigned long long nodes);
+  bool stopped() const { return stopped_; }
+  // False once the soft target (or a hard limit) has passed; `nodes` as for poll.
+  bool canStartIteration(unsigned long long nodes);
+
+  const SearchLimits &limits() const { return limits_; }
+
+  // Milliseconds on the monotonic clock.
+  static double nowMs();
+
+ private:
+  SearchLimits limits_;
+  double startMs_;
+  unsigned long long startNodes_;     // node count the node limit counts from
+  unsigned long long nextPollNodes_;  // read the clock again at this node count
+  bool stopped_;
+  bool pondering_;  // no ponder hit seen yet
+
+  // Ends pondering once the hit has come; true if it has.
+  bool takePonderHit(unsigned long long nodes);
+  void pollPonder(unsigned long long nodes);
+  // True once per TM_POLL_INTERVAL nodes. Node counts jump by whole threat
+  // solver runs, so this compares instead of testing for a multiple.
+  bool clockDue(unsigned long long nodes);
+};
+
+inline bool TimeManager::poll(unsigned long long nodes) {
+  if (stopped_) return true;
+  if (limits_.cancel != NULL && loadFlag(limits_.cancel))
+    stopped_ = true;
+  else if (pondering_)
+    pollPonder(nodes);
+  else if (limits_.nodes > 0 && nodes - startNodes_ >= limits_.nodes)
+    stopped_ = true;
+  else if (limits_.hardMs > 0.0 && clockDue(nodes) && elapsedMs() >= limits_.hardMs)
+    stopped_ = true;
+  return stopped_;
+}
+
+inline bool TimeManager::clockDue(unsigned long long nodes) {
+  if (nodes < nextPollNodes_) return false;
+  nextPollNodes_ = nodes + TM_POLL_INTERVAL;
+  return true;
+}
+
+#endif  // TIMEMANAGER_HPP
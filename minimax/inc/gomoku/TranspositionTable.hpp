@@ -0,0 +1,115 @@
+#ifndef TRANSPOSITIONTABLE_HPP
+#define TRANSPOSITIONTABLE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#define TT_DEFAULT_MB 64
+#define TT_BUCKET_ENTRIES 4
+// A store for a position that already holds an EXACT entry of the current search
+// is dropped when it is more than this many plies shallower.
+#define TT_EXACT_KEEP_MARGIN 2
+// Snapshot files keep entries searched at least this deep. Each ply shallower
+// holds several times more entries, each cheaper to recompute: depth 3 and up
+// is about 1% of a full table. Bump the version when the file layout or the
+// meaning of stored scores changes.
+#define TT_SNAPSHOT_MIN_DEPTH 3
+#define TT_SNAPSHOT_FILE_VERSION 2
+
+// Bound types used for alpha-beta entries.
+enum BoundType { EXACT, LOWERBOUND, UPPERBOUND };
+
+// Unpacked view of a transposition table entry.
+struct TTEntry {
+  int score;                     // Evaluation score
+  int depth;                     // Depth at which the evaluation was computed
+  std::pair<int, int> bestMove;  // Best move from this state (if available)
+  BoundType flag;                // Flag indicating whether score is EXACT, a lower, or upper bound.
+
+  TTEntry() : score(0), depth(-1), bestMove(-1, -1), flag(EXACT) {}
+
+  // Parameterized constructor for convenience
+  TTEntry(int s, int d, std::pair<int, int> mv, BoundType f)
+      : score(s), depth(d), bestMove(mv), flag(f) {}
+};
+
+// The entries of a snapshot file (see TranspositionTable::readSnapshot), read
+// once and restored into any number of tables.
+struct TTSnapshot {
+  std::vector<uint64_t> words;  // (key, data) pairs
+  uint32_t rules;               // as passed to saveSnapshot
+
+  TTSnapshot() : rules(0) {}
+  size_t entryCount() const { return words.size() / 2; }
+};
+
+// Fixed-size, bucketed transposition table shared by all search threads.
+//
+// Each slot is two 64-bit words: `data` packs score(32) | move(16) | depth(8) |
+// bound(2) | generation(6), and `check` holds key ^ data. Readers and writers
+// never lock; a slot torn by a concurrent store fails the XOR check and is
+// treated as a miss. Four slots form one 64-byte, cache-line aligned bucket.
+class TranspositionTable {
+ public:
+  explicit TranspositionTable(size_t megabytes = TT_DEFAULT_MB);
+  ~TranspositionTable();
+
+  // Reallocates to the largest power-of-two bucket count that fits in
+  // `megabytes`. Must not be called while a search is running.
+  bool resize(size_t megabytes, bool hugePages = true);
+  void clear();
+
+  // Ages every stored entry by one generation (replacement preference only).
+  void newSearch();
+
+  bool probe(uint64_t key, TTEntry &out) const;
+  void store(uint64_t key, const TTEntry &entry);
+
+  // Snapshots for warm restarts: the entries of at least `minDepth`, as raw
+  // (key, data) pairs. `tag` names the key scheme and must match on read; `rules`
+  // is saved alongside and handed back in the snapshot. collectSnapshot appends
+  // to `out`, so several tables can go into one file; keepDeepest then leaves
+  // the deepest entry of each position, and at most `maxEntries` of them.
+  // readSnapshot returns false when the file is missing, does not match, is
+  // corrupt or holds more than `maxEntries`. restoreSnapshot stores every entry
+  // as part of the current search. None of these may run during a search.
+  bool saveSnapshot(const char *path, int minDepth, uint64_t tag, uint32_t rules) const;
+  void collectSnapshot(int minDepth, TTSnapshot &out) const;
+  static void keepDeepest(TTSnapshot &snapshot, size_t maxEntries);
+  static bool writeSnapshot(const char *path, uint64_t tag, const TTSnapshot &snapshot);
+  static bool readSnapshot(const char *path, uint64_t tag, size_t maxEntries, TTSnapshot &out);
+  void restoreSnapshot(const TTSnapshot &snapshot);
+
+  size_t sizeInBytes() const { return bucketCount_ * sizeof(Bucket); }
+  size_t entryCount() const { return bucketCount_ * TT_BUCKET_ENTRIES; }
+  bool usesHugePages() const { return hugePages_; }
+
+ private:
+  friend class TranspositionTableTest;  // doublethree_test.cpp forges torn slots
+
+  struct Slot {
+    uint64_t check;
+    uint64_t data;
+  };
+  struct Bucket {
+    Slot slots[TT_BUCKET_ENTRIES];
+  } __attribute__((aligned(64)));
+
+  Bucket *buckets_;
+  size_t bucketCount_;
+  bool mapped_;     // allocated with mmap (else posix_memalign)
+  bool hugePages_;  // backed by explicit or transparent huge pages
+  uint8_t generation_;
+
+  void insert(uint64_t key, uint64_t data);
+  bool allocate(size_t bytes, bool hugePages);
+  void release();
+
+  TranspositionTable(const TranspositionTable &);
+  TranspositionTable &operator=(const TranspositionTable &);
+};
+
+#endif  // TRANSPOSITIONTABLE_HPP
@@ -0,0 +1,46 @@
+#ifndef ENGINE_POOL_HPP
+#define ENGINE_POOL_HPP
+
+#include <stddef.h>
+
+#include <string>
+
+#include "Minimax.hpp"
+
+// Most engine contexts allocated at once (MINIMAX_SESSIONS).
+#define ENGINE_POOL_DEFAULT_SESSIONS 8
+
+struct psd_debug;
+
+// Engine contexts for websocket sessions. A connection takes one when it opens
+// and returns it when it closes; returned contexts are handed to later
+// connections with their tables intact. A context is allocated when a connection
+// finds every existing one in use, so an idle server holds only the first. Past
+// the limit, new connections share the context with the fewest sessions:
+// searches on one context must not overlap, so each session claims its context
+// for a search and the others wait for it. These functions run on the server's
+// service thread only.
+
+// Allocates the first of at most `maxSessions` contexts. The snapshot at a
+// non-empty `snapshotPath` is read once and warms every context as it is
+// allocated. Returns false when the first context could not be allocated, so
+// that a bad size fails at startup.
+bool configureEnginePool(int maxSessions, size_t ttMegabytes, size_t evalCacheMegabytes,
+                         const std::string &snapshotPath);
+// An unused context, newly allocated if need be, else the one with the fewest
+// sessions; NULL only before configureEnginePool.
+EngineContext *acquireEngine();
+void releaseEngine(EngineContext *engine);
+// Reserves `engine` for a worker job of `psd` until unclaimEngine. False while
+// another session holds it.
+bool claimEngine(EngineContext *engine, psd_debug *psd);
+void unclaimEngine(EngineContext *engine);
+// The session holding `engine`, or NULL.
+psd_debug *engineHolder(EngineContext *engine);
+// Writes one TT snapshot of every context: the deepest entries under the rule
+// set of the context that searched most recently (see Minimax::saveTTSnapshot).
+bool saveEngineSnapshot(const char *path);
+// Frees every context; call once no session holds one.
+void destroyEnginePool();
+
+#endif  // ENGINE_POOL_HPP
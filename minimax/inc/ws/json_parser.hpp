@@ -13,6 +13,7 @@
 
 #include "Board.hpp"
 #include "Rules.hpp"
+#include "TimeManager.hpp"
 
 enum ParseResult {
   PARSE_OK,
@@ -43,4 +44,12 @@ ParseResult parseMoveRequest(const rapidjson::Document &doc, Board *&pBoard, std
 ParseResult parseEvaluateRequest(const rapidjson::Document &doc, Board *&pBoard, std::string &error,
                                  int *last_x, int *last_y);
 
+// Optional "threads" field, clamped to [1, maxThreads]; maxThreads when absent.
+int parseSearchThreads(const rapidjson::Document &doc, int maxThreads);
+
+// Optional "timeLimitMs" and "nodeLimit" fields override `defaults`; a time limit
+// is clamped to MAX_REQUEST_TIME_LIMIT_MS. Invalid values are ignored.
+#define MAX_REQUEST_TIME_LIMIT_MS 60000
+SearchLimits parseSearchLimits(const rapidjson::Document &doc, const SearchLimits &defaults);
+
 #endif  // JSON_PARSER_H
@@ -1,14 +1,38 @@
 #ifndef REQUEST_HANDLERS_HPP
 #define REQUEST_HANDLERS_HPP
 
-#include <libwebsockets.h>
 #include <rapidjson/document.h>
 
+#include <string>
+
+#include "request_workers.hpp"
 #include "websocket_handler.hpp"
 
-int handleMoveRequest(struct lws *wsi, const rapidjson::Document &doc, psd_debug *psd);
-int handleEvaluateRequest(struct lws *wsi, const rapidjson::Document &doc);
-int handleTestRequest(struct lws *wsi, const rapidjson::Document &doc);
+// Default budget of a ponder search, in milliseconds (MINIMAX_PONDER_MS; 0 = no
+// pondering). Keep it above the move time limits: a search that used it all up
+// answers the predicted request at the depth it reached.
+#define PONDER_DEFAULT_MS 10000
+
+// Each handler sets `reply` to the JSON to send back and returns -1 when the
+// connection should be closed after it. A medium or hard move also sets `ponder`
+// to the position to search while the opponent thinks (NULL = none).
+int handleMoveRequest(const rapidjson::Document &doc, psd_debug *psd, std::string &reply,
+                      PonderSearch *&ponder);
+int handleEvaluateRequest(const rapidjson::Document &doc, std::string &reply);
+int handleTestRequest(const rapidjson::Document &doc, psd_debug *psd, std::string &reply);
 void handleResetRequest(psd_debug *psd);
+// True when the move request `doc` is the one `ponder` predicted, with the same
+// difficulty, limits and thread count, so the ponder search can answer it.
+bool ponderMatches(const PonderSearch &ponder, const rapidjson::Document &doc);
+// Sets `reply` to the move response of a finished ponder search; false when it
+// found no move.
+bool handlePonderHit(const PonderSearch &ponder, std::string &reply);
+// Runs a move, evaluate, test or ponder job on a worker thread.
+void handleWorkerRequest(RequestJob &job);
+
+// Lazy-SMP thread count used by move/test searches; also the per-request cap.
+void setSearchThreads(int threads);
+// Budget of each ponder search in milliseconds; 0 turns pondering off.
+void setPonderTime(int ms);
 
 #endif  // REQUEST_HANDLERS_HPP
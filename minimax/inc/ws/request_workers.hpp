@@ -0,0 +1,88 @@
+#ifndef REQUEST_WORKERS_HPP
+#define REQUEST_WORKERS_HPP
+
+#include <libwebsockets.h>
+#include <rapidjson/document.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TimeManager.hpp"
+
+class Board;
+struct psd_debug;
+
+// A search on the opponent's time. After a move reply, the connection searches
+// the position its search expects next: the AI's move followed by the predicted
+// reply. When the move request for that position arrives, this search becomes its
+// search and keeps the depth it has reached (see request_handlers.hpp).
+struct PonderSearch {
+  Board *board;               // the predicted position, AI to move
+  std::pair<int, int> reply;  // the predicted opponent move
+  std::string difficulty;
+  int threads;
+  SearchLimits limits;       // of the request that made the prediction
+  std::pair<int, int> move;  // the search result, once the job has finished
+  // Shared with the worker: accessed with loadFlag and storeFlag only.
+  volatile bool hit;   // the predicted request arrived; `limits` now apply
+  volatile bool stop;  // abandon the search
+  double hitMs;        // TimeManager::nowMs() at the hit, written before `hit`
+
+  PonderSearch(Board *position, const std::pair<int, int> &predicted, const std::string &level,
+               int searchThreads, const SearchLimits &requestLimits);
+  ~PonderSearch();
+
+ private:
+  PonderSearch(const PonderSearch &);
+  PonderSearch &operator=(const PonderSearch &);
+};
+
+// A received request. Move, evaluate and test requests are handed to a worker,
+// which sets the reply.
+struct RequestJob {
+  psd_debug *psd;
+  rapidjson::Document doc;
+  std::string type;   // the "type" field; empty when `error` is set
+  std::string error;  // why the message is not a valid request
+  bool cancelled;     // superseded or cancelled before a worker took it
+  std::string reply;  // set by the worker; empty when there is nothing to send
+  bool close;         // the request failed: close the connection after the reply
+  // "ponder" jobs: the search to run, owned by the connection. Finished move jobs:
+  // the position to ponder next, owned by the job until the connection takes it.
+  PonderSearch *ponder;
+
+  explicit RequestJob(psd_debug *session)
+      : psd(session), cancelled(false), close(false), ponder(NULL) {}
+};
+
+// A message a worker sends while its request is still running (search progress).
+struct WorkerMessage {
+  psd_debug *psd;
+  std::string json;
+
+  WorkerMessage(psd_debug *session, const std::string &message) : psd(session), json(message) {}
+};
+
+// Fixed pool of threads that run searches off the libwebsockets service thread.
+// A finished job is queued for the service thread and announced with
+// lws_cancel_service, which raises LWS_CALLBACK_EVENT_WAIT_CANCELLED there.
+// Every other function is called from the service thread only.
+void startRequestWorkers(struct lws_context *context, int workers);
+// Stops the ponder searches, lets the running jobs finish and joins the workers.
+// Jobs that had not started are returned by takeWorkerResults with no reply.
+void stopRequestWorkers();
+// When every worker is busy, also stops a ponder search that no request waits for.
+void submitRequest(RequestJob *job);
+// Queues a "ponder" job only if a worker is idle; false when it was not queued.
+bool submitPonder(RequestJob *job);
+// Called by a worker for the job it runs; delivered like a finished job.
+void postWorkerMessage(psd_debug *psd, const std::string &json);
+// Moves the messages posted and the jobs finished since the last call to
+// `messages` and `finished`, each in posting order. A job's messages are taken
+// no later than the job itself.
+void takeWorkerResults(std::vector<WorkerMessage> &messages, std::vector<RequestJob *> &finished);
+// True when no job is queued or running, so no search touches an engine context.
+bool requestWorkersIdle();
+
+#endif  // REQUEST_WORKERS_HPP
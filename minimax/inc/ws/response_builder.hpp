@@ -1,17 +1,19 @@
 #ifndef RESPONSE_BUILDER_HPP
 #define RESPONSE_BUILDER_HPP
 
-#include <libwebsockets.h>
-
 #include <string>
 
 #include "Board.hpp"
+#include "Minimax.hpp"
 #include "json_parser.hpp"
 
-void responseSuccessMove(struct lws *wsi, Board &board, int aiPlayX, int aiPlayY,
-                         double executionTime);
-void responseSuccessEvaluate(struct lws *wsi, int evalScoreX, int evalScoreY);
+// JSON replies; the websocket handler sends them once the connection is writeable.
+std::string constructMoveResponse(Board &board, int aiPlayX, int aiPlayY, double executionTime);
+std::string constructEvaluateResponse(int evalScoreX, int evalScoreY);
 std::string constructErrorResponse(ParseResult result, const std::string &details);
-void sendErrorResponse(struct lws *wsi, ParseResult result, const std::string &details);
+// Sent after each completed iteration of a move or test search.
+std::string constructProgressResponse(const SearchProgress &progress);
+// Replaces the reply of a move or test request that was cancelled or superseded.
+std::string constructCancelledResponse(const std::string &requestType);
 
 #endif  // RESPONSE_BUILDER_HPP
@@ -8,15 +8,20 @@
 #include <iostream>
 #include <sstream>  // For stringstream
 #include <stdexcept>
+#include <string>
 
 #include "Evaluation.hpp"
 #include "Gomoku.hpp"
 #include "Minimax.hpp"
+#include "OpeningBook.hpp"
 #include "websocket_handler.hpp"
 
 class Server {
  public:
-  Server(int port);
+  // `workers` threads run the searches of all connections (see request_workers.hpp).
+  Server(int port, int searchThreads = 1, int workers = 1);
+  // Saves a TT snapshot to `path` every `seconds` while serving (0 = never).
+  void setTTSnapshot(const std::string &path, int seconds);
   void run(volatile std::sig_atomic_t &stopFlag);
 
   // ─── per-session data ───────────────────────────────────────────────
@@ -24,6 +29,8 @@ class Server {
  private:
   struct lws_context *context;
   struct lws_context_creation_info info;
+  std::string ttSnapshotPath;
+  int ttSnapshotSeconds;
 };
 
 #endif  // SERVER_HPP
@@ -3,13 +3,56 @@
 
 #include <libwebsockets.h>
 
+#include <deque>
 #include <string>
 
+struct EngineContext;
+struct PonderSearch;
+struct RequestJob;
+
+// A reply waiting for its connection to become writeable.
+struct PendingReply {
+  std::string json;
+  bool close;  // the request failed: close the connection once this is sent
+
+  PendingReply(const std::string &reply, bool closeAfter) : json(reply), close(closeAfter) {}
+};
+
+// State of one connection. Its requests are handled one at a time in arrival
+// order, so replies keep that order. A search runs only while the connection
+// holds `engine`, which other connections may share (see engine_pool.hpp).
+// libwebsockets stores only a pointer to it: a worker may still be searching for
+// a connection that has closed, and the state is freed once that search ends.
 struct psd_debug {
+  struct lws *wsi;         // NULL once the connection has closed
   std::string difficulty;  // keep the last difficulty here
+  EngineContext *engine;   // tables of this connection's searches (see engine_pool.hpp)
+  std::deque<RequestJob *> requests;  // received, not yet handled
+  std::deque<PendingReply> replies;   // handled, not yet sent
+  RequestJob *running;                // the request a worker is handling, if any
+  volatile bool cancelSearch;         // stops the running search (see SearchLimits::cancel);
+                                      // accessed with loadFlag and storeFlag only
+  // The search on the predicted position after the last move reply, running or
+  // finished; kept until the next search request. While `pondering`, it uses
+  // `engine`, and `running` is either NULL or the move request it now answers.
+  PonderSearch *ponder;
+  bool pondering;
+
+  psd_debug(struct lws *socket, EngineContext *context)
+      : wsi(socket),
+        engine(context),
+        running(NULL),
+        cancelSearch(false),
+        ponder(NULL),
+        pondering(false) {}
 };
 
 int callbackWebsocket(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in,
                       size_t len);
 
+// Queues the replies of finished worker jobs and hands each connection its next
+// request. Runs on LWS_CALLBACK_EVENT_WAIT_CANCELLED, and once more at shutdown
+// after the workers have stopped.
+void completeWorkerRequests();
+
 #endif  // WEBSOCKET_HANDLER_HPP
@@ -1,5 +1,6 @@
 #include "Board.hpp"
 
+#include "Evaluation.hpp"
 #include "Rules.hpp"
 
 namespace {
@@ -46,7 +47,9 @@ Board::Board()
       next_player(PLAYER_2),
       last_player_score(0),
       next_player_score(0),
-      currentHash(0) {
+      candidate_radius(DEFAULT_CANDIDATE_RADIUS),
+      currentHash(0),
+      symmetric_hashing(false) {
   assertZobristInitialized();
 
   this->reset_bitboard();
@@ -59,11 +62,20 @@ Board::Board(const Board &other)
       next_player(other.next_player),
       last_player_score(other.last_player_score),
       next_player_score(other.next_player_score),
-      currentHash(other.currentHash) {
+      enable_capture(other.enable_capture),
+      enable_double_three_restriction(other.enable_double_three_restriction),
+      captured_stones(other.captured_stones),
+      candidate_radius(other.candidate_radius),
+      currentHash(other.currentHash),
+      symmetric_hashing(other.symmetric_hashing) {
   for (int i = 0; i < BOARD_SIZE; ++i) {
     last_player_board[i] = other.last_player_board[i];
     next_player_board[i] = other.next_player_board[i];
   }
+  memcpy(line_codes, other.line_codes, sizeof(line_codes));
+  memcpy(neighbor_counts, other.neighbor_counts, sizeof(neighbor_counts));
+  memcpy(neighbor_mask, other.neighbor_mask, sizeof(neighbor_mask));
+  memcpy(symmetry_deltas, other.symmetry_deltas, sizeof(symmetry_deltas));
 }
 
 Board::Board(const std::vector<std::vector<char> > &board_data, int goal, int last_player_int,
@@ -76,7 +88,9 @@ Board::Board(const std::vector<std::vector<char> > &board_data, int goal, int la
       next_player_score(next_score),
       enable_capture(enableCapture),
       enable_double_three_restriction(enableDoubleThreeRestriction),
-      currentHash(0) {
+      candidate_radius(DEFAULT_CANDIDATE_RADIUS),
+      currentHash(0),
+      symmetric_hashing(false) {
   assertZobristInitialized();
 
   this->reset_bitboard();
@@ -93,7 +107,9 @@ Board::Board(int goal, int last_player_int, int next_player_int, int last_score,
       next_player_score(next_score),
       enable_capture(enableCapture),
       enable_double_three_restriction(enableDoubleThreeRestriction),
-      currentHash(0) {
+      candidate_radius(DEFAULT_CANDIDATE_RADIUS),
+      currentHash(0),
+      symmetric_hashing(false) {
   assertZobristInitialized();
 
   this->reset_bitboard();
@@ -106,6 +122,56 @@ Board::Board(int goal, int last_player_int, int next_player_int, int last_score,
 void Board::reset_bitboard() {
   memset(this->last_player_board, 0, BOARD_SIZE * sizeof(uint64_t));
   memset(this->next_player_board, 0, BOARD_SIZE * sizeof(uint64_t));
+  memset(this->neighbor_counts, 0, sizeof(neighbor_counts));
+  memset(this->neighbor_mask, 0, sizeof(neighbor_mask));
+  memset(this->symmetry_deltas, 0, sizeof(symmetry_deltas));
+  // On an empty board only the out-of-bounds cells contribute to a window.
+  for (int axis = 0; axis < 4; ++axis)
+    for (int row = 0; row < BOARD_SIZE; ++row)
+      for (int col = 0; col < BOARD_SIZE; ++col)
+        line_codes[axis][row * BOARD_SIZE + col] =
+            extractLineCode(col, row, DIRECTIONS[axis][0], DIRECTIONS[axis][1]);
+}
+
+// A cell sits at forward distance k of the cell k steps behind it, and at
+// backward distance k of the cell k steps ahead of it.
+void Board::updateLineCodes(int col, int row, unsigned int cell) {
+  for (int axis = 0; axis < 4; ++axis) {
+    int dx = DIRECTIONS[axis][0];
+    int dy = DIRECTIONS[axis][1];
+    for (int k = 1; k <= SIDE_WINDOW_SIZE; ++k) {
+      int bc = col - k * dx, br = row - k * dy;
+      if (isValidCoordinate(bc, br)) {
+        unsigned int shift = 2 * (SIDE_WINDOW_SIZE - k);
+        unsigned int &code = line_codes[axis][br * BOARD_SIZE + bc];
+        code = (code & ~(3u << shift)) | (cell << shift);
+      }
+      int fc = col + k * dx, fr = row + k * dy;
+      if (isValidCoordinate(fc, fr)) {
+        unsigned int shift = 2 * (SIDE_WINDOW_SIZE + k);
+        unsigned int &code = line_codes[axis][fr * BOARD_SIZE + fc];
+        code = (code & ~(3u << shift)) | (cell << shift);
+      }
+    }
+  }
+}
+
+// Adds (delta = 1) or removes (delta = -1) one stone at (col, row) from the
+// counts of every cell in its (2r+1) x (2r+1) square.
+void Board::updateNeighborCounts(int col, int row, int delta) {
+  int r = candidate_radius;
+  int rowBegin = std::max(0, row - r), rowEnd = std::min(BOARD_SIZE - 1, row + r);
+  int colBegin = std::max(0, col - r), colEnd = std::min(BOARD_SIZE - 1, col + r);
+  for (int y = rowBegin; y <= rowEnd; ++y) {
+    unsigned char *count = &neighbor_counts[y * BOARD_SIZE];
+    for (int x = colBegin; x <= colEnd; ++x) {
+      if (delta > 0) {
+        if (count[x]++ == 0) neighbor_mask[y] |= 1ULL << x;
+      } else if (--count[x] == 0) {
+        neighbor_mask[y] &= ~(1ULL << x);
+      }
+    }
+  }
 }
 
 void Board::init_bitboard_from_data(const std::vector<std::vector<char> > &board_data) {
@@ -124,14 +190,6 @@ void Board::init_bitboard_from_data(const std::vector<std::vector<char> > &board
 /**
  * Accessors
  */
-int Board::getValueBit(int col, int row) const {
-  if (!isValidCoordinate(col, row)) return OUT_OF_BOUNDS;
-  uint64_t mask = 1ULL << col;
-  if (this->last_player_board[row] & mask) return PLAYER_1;
-  if (this->next_player_board[row] & mask) return PLAYER_2;
-  return EMPTY_SPACE;
-}
-
 uint64_t *Board::getBitboardByPlayer(int player) {
   if (player == PLAYER_1)
     return this->last_player_board;
@@ -148,6 +206,61 @@ void Board::getOccupancy(uint64_t occupancy[BOARD_SIZE]) const {
 
 uint64_t Board::getHash() const { return this->currentHash; }
 
+uint64_t Board::getCanonicalHash(int &symmetry) const {
+  symmetry = 0;
+  if (!symmetric_hashing) return currentHash;
+  uint64_t best = currentHash;
+  for (int s = 1; s < BOARD_SYMMETRIES; ++s) {
+    uint64_t hash = currentHash ^ symmetry_deltas[s];
+    if (hash < best) {
+      best = hash;
+      symmetry = s;
+    }
+  }
+  return best;
+}
+
+bool Board::getSymmetricHashing() const { return this->symmetric_hashing; }
+
+void Board::setSymmetricHashing(bool enable) {
+  if (enable == symmetric_hashing) return;
+  symmetric_hashing = enable;
+  memset(symmetry_deltas, 0, sizeof(symmetry_deltas));
+  if (!enable) return;
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    for (uint64_t bits = last_player_board[row]; bits; bits &= bits - 1)
+      updateSymmetryDeltas(__builtin_ctzll(bits), row, PLAYER_1);
+    for (uint64_t bits = next_player_board[row]; bits; bits &= bits - 1)
+      updateSymmetryDeltas(__builtin_ctzll(bits), row, PLAYER_2);
+  }
+}
+
+// Toggles `stone` at (col, row) in every symmetric hash. currentHash already
+// toggles the cell's own key, so each delta swaps it for the key of its image.
+void Board::updateSymmetryDeltas(int col, int row, int stone) {
+  ZobristKey own = Zobrist::piece_keys[col][row][stone];
+  for (int s = 1; s < BOARD_SYMMETRIES; ++s) {
+    std::pair<int, int> image = symmetricMove(s, col, row);
+    symmetry_deltas[s] ^= Zobrist::piece_keys[image.first][image.second][stone] ^ own;
+  }
+}
+
+int Board::getCandidateRadius() const { return this->candidate_radius; }
+
+void Board::setCandidateRadius(int radius) {
+  if (radius < 1 || radius > MAX_CANDIDATE_RADIUS)
+    throw std::invalid_argument("Candidate radius must be 1 or 2");
+  if (radius == candidate_radius) return;
+  candidate_radius = radius;
+  memset(neighbor_counts, 0, sizeof(neighbor_counts));
+  memset(neighbor_mask, 0, sizeof(neighbor_mask));
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    uint64_t occupied = last_player_board[row] | next_player_board[row];
+    for (; occupied; occupied &= occupied - 1)
+      updateNeighborCounts(__builtin_ctzll(occupied), row, 1);
+  }
+}
+
 int Board::getNextPlayer() const { return this->next_player; }
 
 int Board::getLastPlayer() const { return this->last_player; }
@@ -179,6 +292,10 @@ void Board::setValueBit(int col, int row, int stone) {
   int old_player_at_cell = this->getValueBit(col, row);  // Will be 0, 1, or 2
 
   updatePieceHash(this->currentHash, old_player_at_cell, stone, col, row);
+  if (symmetric_hashing && old_player_at_cell != stone) {
+    if (old_player_at_cell != EMPTY_SPACE) updateSymmetryDeltas(col, row, old_player_at_cell);
+    if (stone != EMPTY_SPACE) updateSymmetryDeltas(col, row, stone);
+  }
 
   // // stone: 0=empty (removal), 1=PLAYER_1, 2=PLAYER_2
   // // update the bitboards (C++98)
@@ -194,6 +311,12 @@ void Board::setValueBit(int col, int row, int stone) {
     // placement of P2
     next_player_board[row] |= mask;
   }
+  int new_player_at_cell = getValueBit(col, row);
+  if (old_player_at_cell == EMPTY_SPACE && new_player_at_cell != EMPTY_SPACE)
+    updateNeighborCounts(col, row, 1);
+  else if (old_player_at_cell != EMPTY_SPACE && new_player_at_cell == EMPTY_SPACE)
+    updateNeighborCounts(col, row, -1);
+  updateLineCodes(col, row, (unsigned int)new_player_at_cell);
 }
 
 void Board::storeCapturedStone(int x, int y, int player) {
@@ -201,14 +324,13 @@ void Board::storeCapturedStone(int x, int y, int player) {
   cs.x = x;
   cs.y = y;
   cs.player = player;
-  // Use push_back since captured_stones is a std::vector
   captured_stones.push_back(cs);
 }
 
 void Board::applyCapture(bool clearCapture) {
   int opponent_stones_removed_count = 0;
 
-  for (std::vector<CapturedStone>::size_type i = 0; i < captured_stones.size(); ++i) {
+  for (size_t i = 0; i < captured_stones.size(); ++i) {
     const CapturedStone &cap = captured_stones[i];  // Use const reference
 
     // Check if the captured stone belonged to the opponent
@@ -238,7 +360,7 @@ void Board::applyCapture(bool clearCapture) {
   if (clearCapture) captured_stones.clear();
 }
 
-const std::vector<CapturedStone> &Board::getCapturedStones() const { return this->captured_stones; }
+const CaptureList &Board::getCapturedStones() const { return this->captured_stones; }
 
 void Board::switchTurn() {
   int tmp = this->next_player;
@@ -261,10 +383,6 @@ void Board::flushCaptures() {
 /**
  * Utility
  */
-bool Board::isValidCoordinate(int col, int row) {
-  return (col >= 0 && col < BOARD_SIZE && row >= 0 && row < BOARD_SIZE);
-}
-
 std::string Board::convertIndexToCoordinates(int col, int row) {
   if (col < 0 || col >= 19) {
     throw std::out_of_range("Column index must be between 0 and 18.");
@@ -317,6 +435,19 @@ unsigned int Board::extractLineAsBits(int x, int y, int dx, int dy, int length)
   return pattern;
 }
 
+// Slow path of getLineCode: reads the window cell by cell. Used to seed the
+// cache and for centers off the board or reversed directions.
+unsigned int Board::extractLineCode(int col, int row, int dx, int dy) const {
+  unsigned int forward = extractLineAsBits(col, row, dx, dy, SIDE_WINDOW_SIZE);
+  unsigned int backward = extractLineAsBits(col, row, -dx, -dy, SIDE_WINDOW_SIZE);
+  unsigned int revBackward = 0;
+  for (int i = 0; i < SIDE_WINDOW_SIZE; ++i) {
+    revBackward = (revBackward << 2) | (backward & 0x3);
+    backward >>= 2;
+  }
+  return (revBackward << (2 * (SIDE_WINDOW_SIZE + 1))) | forward;
+}
+
 unsigned int Board::getCellCount(unsigned int pattern, int windowLength) {
   unsigned int count = 0;
   for (int i = 0; i < windowLength && (((pattern >> (2 * (windowLength - 1 - i))) & 0x3) != 3); ++i)
@@ -438,9 +569,8 @@ void Board::undoMove(const UndoInfo &undo_data) {
     this->next_player_score = undo_data.scoreBeforeCapture;
 
     // Restore the captured stones on the board
-    for (std::vector<CapturedStone>::const_iterator it = undo_data.capturedStonesInfo.begin();
-         it != undo_data.capturedStonesInfo.end(); it++) {
-      const CapturedStone &cap = *it;
+    for (size_t i = 0; i < undo_data.capturedStonesInfo.size(); ++i) {
+      const CapturedStone &cap = undo_data.capturedStonesInfo[i];
       // Assuming setValueBit updates the hash for placing the stone back
       this->setValueBit(cap.x, cap.y, cap.player);
     }
@@ -27,12 +27,8 @@ void initZobrist() {
     return;  // Already initialized
   }
 
-  // Seed the global Boost generator ONCE
-  // Using time(0) is the standard C++98 compatible way.
-  // boost::random::random_device could be used if available/preferred for better seeding,
-  // but requires checking its availability and usage. time(0) is simpler.
-  unsigned int seed = static_cast<unsigned int>(std::time(0));
-  global_boost_rng.seed(seed);
+  // Seed the global Boost generator ONCE, with the versioned fixed seed
+  global_boost_rng.seed(static_cast<boost::random::mt19937::result_type>(ZOBRIST_SEED));
 
   // Generate keys using the helper function
   for (int x = 0; x < BOARD_SIZE; ++x) {
@@ -62,25 +62,67 @@ bool Rules::detectCaptureStonesNotStore(Board& board, int x, int y, int player)
   return detectCaptureStonesImpl(board, x, y, player, false);
 }
 
-// Classical implementation using CForbiddenPointFinder
-bool Rules::detectDoublethree(Board& board, int x, int y, int player) {
-  CForbiddenPointFinder finder(BOARD_SIZE);
+namespace {
 
+// Number of `player` stones in a combined window code (center excluded).
+inline int countOwnStones(unsigned int code, int player) {
+  unsigned int lo = code & 0x15555;
+  unsigned int hi = (code >> 1) & 0x15555;
+  return __builtin_popcount(player == PLAYER_1 ? (lo & ~hi) : (hi & ~lo));
+}
+
+// Cheap necessary condition: each open three through (x, y) needs two more of the
+// player's stones within four cells on its axis, so two such axes are required.
+bool mayBeDoublethree(const Board& board, int x, int y, int player) {
+  int axes = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (countOwnStones(board.getLineCode(x, y, DIRECTIONS[i][0], DIRECTIONS[i][1]), player) >= 2 &&
+        ++axes >= 2)
+      return true;
+  }
+  return false;
+}
+
+void fillFinder(CForbiddenPointFinder& finder, const Board& board, int player) {
   for (int row = 0; row < BOARD_SIZE; ++row) {
     for (int col = 0; col < BOARD_SIZE; ++col) {
       int cell = board.getValueBit(col, row);
       if (cell == EMPTY_SPACE) continue;
-      if (cell == player) {
-        finder.SetStone(col, row, BLACKSTONE);
-      } else {
-        finder.SetStone(col, row, WHITESTONE);
-      }
+      finder.SetStone(col, row, cell == player ? BLACKSTONE : WHITESTONE);
     }
   }
+}
 
+}  // namespace
+
+// Classical implementation using CForbiddenPointFinder
+bool Rules::detectDoublethree(Board& board, int x, int y, int player) {
+  if (!mayBeDoublethree(board, x, y, player)) return false;
+
+  CForbiddenPointFinder finder(BOARD_SIZE);
+  fillFinder(finder, board, player);
   return finder.IsDoubleThree(x, y);
 }
 
+void Rules::detectDoublethreeMask(Board& board, int player, const uint64_t cells[BOARD_SIZE],
+                                  uint64_t forbidden[BOARD_SIZE], CForbiddenPointFinder& finder) {
+  bool filled = false;  // most nodes have no cell passing the prefilter
+
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    forbidden[row] = 0;
+    for (uint64_t bits = cells[row]; bits; bits &= bits - 1) {
+      int col = __builtin_ctzll(bits);
+      if (!mayBeDoublethree(board, col, row, player)) continue;
+      if (!filled) {
+        finder.Clear();
+        fillFinder(finder, board, player);
+        filled = true;
+      }
+      if (finder.IsDoubleThree(col, row)) forbidden[row] |= 1ULL << col;
+    }
+  }
+}
+
 
 
 bool Rules::isWinningMove(Board* board, int player, int x, int y) {
@@ -0,0 +1,72 @@
+#include "EvalCache.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// data layout: score(32) | generation(16)
+inline uint64_t packData(int score, uint16_t generation) {
+  return (uint64_t)(uint32_t)score | ((uint64_t)generation << 32);
+}
+
+inline uint16_t dataGeneration(uint64_t data) { return (uint16_t)(data >> 32); }
+
+inline uint64_t loadWord(const uint64_t *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+inline void storeWord(uint64_t *p, uint64_t v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+
+}  // namespace
+
+EvalCache::EvalCache(size_t megabytes) : slots_(NULL), slotCount_(0), generation_(1) {
+  if (!resize(megabytes)) throw std::runtime_error("Evaluation cache allocation failed");
+}
+
+EvalCache::~EvalCache() { std::free(slots_); }
+
+bool EvalCache::resize(size_t megabytes) {
+  size_t count = 0;
+  if (megabytes > 0) {
+    size_t maxSlots = (megabytes << 20) / sizeof(Slot);
+    count = 1;
+    while (count * 2 <= maxSlots) count *= 2;
+  }
+
+  Slot *slots = NULL;
+  if (count > 0) {
+    void *mem = NULL;
+    if (posix_memalign(&mem, 64, count * sizeof(Slot)) != 0) return false;
+    std::memset(mem, 0, count * sizeof(Slot));
+    slots = static_cast<Slot *>(mem);
+  }
+  std::free(slots_);
+  slots_ = slots;
+  slotCount_ = count;
+  generation_ = 1;
+  return true;
+}
+
+void EvalCache::clear() {
+  if (++generation_ != 0) return;
+  // Generations wrapped: old slots could read as current again.
+  std::memset(slots_, 0, slotCount_ * sizeof(Slot));
+  generation_ = 1;
+}
+
+bool EvalCache::probe(uint64_t key, int &score) const {
+  if (slotCount_ == 0) return false;
+  const Slot &slot = slots_[key & (slotCount_ - 1)];
+  uint64_t data = loadWord(&slot.data);
+  uint64_t check = loadWord(&slot.check);
+  if ((check ^ data) != key || dataGeneration(data) != generation_) return false;
+  score = (int)(int32_t)(uint32_t)data;
+  return true;
+}
+
+void EvalCache::store(uint64_t key, int score) {
+  if (slotCount_ == 0) return;
+  Slot &slot = slots_[key & (slotCount_ - 1)];
+  uint64_t data = packData(score, generation_);
+  storeWord(&slot.data, data);
+  storeWord(&slot.check, key ^ data);
+}
@@ -4,8 +4,8 @@
 
 #include "Board.hpp"
 namespace Evaluation {
-int patternScoreTablePlayerOne[LOOKUP_TABLE_SIZE];
-int patternScoreTablePlayerTwo[LOOKUP_TABLE_SIZE];
+static int generatedScoreTable[LOOKUP_TABLE_SIZE];
+const int *patternScoreTable = generatedScoreTable;
 
 void printAxis(int forward, int backward) {
   // Process backward 8 bits in 2-bit groups (from MSB to LSB)
@@ -278,10 +278,7 @@ int evaluateContinuousPattern(unsigned int backward, unsigned int forward, unsig
 }
 
 void initCombinedPatternScoreTables() {
-  std::fill(patternScoreTablePlayerOne, patternScoreTablePlayerOne + LOOKUP_TABLE_SIZE,
-            INVALID_PATTERN);
-  std::fill(patternScoreTablePlayerTwo, patternScoreTablePlayerTwo + LOOKUP_TABLE_SIZE,
-            INVALID_PATTERN);
+  std::fill(generatedScoreTable, generatedScoreTable + LOOKUP_TABLE_SIZE, INVALID_PATTERN);
 
   const unsigned int sideCount = 1 << (2 * SIDE_WINDOW_SIZE);
 
@@ -291,16 +288,13 @@ void initCombinedPatternScoreTables() {
     for (unsigned int forward = 0; forward < sideCount; ++forward) {
       if (!isValidForwardPattern(forward)) continue;
 
-      // Build the full pattern:
-      // Left side occupies the highest 2*SIDE_WINDOW_SIZE bits,
-      // then the fixed center (2 bits),
-      // and then the forward side occupies the lowest 2*SIDE_WINDOW_SIZE bits.
-      unsigned int pattern = (backward << (2 * (SIDE_WINDOW_SIZE + 1))) |
-                             (WINDOW_CENTER_VALUE << (2 * SIDE_WINDOW_SIZE)) | forward;
-      patternScoreTablePlayerOne[pattern] = evaluateContinuousPattern(backward, forward, PLAYER_1);
-      patternScoreTablePlayerTwo[pattern] = evaluateContinuousPattern(backward, forward, PLAYER_2);
+      // Backward side in the high bits, forward side in the low bits; the empty center is
+      // implied. Scores are stored for PLAYER_1, player 2 reads the color-swapped index.
+      unsigned int index = (backward << (2 * SIDE_WINDOW_SIZE)) | forward;
+      generatedScoreTable[index] = evaluateContinuousPattern(backward, forward, PLAYER_1);
     }
   }
+  patternScoreTable = generatedScoreTable;
 }
 
 unsigned int reversePattern(unsigned int pattern, int windowSize) {
@@ -321,46 +315,27 @@ int checkCapture(unsigned int side, unsigned int player) {
   return 0;
 }
 
-int evaluateCombinedAxis(Board *board, int player, int x, int y, int dx, int dy) {
-  int score = 0;
-  // Extract windows.
-  unsigned int forward = board->extractLineAsBits(x, y, dx, dy, SIDE_WINDOW_SIZE);
-  unsigned int backward = board->extractLineAsBits(x, y, -dx, -dy, SIDE_WINDOW_SIZE);
-  unsigned int revBackward = reversePattern(backward, SIDE_WINDOW_SIZE);
-  // Combine: [reversed backward window] + [center cell (player)] + [forward
-  // window]
-  // unsigned int combined = (revBackward << (2 * (SIDE_WINDOW_SIZE + 1))) |
-  //                         ((unsigned int)player << (2 * SIDE_WINDOW_SIZE)) | forward;
-  unsigned int combined = (revBackward << (2 * (SIDE_WINDOW_SIZE + 1))) |
-                          (WINDOW_CENTER_VALUE << (2 * SIDE_WINDOW_SIZE)) | forward;
-  if (player == PLAYER_1) {
-    score = patternScoreTablePlayerOne[combined];
-  } else if (player == PLAYER_2) {
-    score = patternScoreTablePlayerTwo[combined];
-  }
-
+int addCaptureScore(Board *board, int player, int score, int forwardCapture,
+                    int backwardCapture) {
   int activeCaptureScore = (player == board->getLastPlayer()) ? board->getLastPlayerScore()
                                                               : board->getNextPlayerScore();
   int opponentCaptureScore = (player == board->getLastPlayer()) ? board->getNextPlayerScore()
                                                                 : board->getLastPlayerScore();
   // double goalRatio = board->getGoal();
 
-  // If capture is disabled in the game, just return score
-  if (!board->getEnableCapture()) return score;
+  if (forwardCapture > 0) activeCaptureScore++;
+  if (backwardCapture > 0) activeCaptureScore++;
 
-  if (checkCapture(forward, player) > 0) activeCaptureScore++;
-  if (checkCapture(backward, player) > 0) activeCaptureScore++;
-
-  if (checkCapture(forward, player) < 0) opponentCaptureScore++;
-  if (checkCapture(backward, player) < 0) opponentCaptureScore++;
+  if (forwardCapture < 0) opponentCaptureScore++;
+  if (backwardCapture < 0) opponentCaptureScore++;
 
   activeCaptureScore = activeCaptureScore / 2 + 1;
   opponentCaptureScore = opponentCaptureScore / 2 + 1;
 
-  if (checkCapture(forward, player) > 0 || checkCapture(backward, player) > 0) {
+  if (forwardCapture > 0 || backwardCapture > 0) {
     if (activeCaptureScore == board->getGoal()) return GOMOKU;
     score += static_cast<int>(continuousScores[2] * std::pow(10, (activeCaptureScore + 1)));
-  } else if (checkCapture(forward, player) < 0 || checkCapture(backward, player) < 0) {
+  } else if (forwardCapture < 0 || backwardCapture < 0) {
     if (opponentCaptureScore == board->getGoal()) return GOMOKU - 1;
     score += static_cast<int>(blockScores[2] * std::pow(10, (opponentCaptureScore + 1)));
   }
@@ -368,6 +343,24 @@ int evaluateCombinedAxis(Board *board, int player, int x, int y, int dx, int dy)
   return score;
 }
 
+int evaluateCombinedAxis(Board *board, int player, int x, int y, int dx, int dy) {
+  int score = 0;
+  // Combined window: [reversed backward window] + [empty center] + [forward window],
+  // maintained incrementally by the board.
+  unsigned int combined = board->getLineCode(x, y, dx, dy);
+  unsigned int sideMask = (1u << (2 * SIDE_WINDOW_SIZE)) - 1;
+  unsigned int forward = combined & sideMask;
+  score = patternScoreTable[playerPatternIndex(combined, player)];
+
+  // If capture is disabled in the game, just return score
+  if (!board->getEnableCapture()) return score;
+
+  unsigned int backward =
+      reversePattern((combined >> (2 * (SIDE_WINDOW_SIZE + 1))) & sideMask, SIDE_WINDOW_SIZE);
+  return addCaptureScore(board, player, score, checkCapture(forward, player),
+                         checkCapture(backward, player));
+}
+
 int checkVPattern(Board *board, int player, int x, int y, int i) {
   int result = 0;
   int opponent = OPPONENT(player);
@@ -0,0 +1,162 @@
+#include <stdint.h>
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EVALUATION_BATCH_AVX2 1
+#endif
+
+#include "Board.hpp"
+#include "Evaluation.hpp"
+
+namespace Evaluation {
+
+namespace {
+
+// Moves looked up together: one AVX2 register of 32-bit lanes.
+const int kBatchLanes = 8;
+
+const unsigned int kSideMask = (1u << (2 * SIDE_WINDOW_SIZE)) - 1;
+const int kBackwardShift = 2 * (SIDE_WINDOW_SIZE + 1);
+
+// Table score and checkCapture() results of both window sides, per axis and lane.
+struct AxisLookups {
+  int score[4][kBatchLanes];
+  int forwardCapture[4][kBatchLanes];
+  int backwardCapture[4][kBatchLanes];
+};
+
+void lookupAxesScalar(const Board *board, int player, bool captures, const int *cells, int count,
+                      AxisLookups &out) {
+  for (int axis = 0; axis < 4; ++axis) {
+    const unsigned int *codes = board->getLineCodes(axis);
+    for (int lane = 0; lane < count; ++lane) {
+      unsigned int combined = codes[cells[lane]];
+      out.score[axis][lane] = patternScoreTable[playerPatternIndex(combined, player)];
+      if (!captures) continue;
+      unsigned int backward =
+          reversePattern((combined >> kBackwardShift) & kSideMask, SIDE_WINDOW_SIZE);
+      out.forwardCapture[axis][lane] = checkCapture(combined & kSideMask, player);
+      out.backwardCapture[axis][lane] = checkCapture(backward, player);
+    }
+  }
+}
+
+#ifdef EVALUATION_BATCH_AVX2
+
+// checkCapture() on 8 window sides: CAPTURE where the three cells past the
+// nearest one read (opponent, opponent, player), -CAPTURE for (player, player,
+// opponent), else 0.
+__attribute__((target("avx2"))) inline __m256i captureCodes(__m256i side, int player) {
+  int opponent = OPPONENT(player);
+  __m256i cells = _mm256_srli_epi32(_mm256_and_si256(side, _mm256_set1_epi32(0xFC)), 2);
+  __m256i attack = _mm256_cmpeq_epi32(
+      cells, _mm256_set1_epi32((int)pack_cells_3(opponent, opponent, player)));
+  __m256i block =
+      _mm256_cmpeq_epi32(cells, _mm256_set1_epi32((int)pack_cells_3(player, player, opponent)));
+  return _mm256_or_si256(_mm256_and_si256(attack, _mm256_set1_epi32(CAPTURE)),
+                         _mm256_and_si256(block, _mm256_set1_epi32(-CAPTURE)));
+}
+
+// lookupAxesScalar for 8 lanes at once: gathers the line codes, turns them into
+// pattern indices, and gathers the table scores. Unused lanes read cell 0.
+__attribute__((target("avx2"))) void lookupAxesAvx2(const Board *board, int player, bool captures,
+                                                    const int *cells, int count,
+                                                    AxisLookups &out) {
+  int padded[kBatchLanes] = {0};
+  for (int lane = 0; lane < count; ++lane) padded[lane] = cells[lane];
+  const __m256i cellIndex = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(padded));
+  const __m256i sideMask = _mm256_set1_epi32((int)kSideMask);
+  const __m256i cellLow = _mm256_set1_epi32(0x55555555);
+
+  for (int axis = 0; axis < 4; ++axis) {
+    const int *codes = reinterpret_cast<const int *>(board->getLineCodes(axis));
+    __m256i combined = _mm256_i32gather_epi32(codes, cellIndex, 4);
+    __m256i forward = _mm256_and_si256(combined, sideMask);
+    __m256i backward = _mm256_and_si256(_mm256_srli_epi32(combined, kBackwardShift), sideMask);
+    // patternIndex(), then swapPatternPlayers() for PLAYER_2
+    __m256i index = _mm256_or_si256(_mm256_slli_epi32(backward, 2 * SIDE_WINDOW_SIZE), forward);
+    if (player != PLAYER_1) {
+      __m256i differ =
+          _mm256_and_si256(_mm256_xor_si256(index, _mm256_srli_epi32(index, 1)), cellLow);
+      index = _mm256_xor_si256(index, _mm256_or_si256(differ, _mm256_slli_epi32(differ, 1)));
+    }
+    __m256i score = _mm256_i32gather_epi32(patternScoreTable, index, 4);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out.score[axis]), score);
+    if (!captures) continue;
+
+    // reversePattern(backward, 4): the backward side is stored far cell first.
+    __m256i reversed = _mm256_or_si256(
+        _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(backward, _mm256_set1_epi32(0x03)), 6),
+                        _mm256_slli_epi32(_mm256_and_si256(backward, _mm256_set1_epi32(0x0C)), 2)),
+        _mm256_or_si256(_mm256_srli_epi32(_mm256_and_si256(backward, _mm256_set1_epi32(0x30)), 2),
+                        _mm256_srli_epi32(_mm256_and_si256(backward, _mm256_set1_epi32(0xC0)), 6)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out.forwardCapture[axis]),
+                        captureCodes(forward, player));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out.backwardCapture[axis]),
+                        captureCodes(reversed, player));
+  }
+}
+
+bool cpuHasAvx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+bool cpuHasAvx2() { return false; }
+
+#endif
+
+bool useAvx2 = cpuHasAvx2();
+
+// The rest of evaluatePosition for one lane: the same axis order and early exit
+// at GOMOKU, then the V patterns.
+int finishPosition(Board *board, int player, int x, int y, bool captures,
+                   const AxisLookups &lookups, int lane) {
+  int totalScore = 0;
+  for (int axis = 0; axis < 4; ++axis) {
+    int score = lookups.score[axis][lane];
+    if (captures)
+      score = addCaptureScore(board, player, score, lookups.forwardCapture[axis][lane],
+                              lookups.backwardCapture[axis][lane]);
+    totalScore += score;
+    if (totalScore >= GOMOKU) return totalScore;
+  }
+  for (int i = 1; i < 8; i += 2) totalScore += checkVPattern(board, player, x, y, i);
+  return totalScore;
+}
+
+}  // namespace
+
+bool setBatchSimd(bool enable) {
+  useAvx2 = enable && cpuHasAvx2();
+  return useAvx2;
+}
+
+void evaluatePositionBatch(Board *board, int player, const std::pair<int, int> *moves, int count,
+                           int *scores) {
+  bool captures = board->getEnableCapture();
+  AxisLookups lookups;
+  int cells[kBatchLanes];
+  for (int begin = 0; begin < count; begin += kBatchLanes) {
+    int lanes = std::min(kBatchLanes, count - begin);
+    for (int lane = 0; lane < lanes; ++lane)
+      cells[lane] = moves[begin + lane].second * BOARD_SIZE + moves[begin + lane].first;
+#ifdef EVALUATION_BATCH_AVX2
+    if (useAvx2)
+      lookupAxesAvx2(board, player, captures, cells, lanes, lookups);
+    else
+#endif
+      lookupAxesScalar(board, player, captures, cells, lanes, lookups);
+    for (int lane = 0; lane < lanes; ++lane) {
+      const std::pair<int, int> &move = moves[begin + lane];
+      scores[begin + lane] =
+          finishPosition(board, player, move.first, move.second, captures, lookups, lane);
+    }
+  }
+}
+
+}  // namespace Evaluation
@@ -3,6 +3,9 @@
 
 namespace Evaluation {
 
+static PatternEntry generatedTable[LOOKUP_TABLE_SIZE];
+const PatternEntry* patternTable = generatedTable;
+
 void printEvalEntry(EvaluationEntry eval) {
   std::cout << "=== EvalEntry ===" << std::endl;
   std::cout << "Score: " << eval.score << std::endl;
@@ -55,12 +58,7 @@ void printEvalEntry(EvaluationEntry eval) {
 }
 
 unsigned int extractLineAsBitsFromBoard(Board* board, int x, int y, int dx, int dy) {
-  unsigned int forwardBits = board->extractLineAsBits(x, y, dx, dy, SIDE_WINDOW_SIZE);
-  unsigned int backwardBits = board->extractLineAsBits(x, y, -dx, -dy, SIDE_WINDOW_SIZE);
-  unsigned int reversedBackwardBits = reversePattern(backwardBits, SIDE_WINDOW_SIZE);
-
-  return (reversedBackwardBits << (2 * (SIDE_WINDOW_SIZE + 1))) |
-         (WINDOW_CENTER_VALUE << (2 * SIDE_WINDOW_SIZE)) | forwardBits;
+  return board->getLineCode(x, y, dx, dy);
 }
 
 // It evaluates Continuous player's pattern & opponent's pattern
@@ -233,9 +231,32 @@ EvaluationEntry evaluateContinuousPatternHard(unsigned int backward, unsigned in
   return returnValue;
 }
 
+// Narrows a table-time evaluation to the packed form kept in patternTable.
+static PatternEntry packPatternEntry(const EvaluationEntry& eval) {
+  PatternEntry entry;
+  entry.score = (int16_t)eval.score;
+  entry.gomokuCount = (uint8_t)eval.counts.gomokuCount;
+  entry.openFourCount = (uint8_t)eval.counts.openFourCount;
+  entry.closedFourCount = (uint8_t)eval.counts.closedFourCount;
+  entry.openThreeCount = (uint8_t)eval.counts.openThreeCount;
+  entry.closedThreeCount = (uint8_t)eval.counts.closedThreeCount;
+  entry.openTwoCount = (uint8_t)eval.counts.openTwoCount;
+  entry.captureCount = (uint8_t)eval.counts.captureCount;
+  entry.gomokuBlockCount = (uint8_t)eval.counts.gomokuBlockCount;
+  entry.closedThreeBlockCount = (uint8_t)eval.counts.closedThreeBlockCount;
+  entry.openThreeBlockCount = (uint8_t)eval.counts.openThreeBlockCount;
+  entry.openTwoBlockCount = (uint8_t)eval.counts.openTwoBlockCount;
+  entry.openOneBlockCount = (uint8_t)eval.counts.openOneBlockCount;
+  entry.emptyThenOpenTwoBlockCount = (uint8_t)eval.counts.emptyThenOpenTwoBlockCount;
+  entry.captureVulnerable = (uint8_t)eval.counts.captureVulnerable;
+  entry.captureBlockCount = (uint8_t)eval.counts.captureBlockCount;
+  entry.captureThreatCount = (uint8_t)eval.counts.captureThreatCount;
+  return entry;
+}
+
 void initCombinedPatternScoreTablesHard() {
-  std::fill(patternPlayerOne, patternPlayerOne + LOOKUP_TABLE_SIZE, INVALID_ENTRY);
-  std::fill(patternPlayerTwo, patternPlayerTwo + LOOKUP_TABLE_SIZE, INVALID_ENTRY);
+  const PatternEntry invalid = packPatternEntry(EvaluationEntry(INVALID_PATTERN, PatternCounts()));
+  std::fill(generatedTable, generatedTable + LOOKUP_TABLE_SIZE, invalid);
 
   const unsigned int sideCount = 1 << (2 * SIDE_WINDOW_SIZE);
 
@@ -245,30 +266,18 @@ void initCombinedPatternScoreTablesHard() {
     for (unsigned int forward = 0; forward < sideCount; ++forward) {
       if (!isValidForwardPattern(forward)) continue;
 
-      // Build the full pattern:
-      // Left side occupies the highest 2*SIDE_WINDOW_SIZE bits,
-      // then the fixed center (2 bits),
-      // and then the forward side occupies the lowest 2*SIDE_WINDOW_SIZE bits.
-      unsigned int pattern = (backward << (2 * (SIDE_WINDOW_SIZE + 1))) |
-                             (WINDOW_CENTER_VALUE << (2 * SIDE_WINDOW_SIZE)) | forward;
-      patternPlayerOne[pattern] = evaluateContinuousPatternHard(backward, forward, PLAYER_1);
-      patternPlayerTwo[pattern] = evaluateContinuousPatternHard(backward, forward, PLAYER_2);
+      // Same layout as patternScoreTable: sides only, stored for PLAYER_1.
+      unsigned int index = (backward << (2 * SIDE_WINDOW_SIZE)) | forward;
+      generatedTable[index] =
+          packPatternEntry(evaluateContinuousPatternHard(backward, forward, PLAYER_1));
     }
   }
+  patternTable = generatedTable;
 }
 
-EvaluationEntry evaluateCombinedAxisHard(Board* board, int player, int x, int y, int dx, int dy) {
-  unsigned int forward = board->extractLineAsBits(x, y, dx, dy, SIDE_WINDOW_SIZE);
-  unsigned int backward = board->extractLineAsBits(x, y, -dx, -dy, SIDE_WINDOW_SIZE);
-  unsigned int revBackward = reversePattern(backward, SIDE_WINDOW_SIZE);
-
-  unsigned int combined =
-      (revBackward << (2 * (SIDE_WINDOW_SIZE + 1))) | (0 << (2 * SIDE_WINDOW_SIZE)) | forward;
-
-  if (player == PLAYER_1)
-    return patternPlayerOne[combined];
-  else
-    return patternPlayerTwo[combined];
+const PatternEntry& evaluateCombinedAxisHard(Board* board, int player, int x, int y, int dx,
+                                             int dy) {
+  return lookupPattern(board->getLineCode(x, y, dx, dy), player);
 }
 
 // Check if there is a Gomoku on a closed three pattern
@@ -288,10 +297,9 @@ static bool hasGomokuOnClosedThree(Board* board, int x, int y, int dx, int dy, i
 
       unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
 
-      EvaluationEntry evaluation =
-          player == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
+      const PatternEntry &evaluation = lookupPattern(combined, player);
 
-      if (evaluation.counts.gomokuCount > 0) {
+      if (evaluation.gomokuCount > 0) {
         return true;
       }
     }
@@ -311,10 +319,9 @@ static bool hasGomokuOnClosedThree(Board* board, int x, int y, int dx, int dy, i
 
       unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
 
-      EvaluationEntry evaluation =
-          player == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
+      const PatternEntry &evaluation = lookupPattern(combined, player);
 
-      if (evaluation.counts.gomokuCount > 0) {
+      if (evaluation.gomokuCount > 0) {
         return true;
       }
     }
@@ -351,16 +358,15 @@ static int hasCapturableOnOpponentCriticalLine(Board* board, int x, int y, int d
 
       unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
 
-      EvaluationEntry opponentEval =
-          opponent == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
+      const PatternEntry &opponentEval = lookupPattern(combined, opponent);
 
-      if (opponentEval.counts.openThreeCount) {
+      if (opponentEval.openThreeCount) {
         return 1;
       }
-      if (opponentEval.counts.openFourCount || opponentEval.counts.closedFourCount) {
+      if (opponentEval.openFourCount || opponentEval.closedFourCount) {
         return 2;
       }
-      if (opponentEval.counts.gomokuCount) {
+      if (opponentEval.gomokuCount) {
         return 3;
       }
     }
@@ -394,10 +400,9 @@ static bool hasCapturableOnPlayerVulnerableLine(Board* board, int x, int y, int
 
       unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
 
-      EvaluationEntry opponentEval =
-          opponent == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
+      const PatternEntry &opponentEval = lookupPattern(combined, opponent);
 
-      if (opponentEval.counts.captureThreatCount) {
+      if (opponentEval.captureThreatCount) {
         return true;
       }
     }
@@ -429,11 +434,10 @@ static bool hasCapturableOnPlayerCriticalLine(Board* board, int x, int y, int dx
       if ((checkDx == dx && checkDy == dy) || (checkDx == -dx && checkDy == -dy)) continue;
 
       unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
-      EvaluationEntry playerEval =
-          player == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
+      const PatternEntry &playerEval = lookupPattern(combined, player);
 
-      if (playerEval.counts.gomokuCount || playerEval.counts.openFourCount ||
-          playerEval.counts.closedFourCount) {
+      if (playerEval.gomokuCount || playerEval.openFourCount ||
+          playerEval.closedFourCount) {
         return true;
       }
     }
@@ -464,10 +468,9 @@ static bool hasCaptureBlockOnOpponentCriticalLine(Board* board, int x, int y, in
       if ((checkDx == dx && checkDy == dy) || (checkDx == -dx && checkDy == -dy)) continue;
 
       unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
-      EvaluationEntry opponentEval =
-          opponent == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
+      const PatternEntry &opponentEval = lookupPattern(combined, opponent);
 
-      if (opponentEval.counts.openFourCount || opponentEval.counts.gomokuCount) {
+      if (opponentEval.openFourCount || opponentEval.gomokuCount) {
         return true;
       }
     }
@@ -497,8 +500,7 @@ static bool hasCapturableBreakingGomoku(Board* board, int x, int y, int dx, int
       if ((checkDx == dx && checkDy == dy) || (checkDx == -dx && checkDy == -dy)) continue;
 
       unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
-      EvaluationEntry opponentEval =
-          opponent == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
+      const PatternEntry &opponentEval = lookupPattern(combined, opponent);
 
       // Check if opponent is about to catch player stone
       int _checkX = checkX;
@@ -506,7 +508,7 @@ static bool hasCapturableBreakingGomoku(Board* board, int x, int y, int dx, int
       int _checkDx = checkDx;
       int _checkDy = checkDy;
 
-      if (opponentEval.counts.openTwoBlockCount) {
+      if (opponentEval.openTwoBlockCount) {
         // Check if capture vulnerable stone is on gomoku
 
         if (!(board->getValueBit(_checkX + checkDx, _checkY + checkDy) == opponent &&
@@ -528,10 +530,9 @@ static bool hasCapturableBreakingGomoku(Board* board, int x, int y, int dx, int
               continue;
             unsigned int combined =
                 extractLineAsBitsFromBoard(board, _checkX, _checkY, _checkDx, _checkDy);
-            EvaluationEntry playerEval =
-                player == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
+            const PatternEntry &playerEval = lookupPattern(combined, player);
 
-            if (playerEval.counts.gomokuCount) {
+            if (playerEval.gomokuCount) {
               return true;
             }
           }
@@ -553,9 +554,8 @@ static bool isNonVulnerableLine(Board* board, int x, int y, int dx, int dy, int
 
     // middle
     unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
-    EvaluationEntry playerEval =
-        player == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
-    if (playerEval.counts.captureVulnerable > 0) {
+    const PatternEntry &playerEval = lookupPattern(combined, player);
+    if (playerEval.captureVulnerable > 0) {
       return false;
     }
 
@@ -564,9 +564,8 @@ static bool isNonVulnerableLine(Board* board, int x, int y, int dx, int dy, int
       checkX += dx;
       checkY += dy;
       unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
-      EvaluationEntry playerEval =
-          player == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
-      if (playerEval.counts.captureVulnerable > 0) {
+      const PatternEntry &playerEval = lookupPattern(combined, player);
+      if (playerEval.captureVulnerable > 0) {
         return false;
       }
     }
@@ -578,9 +577,8 @@ static bool isNonVulnerableLine(Board* board, int x, int y, int dx, int dy, int
       checkX -= dx;
       checkY -= dy;
       unsigned int combined = extractLineAsBitsFromBoard(board, checkX, checkY, checkDx, checkDy);
-      EvaluationEntry playerEval =
-          player == PLAYER_1 ? patternPlayerOne[combined] : patternPlayerTwo[combined];
-      if (playerEval.counts.captureVulnerable > 0) {
+      const PatternEntry &playerEval = lookupPattern(combined, player);
+      if (playerEval.captureVulnerable > 0) {
         return false;
       }
     }
@@ -589,6 +587,19 @@ static bool isNonVulnerableLine(Board* board, int x, int y, int dx, int dy, int
   return true;
 }
 
+// Axes (0..3) that matched some condition during one evaluation; fixed-size so the
+// evaluator does not allocate.
+struct DirectionList {
+  int dirs[4];
+  int count;
+
+  DirectionList() : count(0) {}
+  void push_back(int dir) { dirs[count++] = dir; }
+  void clear() { count = 0; }
+  const int* begin() const { return dirs; }
+  const int* end() const { return dirs + count; }
+};
+
 int evaluatePositionHard(Board* board, int player, int x, int y) {
   EvaluationEntry total;
   int activeCaptureScore = (player == board->getLastPlayer()) ? board->getLastPlayerScore()
@@ -597,24 +608,24 @@ int evaluatePositionHard(Board* board, int player, int x, int y) {
                                                                 : board->getLastPlayerScore();
 
   // for checking player's & opponent's capture direction
-  std::vector<int> captureDirections;
-  std::vector<int> opponentCaptureDirections;
-  std::vector<int> gomokuDirections;
-  std::vector<int> openFourDirections;
-  std::vector<int> closedFourDirections;
-  std::vector<int> captureBlockDirections;
+  DirectionList captureDirections;
+  DirectionList opponentCaptureDirections;
+  DirectionList gomokuDirections;
+  DirectionList openFourDirections;
+  DirectionList closedFourDirections;
+  DirectionList captureBlockDirections;
   for (int i = 0; i < 4; ++i) {
-    EvaluationEntry playerAxisScore =
+    const PatternEntry &playerAxisScore =
         evaluateCombinedAxisHard(board, player, x, y, DIRECTIONS[i][0], DIRECTIONS[i][1]);
-    EvaluationEntry opponentAxisScore =
+    const PatternEntry &opponentAxisScore =
         evaluateCombinedAxisHard(board, OPPONENT(player), x, y, DIRECTIONS[i][0], DIRECTIONS[i][1]);
     // when capture occurs, store the direction
-    if (playerAxisScore.counts.captureCount > 0) captureDirections.push_back(i);
-    if (opponentAxisScore.counts.captureCount > 0) opponentCaptureDirections.push_back(i);
-    if (playerAxisScore.counts.gomokuCount > 0) gomokuDirections.push_back(i);
-    if (playerAxisScore.counts.openFourCount > 0) openFourDirections.push_back(i);
-    if (playerAxisScore.counts.closedFourCount > 0) closedFourDirections.push_back(i);
-    if (playerAxisScore.counts.captureBlockCount > 0) captureBlockDirections.push_back(i);
+    if (playerAxisScore.captureCount > 0) captureDirections.push_back(i);
+    if (opponentAxisScore.captureCount > 0) opponentCaptureDirections.push_back(i);
+    if (playerAxisScore.gomokuCount > 0) gomokuDirections.push_back(i);
+    if (playerAxisScore.openFourCount > 0) openFourDirections.push_back(i);
+    if (playerAxisScore.closedFourCount > 0) closedFourDirections.push_back(i);
+    if (playerAxisScore.captureBlockCount > 0) captureBlockDirections.push_back(i);
     total += playerAxisScore;
   }
 
@@ -630,7 +641,7 @@ int evaluatePositionHard(Board* board, int player, int x, int y) {
   }
   // - 2) If the player can't win by breakable gomoku, he must solve it.
   if (board->getEnableCapture() && total.counts.closedThreeCount) {
-    for (std::vector<int>::iterator it = opponentCaptureDirections.begin();
+    for (const int* it = opponentCaptureDirections.begin();
          it != opponentCaptureDirections.end(); ++it) {
       int dx = DIRECTIONS[*it][0];
       int dy = DIRECTIONS[*it][1];
@@ -644,8 +655,7 @@ int evaluatePositionHard(Board* board, int player, int x, int y) {
 
   // - 3) If the player can make perfect gomoku, he must take it
   if (board->getEnableCapture() && total.counts.gomokuCount > 0) {
-    for (std::vector<int>::iterator it = gomokuDirections.begin(); it != gomokuDirections.end();
-         ++it) {
+    for (const int* it = gomokuDirections.begin(); it != gomokuDirections.end(); ++it) {
       int dx = DIRECTIONS[*it][0];
       int dy = DIRECTIONS[*it][1];
       bool isPerfect = isNonVulnerableLine(board, x, y, dx, dy, player);
@@ -658,8 +668,7 @@ int evaluatePositionHard(Board* board, int player, int x, int y) {
   }
 
   if (board->getEnableCapture() && total.counts.openFourCount > 0) {
-    for (std::vector<int>::iterator it = openFourDirections.begin(); it != openFourDirections.end();
-         ++it) {
+    for (const int* it = openFourDirections.begin(); it != openFourDirections.end(); ++it) {
       int dx = DIRECTIONS[*it][0];
       int dy = DIRECTIONS[*it][1];
       bool isPerfect = isNonVulnerableLine(board, x, y, dx, dy, player);
@@ -673,8 +682,7 @@ int evaluatePositionHard(Board* board, int player, int x, int y) {
   }
 
   if (board->getEnableCapture() && total.counts.closedFourCount > 0) {
-    for (std::vector<int>::iterator it = closedFourDirections.begin();
-         it != closedFourDirections.end(); ++it) {
+    for (const int* it = closedFourDirections.begin(); it != closedFourDirections.end(); ++it) {
       int dx = DIRECTIONS[*it][0];
       int dy = DIRECTIONS[*it][1];
       bool isPerfect = isNonVulnerableLine(board, x, y, dx, dy, player);
@@ -692,16 +700,14 @@ int evaluatePositionHard(Board* board, int player, int x, int y) {
 
   // - 1) If player can break opponent's open 3+ or 4 stone, he must break.
   if (board->getEnableCapture() && total.counts.captureCount > 0) {
-    for (std::vector<int>::iterator it = captureDirections.begin(); it != captureDirections.end();
-         ++it) {
+    for (const int* it = captureDirections.begin(); it != captureDirections.end(); ++it) {
       int dir = *it;
       int dx = DIRECTIONS[dir][0];
       int dy = DIRECTIONS[dir][1];
       // check if capturable spot is on parallel (X[.]XXO)
       unsigned int combined = extractLineAsBitsFromBoard(board, x, y, dx, dy);
-      EvaluationEntry opponentEval =
-          player == PLAYER_1 ? patternPlayerTwo[combined] : patternPlayerOne[combined];
-      if (opponentEval.counts.closedFourCount > 0) {
+      const PatternEntry &opponentEval = lookupPattern(combined, OPPONENT(player));
+      if (opponentEval.closedFourCount > 0) {
         total.counts.captureCriticalCount += 1;
       }
 
@@ -746,8 +752,7 @@ int evaluatePositionHard(Board* board, int player, int x, int y) {
 
   // - 2) If player can block capture on opponent's critical line, he must block
   if (board->getEnableCapture() && total.counts.captureBlockCount > 0) {
-    for (std::vector<int>::iterator it = captureBlockDirections.begin();
-         it != captureBlockDirections.end(); ++it) {
+    for (const int* it = captureBlockDirections.begin(); it != captureBlockDirections.end(); ++it) {
       int dx = DIRECTIONS[*it][0];
       int dy = DIRECTIONS[*it][1];
       if (hasCaptureBlockOnOpponentCriticalLine(board, x, y, dx, dy, player)) {
@@ -0,0 +1,159 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "Evaluation.hpp"
+
+namespace Evaluation {
+
+namespace {
+
+const char kMagic[8] = {'G', 'M', 'K', 'P', 'T', 'A', 'B', '\0'};
+const uint32_t kByteOrderMark = 0x01020304u;
+
+// File layout: header, then int[LOOKUP_TABLE_SIZE] (simple), then
+// PatternEntry[LOOKUP_TABLE_SIZE] (hard), in the writer's native byte order.
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t entryCount;
+  uint32_t entrySize;
+  uint64_t fingerprint;  // scoring constants the tables were generated with
+  uint64_t checksum;     // word-wise FNV-1a over both tables
+};
+
+const size_t kScoreTableBytes = LOOKUP_TABLE_SIZE * sizeof(int);
+const size_t kEntryTableBytes = LOOKUP_TABLE_SIZE * sizeof(PatternEntry);
+const size_t kFileBytes = sizeof(FileHeader) + kScoreTableBytes + kEntryTableBytes;
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 1469598103934665603ULL) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; ++i) hash = (hash ^ p[i]) * 1099511628211ULL;
+  return hash;
+}
+
+// FNV-1a folded over 64-bit words rather than bytes; it only has to catch truncated or
+// corrupted files, and it keeps verification well under the cost of regenerating.
+uint64_t fnv1aWords(const void *data, size_t size, uint64_t hash) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, p + i, sizeof(word));
+    hash = (hash ^ word) * 1099511628211ULL;
+  }
+  return fnv1a(p + (size & ~(size_t)7), size & 7, hash);
+}
+
+uint64_t tableChecksum(const int *scores, const PatternEntry *entries) {
+  uint64_t hash = fnv1aWords(scores, kScoreTableBytes, 1469598103934665603ULL);
+  return fnv1aWords(entries, kEntryTableBytes, hash);
+}
+
+}  // namespace
+
+// Catches a file built before a score constant was retuned without a version bump.
+uint64_t scoringFingerprint() {
+  const int invalid = INVALID_PATTERN;
+  uint64_t hash = fnv1a(continuousScores, sizeof(continuousScores));
+  hash = fnv1a(blockScores, sizeof(blockScores), hash);
+  return fnv1a(&invalid, sizeof(invalid), hash);
+}
+
+bool writePatternTables(const char *path) {
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = PATTERN_TABLE_FILE_VERSION;
+  header.byteOrder = kByteOrderMark;
+  header.entryCount = LOOKUP_TABLE_SIZE;
+  header.entrySize = sizeof(PatternEntry);
+  header.fingerprint = scoringFingerprint();
+  header.checksum = tableChecksum(patternScoreTable, patternTable);
+
+  // Write next to the target and rename, so a running server never maps a partial file.
+  std::string tmpPath = std::string(path) + ".tmp";
+  FILE *out = std::fopen(tmpPath.c_str(), "wb");
+  if (!out) {
+    std::cerr << "Pattern tables: cannot open " << tmpPath << " for writing" << std::endl;
+    return false;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+            std::fwrite(patternScoreTable, kScoreTableBytes, 1, out) == 1 &&
+            std::fwrite(patternTable, kEntryTableBytes, 1, out) == 1;
+  ok = (std::fclose(out) == 0) && ok;
+  if (!ok || std::rename(tmpPath.c_str(), path) != 0) {
+    std::cerr << "Pattern tables: failed to write " << path << std::endl;
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool mapPatternTables(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Pattern tables: cannot open " << path << std::endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size != kFileBytes) {
+    std::cerr << "Pattern tables: " << path << " has an unexpected size" << std::endl;
+    close(fd);
+    return false;
+  }
+  // MAP_SHARED read-only: every server process on the host shares the same page cache pages.
+  void *mem = mmap(NULL, kFileBytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    std::cerr << "Pattern tables: mmap of " << path << " failed" << std::endl;
+    return false;
+  }
+
+  const FileHeader *header = static_cast<const FileHeader *>(mem);
+  const char *base = static_cast<const char *>(mem);
+  const int *scores = reinterpret_cast<const int *>(base + sizeof(FileHeader));
+  const PatternEntry *entries =
+      reinterpret_cast<const PatternEntry *>(base + sizeof(FileHeader) + kScoreTableBytes);
+
+  const char *problem = NULL;
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0)
+    problem = "not a pattern table file";
+  else if (header->version != PATTERN_TABLE_FILE_VERSION)
+    problem = "version mismatch";
+  else if (header->byteOrder != kByteOrderMark || header->entryCount != LOOKUP_TABLE_SIZE ||
+           header->entrySize != sizeof(PatternEntry))
+    problem = "layout mismatch";
+  else if (header->fingerprint != scoringFingerprint())
+    problem = "built with different scoring constants";
+  else if (header->checksum != tableChecksum(scores, entries))
+    problem = "checksum mismatch";
+  if (problem) {
+    std::cerr << "Pattern tables: " << path << ": " << problem << std::endl;
+    munmap(mem, kFileBytes);
+    return false;
+  }
+
+  // The mapping lives for the rest of the process.
+  patternScoreTable = scores;
+  patternTable = entries;
+  return true;
+}
+
+void initPatternTables(const char *path) {
+  if (path && *path && mapPatternTables(path)) {
+    std::cout << "Pattern tables: mapped " << path << std::endl;
+    return;
+  }
+  initCombinedPatternScoreTables();
+  initCombinedPatternScoreTablesHard();
+  std::cout << "Pattern tables: generated" << std::endl;
+}
+
+}  // namespace Evaluation
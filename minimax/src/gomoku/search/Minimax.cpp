@@ -1,5 +1,7 @@
 #include "Minimax.hpp"
 
+#include <pthread.h>
+
 #include <cstdlib>
 #include <ctime>
 #include <limits>
@@ -7,55 +9,113 @@
 
 #include "Evaluation.hpp"
 
-boost::unordered_map<uint64_t, TTEntry> transTable;
+EngineContext::EngineContext(size_t ttMegabytes, size_t evalCacheMegabytes)
+    : transTable(ttMegabytes),
+      evalCache(evalCacheMegabytes),
+      rules(~0u),
+      evalSalt(0),
+      keySalt(0),
+      searchStartMs(0),
+      nodes(0),
+      evalProbes(0),
+      evalHits(0),
+      progress(NULL),
+      progressArg(NULL) {}
+
+SearchThread::SearchThread(EngineContext &engine, int threadId, volatile bool *stopFlag)
+    : context(&engine),
+      id(threadId),
+      threats(engine.threatCache),
+      stop(stopFlag),
+      nodes(0),
+      evalProbes(0),
+      evalHits(0),
+      timer(NULL) {
+  for (int d = 0; d <= MAX_DEPTH; ++d) {
+    killerMoves[d][0] = std::make_pair(-1, -1);
+    killerMoves[d][1] = std::make_pair(-1, -1);
+  }
+  for (int p = 0; p < 2; ++p) {
+    for (int sq = 0; sq < MAX_MOVES; ++sq) {
+      history[p][sq] = 0;
+      counterMoves[p][sq] = std::make_pair(-1, -1);
+    }
+  }
+}
 
 namespace Minimax {
 
 // ---- Constants & shared state -------------------------------------------------
 
-static const uint64_t rowMask = ((uint64_t)1 << BOARD_SIZE) - 1;
-static std::pair<int, int> killerMoves[MAX_DEPTH + 1][2];
 static const std::pair<int, int> kInvalidMove(-1, -1);
 
-// ---- Bitboard helpers ---------------------------------------------------------
-
-// Horizontal shifts for a row.
-inline uint64_t shiftRowLeft(uint64_t row) { return (row << 1) & rowMask; }
-inline uint64_t shiftRowRight(uint64_t row) { return row >> 1; }
-
-// Compute neighbor mask for each row based on occupancy.
-void computeNeighborMask(const uint64_t occupancy[BOARD_SIZE], uint64_t neighbor[BOARD_SIZE]) {
-  for (int i = 0; i < BOARD_SIZE; i++) {
-    uint64_t row = occupancy[i];
-    uint64_t horz = shiftRowLeft(row) | shiftRowRight(row) | row;
-    uint64_t vert = 0;
-    if (i > 0) vert |= occupancy[i - 1];
-    if (i < BOARD_SIZE - 1) vert |= occupancy[i + 1];
-    uint64_t diag = 0;
-    if (i > 0) {
-      diag |= shiftRowLeft(occupancy[i - 1]);
-      diag |= shiftRowRight(occupancy[i - 1]);
-    }
-    if (i < BOARD_SIZE - 1) {
-      diag |= shiftRowLeft(occupancy[i + 1]);
-      diag |= shiftRowRight(occupancy[i + 1]);
-    }
-    neighbor[i] = horz | vert | diag;
-  }
+// ---- Evaluation cache ---------------------------------------------------------
+//
+// Every evaluator call of the search goes through evaluate(). The key covers all
+// the evaluators read: stones, capture scores and side to move (the board hash),
+// the evaluator (the context's evalSalt), the player and the cell. The rules are
+// not in the key; beginSearch clears the cache when they change.
+
+inline uint64_t evalArgumentKey(int player, int x, int y) {
+  uint64_t index = ((uint64_t)player * (BOARD_SIZE + 1) + (x + 1)) * (BOARD_SIZE + 1) + (y + 1);
+  return (index + 1) * 0x9e3779b97f4a7c15ULL;
 }
 
-// ---- Move generation helpers --------------------------------------------------
+inline int evaluate(Board *board, int player, int x, int y, EvalFn evalFn, SearchThread &thread) {
+  EvalCache &cache = thread.context->evalCache;
+  uint64_t key = board->getHash() ^ thread.context->evalSalt ^ evalArgumentKey(player, x, y);
+  int score;
+  thread.evalProbes++;
+  if (cache.probe(key, score)) {
+    thread.evalHits++;
+    return score;
+  }
+  score = (*evalFn)(board, player, x, y);
+  cache.store(key, score);
+  return score;
+}
 
-inline uint64_t computeCandidateMask(uint64_t occupancyRow, uint64_t neighborRow) {
-  return neighborRow & (~occupancyRow) & rowMask;
+// evaluate() for every move of `moves`, into scores[i]. The cache misses of
+// evaluatePosition are scored together by its batch version.
+inline void evaluateMoves(Board *board, int player, const MoveList &moves, int *scores,
+                          EvalFn evalFn, SearchThread &thread) {
+  if (evalFn != &Evaluation::evaluatePosition) {
+    for (size_t i = 0; i < moves.size(); ++i)
+      scores[i] = evaluate(board, player, moves[i].first, moves[i].second, evalFn, thread);
+    return;
+  }
+  EvalCache &cache = thread.context->evalCache;
+  uint64_t boardKey = board->getHash() ^ thread.context->evalSalt;
+  uint64_t keys[MAX_MOVES];
+  std::pair<int, int> missed[MAX_MOVES];
+  int missedAt[MAX_MOVES];
+  int missCount = 0;
+  for (size_t i = 0; i < moves.size(); ++i) {
+    keys[i] = boardKey ^ evalArgumentKey(player, moves[i].first, moves[i].second);
+    if (cache.probe(keys[i], scores[i])) continue;
+    missed[missCount] = moves[i];
+    missedAt[missCount++] = (int)i;
+  }
+  thread.evalProbes += moves.size();
+  thread.evalHits += moves.size() - missCount;
+
+  int missedScores[MAX_MOVES];
+  Evaluation::evaluatePositionBatch(board, player, missed, missCount, missedScores);
+  for (int j = 0; j < missCount; ++j) {
+    scores[missedAt[j]] = missedScores[j];
+    cache.store(keys[missedAt[j]], missedScores[j]);
+  }
 }
 
+// ---- Move generation helpers --------------------------------------------------
+
 inline int initialExtreme(bool isMaximizing) {
   return isMaximizing ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max();
 }
 
-inline bool timeExceeded(clock_t start, clock_t limit) {
-  return (clock() - start) >= limit;
+// Per-node limit check; only the main thread carries a timer.
+inline void pollLimits(SearchThread &thread) {
+  if (thread.timer != NULL) thread.timer->poll(thread.nodes);
 }
 
 inline void updateBestAndBounds(bool isMaximizing, int eval, const std::pair<int, int> &mv,
@@ -76,67 +136,104 @@ inline void updateBestAndBounds(bool isMaximizing, int eval, const std::pair<int
   }
 }
 
-inline bool shouldIncludeMove(Board *board, int col, int row, int player,
-                              bool enableDoubleThreeRestriction) {
-  if (!enableDoubleThreeRestriction) return true;
-  if (!Rules::detectDoublethree(*board, col, row, player)) return true;
-
-  return false;
-}
-
 inline bool isCaptureMove(Board *board, int col, int row, int player) {
   return Rules::detectCaptureStonesNotStore(*board, col, row, player);
 }
 
 // ---- Move generation ----------------------------------------------------------
 
-// Generate candidate moves using row-based neighbor mask.
-std::vector<std::pair<int, int> > generateCandidateMoves(Board *&board) {
-  std::vector<std::pair<int, int> > moves;
-  uint64_t occupancy[BOARD_SIZE];
-  uint64_t neighbor[BOARD_SIZE];
-  int nextPlayer = board->getNextPlayer();
-  bool enableDoubleThreeRestriction = board->getEnableDoubleThreeRestriction();
-
-  board->getOccupancy(occupancy);
-  computeNeighborMask(occupancy, neighbor);
+// Generate candidate moves from the board's incrementally maintained neighbor mask.
+void generateCandidateMoves(Board *&board, MoveList &moves, CForbiddenPointFinder &finder) {
+  moves.clear();
+  uint64_t candidates[BOARD_SIZE];
+  board->getCandidateMask(candidates);
+
+  // Double-three squares are resolved for the whole node at once.
+  if (board->getEnableDoubleThreeRestriction()) {
+    uint64_t forbidden[BOARD_SIZE];
+    Rules::detectDoublethreeMask(*board, board->getNextPlayer(), candidates, forbidden, finder);
+    for (int row = 0; row < BOARD_SIZE; row++) candidates[row] &= ~forbidden[row];
+  }
 
   for (int row = 0; row < BOARD_SIZE; row++) {
-    uint64_t candidates = computeCandidateMask(occupancy[row], neighbor[row]);
-    for (int col = 0; col < BOARD_SIZE; col++) {
-      if (candidates & (1ULL << col)) {
-        if (shouldIncludeMove(board, col, row, nextPlayer, enableDoubleThreeRestriction))
-          moves.push_back(std::make_pair(col, row));
-      }
-    }
+    for (uint64_t bits = candidates[row]; bits; bits &= bits - 1)
+      moves.push_back(std::make_pair(__builtin_ctzll(bits), row));
   }
-  return moves;
 }
 
-std::vector<std::pair<int, int> > generateCaptureMoves(Board *&board) {
-  std::vector<std::pair<int, int> > moves;
-  uint64_t occupancy[BOARD_SIZE];
-  uint64_t neighbor[BOARD_SIZE];
+void generateCaptureMoves(Board *&board, MoveList &moves) {
+  moves.clear();
+  uint64_t candidates[BOARD_SIZE];
   int nextPlayer = board->getNextPlayer();
-
-  board->getOccupancy(occupancy);
-  computeNeighborMask(occupancy, neighbor);
+  board->getCandidateMask(candidates);
 
   for (int row = 0; row < BOARD_SIZE; row++) {
-    uint64_t candidates = computeCandidateMask(occupancy[row], neighbor[row]);
-    for (int col = 0; col < BOARD_SIZE; col++) {
-      if (candidates & (1ULL << col)) {
-        if (isCaptureMove(board, col, row, nextPlayer))
-          moves.push_back(std::make_pair(col, row));
+    for (uint64_t bits = candidates[row]; bits; bits &= bits - 1) {
+      int col = __builtin_ctzll(bits);
+      if (isCaptureMove(board, col, row, nextPlayer)) moves.push_back(std::make_pair(col, row));
+    }
+  }
+}
+
+// Threat moves for the side to move. Returns true when it wins on the spot: a
+// five to play, or a capture that reaches the goal. Otherwise, when the opponent
+// has a five to play, the node is `forced`, and `moves` holds the squares that
+// block it plus captures, which may break the line. If not, `moves` holds the
+// moves that make a four.
+bool generateThreatMoves(Board *board, MoveList &moves, bool &forced,
+                         CForbiddenPointFinder &finder) {
+  moves.clear();
+  forced = false;
+  int player = board->getNextPlayer();
+  int opponent = OPPONENT(player);
+  bool captures = board->getEnableCapture();
+  int captureRoom = board->getGoal() - board->getNextPlayerScore();
+  uint64_t candidates[BOARD_SIZE];
+  uint64_t fours[BOARD_SIZE], blocks[BOARD_SIZE], captureMask[BOARD_SIZE];
+  board->getCandidateMask(candidates);
+
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    fours[row] = blocks[row] = captureMask[row] = 0;
+    for (uint64_t bits = candidates[row]; bits; bits &= bits - 1) {
+      int col = __builtin_ctzll(bits);
+      uint64_t bit = bits & (0 - bits);
+      int pairs = 0;
+      for (int axis = 0; axis < 4; ++axis) {
+        unsigned int code =
+            board->getLineCode(col, row, DIRECTIONS[axis][0], DIRECTIONS[axis][1]);
+        const Evaluation::PatternEntry &own = Evaluation::lookupPattern(code, player);
+        if (own.gomokuCount) return true;
+        if (own.openFourCount || own.closedFourCount) fours[row] |= bit;
+        if (Evaluation::lookupPattern(code, opponent).gomokuCount) blocks[row] |= bit;
+        pairs += own.captureCount;
+      }
+      if (captures && pairs > 0 && isCaptureMove(board, col, row, player)) {
+        if (pairs >= captureRoom) return true;
+        captureMask[row] |= bit;
       }
     }
   }
-  return moves;
+
+  for (int row = 0; row < BOARD_SIZE && !forced; ++row) forced = blocks[row] != 0;
+  for (int row = 0; row < BOARD_SIZE; ++row)
+    candidates[row] = forced ? blocks[row] | captureMask[row] : fours[row];
+
+  if (board->getEnableDoubleThreeRestriction()) {
+    uint64_t forbidden[BOARD_SIZE];
+    Rules::detectDoublethreeMask(*board, player, candidates, forbidden, finder);
+    for (int row = 0; row < BOARD_SIZE; row++) candidates[row] &= ~forbidden[row];
+  }
+
+  for (int row = 0; row < BOARD_SIZE; row++) {
+    for (uint64_t bits = candidates[row]; bits; bits &= bits - 1)
+      moves.push_back(std::make_pair(__builtin_ctzll(bits), row));
+  }
+  return false;
 }
 
 // ---- Debug utilities ----------------------------------------------------------
 
-void printBoardWithCandidates(Board *&board, const std::vector<std::pair<int, int> > &candidates) {
+void printBoardWithCandidates(Board *&board, const MoveList &candidates) {
   // Create a 2D display grid.
   std::vector<std::vector<char> > display(BOARD_SIZE, std::vector<char>(BOARD_SIZE, '.'));
   for (int y = 0; y < BOARD_SIZE; y++) {
@@ -164,18 +261,46 @@ void printBoardWithCandidates(Board *&board, const std::vector<std::pair<int, in
   std::cout << std::flush;
 }
 
-// ---- Killer moves -------------------------------------------------------------
+// ---- Killer, history and countermove heuristics --------------------------------
+
+// Helper: check if a move is a killer move for a given depth.
+bool isKillerMove(const SearchThread &thread, int depth, const std::pair<int, int> &move) {
+  return (thread.killerMoves[depth][0] == move || thread.killerMoves[depth][1] == move);
+}
+
+void recordKillerMove(SearchThread &thread, int depth, const std::pair<int, int> &move) {
+  if (isKillerMove(thread, depth, move)) return;
+  thread.killerMoves[depth][1] = thread.killerMoves[depth][0];
+  thread.killerMoves[depth][0] = move;
+}
 
-void initKillerMoves() {
-  for (int d = 0; d < MAX_DEPTH; ++d) {
-    killerMoves[d][0] = kInvalidMove;
-    killerMoves[d][1] = kInvalidMove;
+// History scores are halved once one exceeds this, so old cutoffs fade out.
+static const int kHistoryLimit = 1 << 20;
+// A countermove ranks ahead of any history score.
+static const int kCounterMoveBonus = 2 * kHistoryLimit;
+
+inline int squareIndex(int col, int row) { return row * BOARD_SIZE + col; }
+
+// Killer, history and countermove bookkeeping for a move that caused a cutoff.
+// `player` made the move; (lastX, lastY) is the opponent move it answered.
+void recordCutoff(SearchThread &thread, int player, int depth, const std::pair<int, int> &move,
+                  int lastX, int lastY) {
+  recordKillerMove(thread, depth, move);
+  int *history = thread.history[player - 1];
+  int &entry = history[squareIndex(move.first, move.second)];
+  entry += depth * depth;
+  if (entry > kHistoryLimit) {
+    for (int sq = 0; sq < MAX_MOVES; ++sq) history[sq] /= 2;
   }
+  if (lastX >= 0) thread.counterMoves[player - 1][squareIndex(lastX, lastY)] = move;
 }
 
-// Helper: check if a move is a killer move for a given depth.
-bool isKillerMove(int depth, const std::pair<int, int> &move) {
-  return (killerMoves[depth][0] == move || killerMoves[depth][1] == move);
+inline int historyScore(const SearchThread &thread, int player, const std::pair<int, int> &move,
+                        int lastX, int lastY) {
+  int score = thread.history[player - 1][squareIndex(move.first, move.second)];
+  if (lastX >= 0 && thread.counterMoves[player - 1][squareIndex(lastX, lastY)] == move)
+    score += kCounterMoveBonus;
+  return score;
 }
 
 // Comparator functor for sorting ScoredMoves for the Maximizing player
@@ -184,7 +309,8 @@ struct CompareScoredMovesMax {
     if (a.is_killer && !b.is_killer) return true;  // Killer moves first
     if (!a.is_killer && b.is_killer) return false;
     // If killer status is the same, sort by score descending (best first)
-    return a.score > b.score;
+    if (a.score != b.score) return a.score > b.score;
+    return a.history > b.history;
   }
 };
 
@@ -194,19 +320,22 @@ struct CompareScoredMovesMin {
     if (a.is_killer && !b.is_killer) return true;  // Killer moves first
     if (!a.is_killer && b.is_killer) return false;
     // If killer status is the same, sort by score ascending (best first)
-    return a.score < b.score;
+    if (a.score != b.score) return a.score < b.score;
+    return a.history > b.history;
   }
 };
 
 // ---- Search helpers -----------------------------------------------------------
 
 int quiescenceSearch(Board *board, int alpha, int beta, bool isMaximizing, int x, int y, int depth,
-                     EvalFn evalFn) {
+                     EvalFn evalFn, SearchThread &thread) {
+  thread.nodes++;
+  pollLimits(thread);
   // 1. Evaluate Stand-Pat Score
   //    Perspective is crucial. Evaluate from the point of view of the player whose turn it is.
   int playerWhoseTurnItIs = board->getNextPlayer();
   // Use -1,-1 or appropriate dummy coords if last move isn't relevant here
-  int stand_pat_score = (*evalFn)(board, playerWhoseTurnItIs, x, y);
+  int stand_pat_score = evaluate(board, playerWhoseTurnItIs, x, y, evalFn, thread);
   // 2. Initial Pruning based on Stand-Pat
   if (isMaximizing) {
     if (stand_pat_score >= beta) {
@@ -223,8 +352,11 @@ int quiescenceSearch(Board *board, int alpha, int beta, bool isMaximizing, int x
   }
 
   board->flushCaptures();
-  // 3. Generate Only Capture Moves
-  std::vector<std::pair<int, int> > captureMoves = generateCaptureMoves(board);
+  // 3. Generate Only Capture Moves, into the thread's quiescence stack. Capture
+  //    chains rarely run long; past QUIESCENCE_MAX_PLY the stand-pat score holds.
+  if (depth >= QUIESCENCE_MAX_PLY) return stand_pat_score;
+  MoveList &captureMoves = thread.quiescenceStack[depth];
+  generateCaptureMoves(board, captureMoves);
 
   // 4. Base Case: No captures means position is quiet
   if (captureMoves.empty()) {
@@ -237,8 +369,9 @@ int quiescenceSearch(Board *board, int alpha, int beta, bool isMaximizing, int x
     UndoInfo info = board->makeMove(captureMoves[i].first, captureMoves[i].second);
     // Recursively call quiescence search for the opponent
     int eval = quiescenceSearch(board, alpha, beta, !isMaximizing, captureMoves[i].first,
-                                captureMoves[i].second, depth + 1, evalFn);
+                                captureMoves[i].second, depth + 1, evalFn, thread);
     board->undoMove(info);
+    if (thread.aborted()) return bestEval;
 
     if (isMaximizing) {
       bestEval = std::max(bestEval, eval);  // Update best score found
@@ -257,14 +390,233 @@ int quiescenceSearch(Board *board, int alpha, int beta, bool isMaximizing, int x
   return bestEval;
 }
 
-inline bool probeTT(Board *board, int depth, int &alpha, int &beta, std::pair<int, int> &bestMove,
-                    int &scoreOut) {
-  uint64_t h = board->getHash();
-  boost::unordered_map<uint64_t, TTEntry>::iterator it = transTable.find(h);
-  if (it == transTable.end()) return false;
+// Outcome of threatQuiescence for the side to move.
+enum ThreatOutcome { THREAT_QUIET, THREAT_WIN, THREAT_LOSS };
+
+// Threat quiescence below the nominal depth. The side to move either answers a
+// five threat (blocks and captures) or plays a four, for at most
+// QUIESCENCE_MAX_PLY plies; it may always stop instead of attacking. Only the
+// outcome is searched: several leaf scores count as terminal (blocking a four
+// rates BLOCK_GOMOKU), so the evaluator cannot tell a forced five from a threat
+// that is answered. Expects a board whose captures are flushed.
+ThreatOutcome threatQuiescence(Board *board, int ply, SearchThread &thread) {
+  thread.nodes++;
+  pollLimits(thread);
+  if (ply >= QUIESCENCE_MAX_PLY || thread.aborted()) return THREAT_QUIET;
+
+  MoveList &moves = thread.quiescenceStack[ply];
+  bool forced;
+  if (generateThreatMoves(board, moves, forced, thread.finder)) return THREAT_WIN;
+
+  // A forced node with no reply that holds is lost; a free one can stand pat.
+  ThreatOutcome outcome = forced ? THREAT_LOSS : THREAT_QUIET;
+  for (size_t i = 0; i < moves.size(); ++i) {
+    UndoInfo info = board->makeMove(moves[i].first, moves[i].second);
+    board->flushCaptures();
+    ThreatOutcome reply = threatQuiescence(board, ply + 1, thread);
+    board->undoMove(info);
+    if (thread.aborted()) return THREAT_QUIET;
+    if (reply == THREAT_LOSS) return THREAT_WIN;
+    if (reply == THREAT_QUIET) outcome = THREAT_QUIET;
+  }
+  return outcome;
+}
+
+// The quiescence search ignores some defences (a capture threat against the
+// completing stone, a five that can be broken), so the threat solver confirms
+// what it found: a VCF for the side to move, or one for the opponent after
+// every reply.
+bool confirmOutcome(Board *board, ThreatOutcome outcome, SearchThread &thread) {
+  static const int kAttackerMoves = QUIESCENCE_MAX_PLY / 2;
+  std::pair<int, int> move;
+  if (outcome == THREAT_WIN) {
+    bool won = thread.threats.findWin(board, ThreatSearch::VCF, kAttackerMoves,
+                                      THREAT_PROBE_NODE_LIMIT, move);
+    thread.nodes += thread.threats.nodes();
+    return won;
+  }
+  MoveList &replies = thread.quiescenceStack[0];
+  generateCandidateMoves(board, replies, thread.finder);
+  for (size_t i = 0; i < replies.size(); ++i) {
+    UndoInfo info = board->makeMove(replies[i].first, replies[i].second);
+    board->flushCaptures();
+    bool lost = thread.threats.findWin(board, ThreatSearch::VCF, kAttackerMoves,
+                                       THREAT_PROBE_NODE_LIMIT, move);
+    thread.nodes += thread.threats.nodes();
+    board->undoMove(info);
+    if (!lost) return false;
+  }
+  return true;
+}
+
+// Score of a node whose last move the evaluator rates as terminal. A five counts
+// for the side that made it, like the quiescence and threat-probe wins, so the
+// minimizing side's fives are negative; lesser terminal ratings keep their sign.
+inline int terminalScore(int eval, bool isMaximizing) {
+  return eval >= GOMOKU && isMaximizing ? -eval : eval;
+}
+
+// Depth-0 score: a forced threat sequence overrides the static `eval`. Wins are
+// scored for the side to move, as in the pvs() threat probe.
+inline int leafScore(Board *board, int eval, bool isMaximizing, SearchThread &thread) {
+  if (!thread.context->tuning.quiescence) return eval;
+  ThreatOutcome outcome = threatQuiescence(board, 0, thread);
+  if (outcome == THREAT_QUIET || thread.aborted() || !confirmOutcome(board, outcome, thread))
+    return eval;
+  return (outcome == THREAT_WIN) == isMaximizing ? GOMOKU : -GOMOKU;
+}
+
+// ---- Transposition table session --------------------------------------------
+//
+// A context's table survives between its searches. Each search bumps its
+// generation, so entries from earlier moves still order moves but are evicted
+// first. Keys are salted per evaluator, which keeps easy/medium and hard scores
+// apart without a clear, and per root side: a node maximizes for the side that
+// started the search, so the opponent's searches score it the other way round.
+// Only a change of rules (goal, capture, double-three) wipes the tables.
+
+static const unsigned int kNoRules = ~0u;
+
+// Adds one thread's counters to the totals of the current search.
+inline void addThreadStats(const SearchThread &thread) {
+  EngineContext &engine = *thread.context;
+  engine.nodes += thread.nodes;
+  engine.evalProbes += thread.evalProbes;
+  engine.evalHits += thread.evalHits;
+}
+
+// TT key of the position on the board. With symmetric hashing all 8 orientations
+// share one key; `symmetry` then maps this board onto the orientation the entry's
+// move is stored in.
+inline uint64_t positionKey(const EngineContext &engine, const Board *board, int &symmetry) {
+  return board->getCanonicalHash(symmetry) ^ engine.keySalt;
+}
+
+inline std::pair<int, int> storedMove(int symmetry, const std::pair<int, int> &mv) {
+  if (symmetry == 0 || mv.first < 0) return mv;
+  return symmetricMove(symmetry, mv.first, mv.second);
+}
+
+inline std::pair<int, int> boardMove(int symmetry, const std::pair<int, int> &mv) {
+  if (symmetry == 0 || mv.first < 0) return mv;
+  return inverseSymmetricMove(symmetry, mv.first, mv.second);
+}
+
+// Fixed ids for the built-in evaluators: function addresses move between runs,
+// and TT snapshots need the same keys after a restart.
+uint64_t evaluatorSalt(EvalFn evalFn) {
+  uint64_t x = (uint64_t)(size_t)evalFn;
+  if (evalFn == &Evaluation::evaluatePosition)
+    x = 1;
+  else if (evalFn == &Evaluation::evaluatePositionHard)
+    x = 2;
+  // splitmix64 finalizer
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// Must run on the calling thread before any helper is started.
+// The settings a TT entry depends on besides the stones (see EngineContext::rules).
+inline unsigned int boardRules(const Board *board) {
+  return (unsigned int)board->getGoal() | (board->getEnableCapture() ? 1u << 8 : 0) |
+         (board->getEnableDoubleThreeRestriction() ? 1u << 9 : 0);
+}
+
+void beginSearch(EngineContext &engine, Board *board, EvalFn evalFn) {
+  unsigned int rules = boardRules(board);
+  if (rules != engine.rules) {
+    if (engine.rules != kNoRules) std::cout << "Rule set changed: clearing TT" << std::endl;
+    engine.transTable.clear();
+    engine.threatCache.clear();
+    engine.evalCache.clear();
+    engine.rules = rules;
+  }
+  engine.evalSalt = evaluatorSalt(evalFn);
+  engine.keySalt = engine.evalSalt;
+  if (board->getNextPlayer() == PLAYER_2) engine.keySalt = ~engine.keySalt;
+  // Helpers copy the root board, and with it this setting.
+  board->setSymmetricHashing(engine.tuning.symmetricHashing);
+  engine.transTable.newSearch();
+  engine.searchStartMs = TimeManager::nowMs();
+  engine.nodes = 0;
+  engine.evalProbes = 0;
+  engine.evalHits = 0;
+}
 
-  const TTEntry &e = it->second;
-  bestMove = e.bestMove;
+unsigned long long lastSearchNodes(const EngineContext &engine) { return engine.nodes; }
+unsigned long long lastEvalProbes(const EngineContext &engine) { return engine.evalProbes; }
+unsigned long long lastEvalHits(const EngineContext &engine) { return engine.evalHits; }
+SearchResult lastSearchResult(const EngineContext &engine) { return engine.result; }
+
+bool predictReply(const EngineContext &engine, const Board *board, std::pair<int, int> &reply) {
+  if (engine.rules != boardRules(board)) return false;
+  int symmetry;
+  TTEntry e;
+  if (!engine.transTable.probe(positionKey(engine, board, symmetry), e)) return false;
+  reply = boardMove(symmetry, e.bestMove);
+  return Board::isValidCoordinate(reply.first, reply.second) &&
+         board->getValueBit(reply.first, reply.second) == EMPTY_SPACE;
+}
+
+// Snapshot entries are only valid under the same Zobrist keys and scoring.
+uint64_t snapshotTag() {
+  uint64_t tag = Evaluation::scoringFingerprint();
+  tag = (tag ^ ZOBRIST_SEED) * 1099511628211ULL;
+  tag = (tag ^ ZOBRIST_KEY_VERSION) * 1099511628211ULL;
+  return (tag ^ PATTERN_TABLE_FILE_VERSION) * 1099511628211ULL;
+}
+
+bool saveTTSnapshot(const EngineContext &engine, const char *path) {
+  if (engine.rules == kNoRules) return false;  // nothing searched yet
+  return engine.transTable.saveSnapshot(path, TT_SNAPSHOT_MIN_DEPTH, snapshotTag(), engine.rules);
+}
+
+bool saveTTSnapshot(const std::vector<const EngineContext *> &engines, const char *path) {
+  const EngineContext *latest = NULL;
+  for (size_t i = 0; i < engines.size(); ++i) {
+    if (engines[i]->rules == kNoRules) continue;
+    if (latest == NULL || engines[i]->searchStartMs > latest->searchStartMs) latest = engines[i];
+  }
+  if (latest == NULL) return false;
+  TTSnapshot snapshot;
+  snapshot.rules = latest->rules;
+  for (size_t i = 0; i < engines.size(); ++i)
+    if (engines[i]->rules == latest->rules)
+      engines[i]->transTable.collectSnapshot(TT_SNAPSHOT_MIN_DEPTH, snapshot);
+  // A position several contexts searched is kept once, and the file must fit a table.
+  TranspositionTable::keepDeepest(snapshot, latest->transTable.entryCount());
+  return TranspositionTable::writeSnapshot(path, snapshotTag(), snapshot);
+}
+
+bool readTTSnapshot(const EngineContext &engine, const char *path, TTSnapshot &snapshot) {
+  if (!TranspositionTable::readSnapshot(path, snapshotTag(), engine.transTable.entryCount(),
+                                        snapshot))
+    return false;
+  std::cout << "TT snapshot: read " << snapshot.entryCount() << " entries from " << path
+            << std::endl;
+  return true;
+}
+
+void restoreTTSnapshot(EngineContext &engine, const TTSnapshot &snapshot) {
+  engine.transTable.restoreSnapshot(snapshot);
+  // The table now holds these rules' entries; a search under other rules clears it.
+  engine.rules = snapshot.rules;
+}
+
+bool loadTTSnapshot(EngineContext &engine, const char *path) {
+  TTSnapshot snapshot;
+  if (!readTTSnapshot(engine, path, snapshot)) return false;
+  restoreTTSnapshot(engine, snapshot);
+  return true;
+}
+
+inline bool probeTT(EngineContext &engine, Board *board, int depth, int &alpha, int &beta,
+                    std::pair<int, int> &bestMove, int &scoreOut) {
+  int symmetry;
+  TTEntry e;
+  if (!engine.transTable.probe(positionKey(engine, board, symmetry), e)) return false;
+  bestMove = boardMove(symmetry, e.bestMove);
 
   if (e.depth < depth) return false;  // only ordering info
   scoreOut = e.score;
@@ -284,25 +636,27 @@ inline bool probeTT(Board *board, int depth, int &alpha, int &beta, std::pair<in
   return false;
 }
 
-inline void storeTT(uint64_t hash, int depth, const std::pair<int, int> &mv, int score, int alpha0,
-                    int beta) {
+inline void storeTT(EngineContext &engine, uint64_t key, int symmetry, int depth,
+                    const std::pair<int, int> &mv, int score, int alpha0, int beta) {
   BoundType flag = EXACT;
   if (score <= alpha0)
     flag = UPPERBOUND;
   else if (score >= beta)
     flag = LOWERBOUND;
 
-  transTable[hash] = TTEntry(score, depth, mv, flag);
+  engine.transTable.store(key, TTEntry(score, depth, storedMove(symmetry, mv), flag));
 }
 
-inline void scoreAndSortMoves(Board *board, const std::vector<std::pair<int, int> > &in, int player,
-                              int depth, bool maxSide, std::vector<ScoredMove> &out, EvalFn eval) {
-  out.reserve(in.size());
+inline void scoreAndSortMoves(Board *board, const MoveList &in, int player, int depth,
+                              bool maxSide, int lastX, int lastY, ScoredMoveList &out, EvalFn eval,
+                              SearchThread &thread) {
+  out.clear();
+  int scores[MAX_MOVES];
+  evaluateMoves(board, player, in, scores, eval, thread);
   for (size_t i = 0; i < in.size(); ++i) {
     const std::pair<int, int> &m = in[i];
-    int s = (*eval)(board, player, m.first, m.second);
-    bool k = (killerMoves[depth][0] == m) || (killerMoves[depth][1] == m);
-    out.push_back(ScoredMove(s, m, k));
+    bool k = isKillerMove(thread, depth, m);
+    out.push_back(ScoredMove(scores[i], m, k, historyScore(thread, player, m, lastX, lastY)));
   }
   if (maxSide)
     std::sort(out.begin(), out.end(), CompareScoredMovesMax());
@@ -312,7 +666,7 @@ inline void scoreAndSortMoves(Board *board, const std::vector<std::pair<int, int
 
 inline bool processHashMove(Board *board, const std::pair<int, int> &mv, int depth, int &alpha,
                             int &beta, bool isMaximizing, std::pair<int, int> &bestMoveOut,
-                            int &bestEvalOut, EvalFn evalFn) {
+                            int &bestEvalOut, EvalFn evalFn, SearchThread &thread) {
   if (mv.first < 0) return false;  // no move to try
 
   // make
@@ -320,7 +674,7 @@ inline bool processHashMove(Board *board, const std::pair<int, int> &mv, int dep
 
   // recurse
   int score = minimax(board, depth - 1, alpha, beta, board->getNextPlayer(), mv.first, mv.second,
-                      !isMaximizing, evalFn);
+                      !isMaximizing, evalFn, thread);
 
   // undo
   board->undoMove(ui);
@@ -337,31 +691,31 @@ inline bool processHashMove(Board *board, const std::pair<int, int> &mv, int dep
 }
 
 inline bool tryMoveAndCutoff(Board *board, const std::pair<int, int> &mv, int depth, int &alpha,
-                             int &beta, bool isMaximizing, int initialAlpha, uint64_t currentHash,
-                             std::pair<int, int> &bestMoveForNode, int &bestEval, EvalFn evalFn) {
+                             int &beta, bool isMaximizing, int initialAlpha, uint64_t key,
+                             int symmetry, int lastX, int lastY,
+                             std::pair<int, int> &bestMoveForNode, int &bestEval, EvalFn evalFn,
+                             SearchThread &thread) {
   // 1) make
   UndoInfo ui = board->makeMove(mv.first, mv.second);
 
   // 2) recurse
   int nextPlayer = board->getNextPlayer();
   int eval = minimax(board, depth - 1, alpha, beta, nextPlayer, mv.first, mv.second, !isMaximizing,
-                     evalFn);
+                     evalFn, thread);
 
   // 3) undo
   board->undoMove(ui);
+  if (thread.aborted()) return true;  // unwind without touching TT or killers
 
   // 4) update bestEval & α/β
   updateBestAndBounds(isMaximizing, eval, mv, bestEval, bestMoveForNode, alpha, beta);
 
-  // 5) on cutoff, record killer & TT and tell caller to exit
+  // 5) on cutoff, record killer/history/countermove & TT and tell caller to exit
   if (alpha >= beta) {
-    // killer
-    if (killerMoves[depth][0] != mv && killerMoves[depth][1] != mv) {
-      killerMoves[depth][1] = killerMoves[depth][0];
-      killerMoves[depth][0] = mv;
-    }
+    // move-ordering heuristics
+    recordCutoff(thread, board->getNextPlayer(), depth, mv, lastX, lastY);
     // transposition table
-    storeTT(currentHash, depth, bestMoveForNode, bestEval, initialAlpha, beta);
+    storeTT(*thread.context, key, symmetry, depth, bestMoveForNode, bestEval, initialAlpha, beta);
     return true;
   }
 
@@ -371,107 +725,126 @@ inline bool tryMoveAndCutoff(Board *board, const std::pair<int, int> &mv, int de
 // ---- Main search --------------------------------------------------------------
 
 int minimax(Board *board, int depth, int alpha, int beta, int currentPlayer, int lastX, int lastY,
-            bool isMaximizing, EvalFn evalFn) {
+            bool isMaximizing, EvalFn evalFn, SearchThread &thread) {
+  EngineContext &engine = *thread.context;
+  thread.nodes++;
+  pollLimits(thread);
+  if (thread.aborted()) {
+    board->flushCaptures();
+    return 0;
+  }
   // --- Alpha-Beta Preamble ---
   int initial_alpha = alpha;            // Store original alpha for TT storing logic later
-  uint64_t preHash = board->getHash();  // *** Requires Board::getHash() ***
+  int preSymmetry;
+  uint64_t preKey = positionKey(engine, board, preSymmetry);
   std::pair<int, int> bestMoveFromTT = kInvalidMove;  // Candidate Hash Move from TT
   int ttScore;
-  if (probeTT(board, depth, alpha, beta, bestMoveFromTT, ttScore)) return ttScore;
+  if (probeTT(engine, board, depth, alpha, beta, bestMoveFromTT, ttScore)) return ttScore;
 
   int playerWhoJustMoved = (currentPlayer == PLAYER_1) ? PLAYER_2 : PLAYER_1;
-  int evalScore = (*evalFn)(board, playerWhoJustMoved, lastX, lastY);
+  int evalScore = evaluate(board, playerWhoJustMoved, lastX, lastY, evalFn, thread);
   if (lastX != -1 && evalScore >= MINIMAX_TERMINATION) {
     board->flushCaptures();
-    return evalScore;
+    return terminalScore(evalScore, isMaximizing);
   }
 
   if (depth == 0) {
+    // Two passes that answer different questions. The capture quiescence plays
+    // out capture exchanges to refine the static score; it plays captures only,
+    // so a five forced through fours goes unseen. leafScore then asks only
+    // whether a forced five decides the node, which overrides any score. Both
+    // use quiescenceStack from ply 0, one after the other.
     if (board->getEnableCapture())
-      evalScore = quiescenceSearch(board, alpha, beta, isMaximizing, lastX, lastY, depth, evalFn);
+      evalScore =
+          quiescenceSearch(board, alpha, beta, isMaximizing, lastX, lastY, depth, evalFn, thread);
     board->flushCaptures();
-    return evalScore;
+    return leafScore(board, evalScore, isMaximizing, thread);
   }
 
   int bestEval = initialExtreme(isMaximizing);
   std::pair<int, int> bestFromNode(kInvalidMove);
 
+  // The hash move is played on the flushed board too: captures left pending
+  // would pile up along a line of hash moves and be restored by the wrong undo.
+  board->flushCaptures();
   if (processHashMove(board, bestMoveFromTT, depth, alpha, beta, isMaximizing, bestFromNode,
-                      bestEval, evalFn)) {
-    storeTT(preHash, depth, bestFromNode, bestEval, initial_alpha, beta);
+                      bestEval, evalFn, thread)) {
+    if (!thread.aborted())
+      storeTT(engine, preKey, preSymmetry, depth, bestFromNode, bestEval, initial_alpha, beta);
     return bestEval;
   }
+  if (thread.aborted()) return bestEval;
 
-  board->flushCaptures();
-  uint64_t currentHash = board->getHash();  // *** Requires Board::getHash() ***
+  int symmetry;
+  uint64_t key = positionKey(engine, board, symmetry);
   // Generate candidate moves.
-  std::vector<std::pair<int, int> > moves = generateCandidateMoves(board);
+  MoveList &moves = thread.moveStack[depth];
+  generateCandidateMoves(board, moves, thread.finder);
   if (moves.empty()) {
-    int final_eval = (*evalFn)(board, currentPlayer, lastX, lastY);
+    int final_eval = evaluate(board, currentPlayer, lastX, lastY, evalFn, thread);
     // Store this terminal evaluation in TT
-    transTable[currentHash] = TTEntry(final_eval, depth, kInvalidMove, EXACT);
+    engine.transTable.store(key, TTEntry(final_eval, depth, kInvalidMove, EXACT));
     return final_eval;
   }
 
   std::pair<int, int> bestMoveForNode = kInvalidMove;
 
-  std::vector<ScoredMove> scored_moves;
-  scoreAndSortMoves(board, moves, currentPlayer, depth, isMaximizing, scored_moves, evalFn);
+  ScoredMoveList &scored_moves = thread.scoredStack[depth];
+  scoreAndSortMoves(board, moves, currentPlayer, depth, isMaximizing, lastX, lastY, scored_moves,
+                    evalFn, thread);
 
-  for (std::vector<ScoredMove>::const_iterator it = scored_moves.begin(); it != scored_moves.end();
-       ++it) {
+  for (const ScoredMove *it = scored_moves.begin(); it != scored_moves.end(); ++it) {
     if (tryMoveAndCutoff(board, it->move, depth, alpha, beta, isMaximizing, initial_alpha,
-                         currentHash, bestMoveForNode, bestEval, evalFn)) {
+                         key, symmetry, lastX, lastY, bestMoveForNode, bestEval, evalFn,
+                         thread)) {
       return bestEval;
     }
   }
-  storeTT(currentHash, depth, bestMoveForNode, bestEval, initial_alpha, beta);
+  storeTT(engine, key, symmetry, depth, bestMoveForNode, bestEval, initial_alpha, beta);
 
   return bestEval;
 }
 
 bool rootSearch(Board *board, int depth, int &alpha, int &beta, bool isMaximizing,
-                std::pair<int, int> &bestMoveOut, int &bestScoreOut, clock_t startTime,
-                clock_t timeLimitClocks, bool &timedOut, EvalFn evalFn) {
-  // 0) pre‐timer check
-  if (timeExceeded(startTime, timeLimitClocks)) {
-    timedOut = true;
-    return true;
-  }
+                std::pair<int, int> &bestMoveOut, int &bestScoreOut, EvalFn evalFn,
+                SearchThread &thread) {
+  EngineContext &engine = *thread.context;
+  // 0) limits already spent?
+  if (thread.aborted()) return true;
 
   // 1) TT lookup
-  uint64_t h0 = board->getHash();
+  int symmetry;
+  uint64_t key = positionKey(engine, board, symmetry);
   int alpha0 = alpha;
   std::pair<int, int> ttMv(kInvalidMove);
-  boost::unordered_map<uint64_t, TTEntry>::iterator it = transTable.find(h0);
-  if (it != transTable.end()) {
-    ttMv = it->second.bestMove;
+  TTEntry rootEntry;
+  if (engine.transTable.probe(key, rootEntry)) {
+    ttMv = boardMove(symmetry, rootEntry.bestMove);
     std::cout << "Using TT suggested move for ordering: (" << ttMv.first << "," << ttMv.second
               << ")" << std::endl;
   }
 
   // 2) try TT‐move
   if (processHashMove(board, ttMv, depth, alpha, beta, isMaximizing, bestMoveOut, bestScoreOut,
-                      evalFn)) {
-    storeTT(h0, depth, bestMoveOut, bestScoreOut, alpha0, beta);
+                      evalFn, thread)) {
+    storeTT(engine, key, symmetry, depth, bestMoveOut, bestScoreOut, alpha0, beta);
     return true;
   }
 
-  // 3) timer check again
-  if (timeExceeded(startTime, timeLimitClocks)) {
-    timedOut = true;
-    return true;
-  }
+  // 3) limit check again
+  if (thread.aborted()) return true;
 
   // 4) generate & sort
-  std::vector<std::pair<int, int> > moves = generateCandidateMoves(board);
+  MoveList &moves = thread.moveStack[depth];
+  generateCandidateMoves(board, moves, thread.finder);
   if (moves.empty()) {
     std::cout << "No moves available." << std::endl;
     return false;
   }
 
-  std::vector<ScoredMove> scored;
-  scoreAndSortMoves(board, moves, board->getNextPlayer(), depth, isMaximizing, scored, evalFn);
+  ScoredMoveList &scored = thread.scoredStack[depth];
+  scoreAndSortMoves(board, moves, board->getNextPlayer(), depth, isMaximizing, -1, -1, scored,
+                    evalFn, thread);
 
   // 5) immediate heuristic win?
   if (!scored.empty() && scored[0].score >= MINIMAX_TERMINATION) {
@@ -486,124 +859,498 @@ bool rootSearch(Board *board, int depth, int &alpha, int &beta, bool isMaximizin
   bestScoreOut = initialExtreme(isMaximizing);
 
   for (size_t i = 0; i < scored.size(); ++i) {
-    // inside‐loop timer check
-    if (timeExceeded(startTime, timeLimitClocks)) {
-      std::cout << "Time limit exceeded during depth " << depth << "!" << std::endl;
-      timedOut = true;
-      return true;
-    }
-
     const std::pair<int, int> &mv = scored[i].move;
     UndoInfo ui = board->makeMove(mv.first, mv.second);
     int next = board->getNextPlayer();
-    int val =
-        minimax(board, depth - 1, alpha, beta, next, mv.first, mv.second, !isMaximizing, evalFn);
+    int val = minimax(board, depth - 1, alpha, beta, next, mv.first, mv.second, !isMaximizing,
+                      evalFn, thread);
     board->undoMove(ui);
 
+    // A search cut short keeps the best of the root moves it finished.
+    if (thread.aborted()) {
+      std::cout << "Search limit reached during depth " << depth << "!" << std::endl;
+      if (bestMoveOut.first < 0) bestMoveOut = mv;
+      return true;
+    }
+
     // std::cout << "  Depth " << depth << " Move (" << mv.first << "," << mv.second
     //           << ") score: " << val << std::endl;
 
     updateBestAndBounds(isMaximizing, val, mv, bestScoreOut, bestMoveOut, alpha, beta);
-
-    if (timeExceeded(startTime, timeLimitClocks)) {
-      std::cout << "Time limit exceeded AFTER completing depth " << depth << " loop." << std::endl;
-    }
   }
 
   // 7) store final TT entry
-  storeTT(h0, depth, bestMoveOut, bestScoreOut, alpha0, beta);
+  storeTT(engine, key, symmetry, depth, bestMoveOut, bestScoreOut, alpha0, beta);
   return false;
 }
 
-std::pair<int, int> getBestMove(Board *board, int depth, EvalFn evalFn) {
+// ---- Lazy SMP helpers ----------------------------------------------------------
+//
+// Helper threads search the same root on private Board copies and share results
+// only through the transposition table and the evaluation cache. The main
+// thread's search is unchanged; it simply finds more TT hits. Helpers are
+// stopped as soon as the main thread returns, and an aborted helper never
+// writes to the table.
+
+enum SearchKind { SEARCH_MINIMAX, SEARCH_PVS };
+
+struct HelperJob {
+  Board board;
+  int maxDepth;
+  EvalFn evalFn;
+  SearchKind kind;
+  bool rootMaximizing;  // as the main thread's root search
+  SearchThread thread;
+
+  HelperJob(EngineContext &engine, const Board &root, int depth, EvalFn fn, SearchKind k,
+            bool maximizing, int id, volatile bool *stop)
+      : board(root),
+        maxDepth(depth),
+        evalFn(fn),
+        kind(k),
+        rootMaximizing(maximizing),
+        thread(engine, id, stop) {}
+};
+
+int clampThreadCount(int threads) {
+  if (threads < 1) return 1;
+  if (threads > MAX_SEARCH_THREADS) return MAX_SEARCH_THREADS;
+  return threads;
+}
+
+// One full-window root iteration for a helper. The root order is rotated by the
+// helper id so that threads start on different subtrees.
+void helperRootSearch(HelperJob &job, int depth) {
+  Board *board = &job.board;
+  SearchThread &thread = job.thread;
+  EngineContext &engine = *thread.context;
+  bool maximizing = job.rootMaximizing;
+
+  MoveList &moves = thread.moveStack[depth];
+  generateCandidateMoves(board, moves, thread.finder);
+  if (moves.empty()) return;
+  ScoredMoveList &scored = thread.scoredStack[depth];
+  scoreAndSortMoves(board, moves, board->getNextPlayer(), depth, maximizing, -1, -1, scored,
+                    job.evalFn, thread);
+  std::rotate(scored.begin(), scored.begin() + (thread.id % scored.size()), scored.end());
+
+  int alpha = std::numeric_limits<int>::min();
+  int beta = std::numeric_limits<int>::max();
+  int alpha0 = alpha;
+  int bestScore = initialExtreme(maximizing);
+  std::pair<int, int> bestMove(kInvalidMove);
+
+  for (size_t i = 0; i < scored.size(); ++i) {
+    if (thread.aborted()) return;
+    const std::pair<int, int> &mv = scored[i].move;
+    UndoInfo ui = board->makeMove(mv.first, mv.second);
+    int next = board->getNextPlayer();
+    int val = (job.kind == SEARCH_PVS)
+                  ? pvs(board, depth - 1, alpha, beta, next, mv.first, mv.second, !maximizing,
+                        job.evalFn, thread)
+                  : minimax(board, depth - 1, alpha, beta, next, mv.first, mv.second, !maximizing,
+                            job.evalFn, thread);
+    board->undoMove(ui);
+    if (thread.aborted()) return;
+    updateBestAndBounds(maximizing, val, mv, bestScore, bestMove, alpha, beta);
+  }
+  int symmetry;
+  uint64_t key = positionKey(engine, board, symmetry);
+  storeTT(engine, key, symmetry, depth, bestMove, bestScore, alpha0, beta);
+}
+
+void *helperMain(void *arg) {
+  HelperJob *job = static_cast<HelperJob *>(arg);
+  // Odd helpers run one ply ahead of the main thread's iteration.
+  int skew = job->thread.id & 1;
+  for (int d = 1; d <= job->maxDepth && !job->thread.aborted(); ++d)
+    helperRootSearch(*job, std::min(job->maxDepth, d + skew));
+  return NULL;
+}
+
+// Starts threads-1 helpers on construction; stops and joins them on destruction,
+// then records the node count of the whole search. Declare it after `mainThread`
+// so it is destroyed first.
+class HelperPool {
+ public:
+  HelperPool(const Board *root, int threads, int maxDepth, EvalFn evalFn, SearchKind kind,
+             bool rootMaximizing, const SearchThread &mainThread)
+      : stop_(false), mainThread_(mainThread) {
+    threads = clampThreadCount(threads);
+    for (int id = 1; id < threads; ++id) {
+      HelperJob *job = new HelperJob(*mainThread.context, *root, maxDepth, evalFn, kind,
+                                     rootMaximizing, id, &stop_);
+      pthread_t tid;
+      if (pthread_create(&tid, NULL, helperMain, job) != 0) {
+        std::cerr << "Lazy SMP: failed to start helper " << id << std::endl;
+        delete job;
+        break;
+      }
+      jobs_.push_back(job);
+      tids_.push_back(tid);
+    }
+  }
+
+  ~HelperPool() {
+    stop_ = true;
+    __sync_synchronize();
+    addThreadStats(mainThread_);
+    for (size_t i = 0; i < tids_.size(); ++i) {
+      pthread_join(tids_[i], NULL);
+      addThreadStats(jobs_[i]->thread);
+      delete jobs_[i];
+    }
+  }
+
+ private:
+  volatile bool stop_;
+  const SearchThread &mainThread_;
+  std::vector<HelperJob *> jobs_;
+  std::vector<pthread_t> tids_;
+
+  HelperPool(const HelperPool &);
+  HelperPool &operator=(const HelperPool &);
+};
+
+std::pair<int, int> getBestMove(EngineContext &engine, Board *board, int depth, EvalFn evalFn,
+                                int threads, const SearchLimits &limits) {
   int bestScore = std::numeric_limits<int>::min();
   std::pair<int, int> bestMove = kInvalidMove;
 
   int alpha = std::numeric_limits<int>::min();  // Initial alpha = -infinity
   int beta = std::numeric_limits<int>::max();   // Initial beta = +infinity
 
-  rootSearch(board, depth, alpha, beta,
-             true,  // maximizing at root
-             bestMove, bestScore, evalFn);
+  beginSearch(engine, board, evalFn);
+  TimeManager timer;
+  timer.start(limits);
+  SearchThread mainThread(engine);
+  mainThread.timer = &timer;
+  const bool rootMaximizing = true;
+  HelperPool helpers(board, threads, depth, evalFn, SEARCH_MINIMAX, rootMaximizing, mainThread);
+  rootSearch(board, depth, alpha, beta, rootMaximizing, bestMove, bestScore, evalFn, mainThread);
 
   return bestMove;
 }
 
-// The main iterative deepening function
-std::pair<int, int> iterativeDeepening(Board *board, int maxDepth, double timeLimitSeconds,
-                                       EvalFn evalFn) {
-  // Timekeeping (C++98 style using clock())
-  clock_t start = clock();
-  clock_t limit = (clock_t)(timeLimitSeconds * CLOCKS_PER_SEC);
+// ---- Iterative-deepening PVS ---------------------------------------------------
+
+enum RootResult { ROOT_COMPLETED, ROOT_ABORTED, ROOT_NO_MOVES, ROOT_HEURISTIC_WIN };
+
+// One PVS iteration at the root within [alpha, beta]. The TT move is tried first;
+// the rest follow the usual ordering. Like getBestMovePVS, every root move gets
+// the whole window; null-window probes start one ply down. Fail-soft: the caller
+// compares the score against its window to detect aspiration failures.
+RootResult pvsRoot(Board *board, int depth, int alpha, int beta, std::pair<int, int> &bestMoveOut,
+                   int &bestScoreOut, EvalFn evalFn, SearchThread &thread) {
+  EngineContext &engine = *thread.context;
+  int symmetry;
+  uint64_t key = positionKey(engine, board, symmetry);
+  MoveList &moves = thread.moveStack[depth];
+  generateCandidateMoves(board, moves, thread.finder);
+  if (moves.empty()) return ROOT_NO_MOVES;
+
+  ScoredMoveList &scored = thread.scoredStack[depth];
+  scoreAndSortMoves(board, moves, board->getNextPlayer(), depth, true, -1, -1, scored, evalFn,
+                    thread);
+  if (scored[0].score >= MINIMAX_TERMINATION) {
+    bestMoveOut = scored[0].move;
+    bestScoreOut = scored[0].score;
+    return ROOT_HEURISTIC_WIN;
+  }
+
+  TTEntry rootEntry;
+  if (engine.transTable.probe(key, rootEntry)) {
+    std::pair<int, int> ttMove = boardMove(symmetry, rootEntry.bestMove);
+    for (ScoredMove *it = scored.begin(); it != scored.end(); ++it) {
+      if (it->move == ttMove) {
+        std::rotate(scored.begin(), it, it + 1);
+        break;
+      }
+    }
+  }
+
+  int alpha0 = alpha;
+  int bestScore = initialExtreme(true);
+  std::pair<int, int> bestMove(kInvalidMove);
+
+  for (size_t i = 0; i < scored.size(); ++i) {
+    if (thread.aborted()) return ROOT_ABORTED;
+    const std::pair<int, int> &mv = scored[i].move;
+    UndoInfo ui = board->makeMove(mv.first, mv.second);
+    int next = board->getNextPlayer();
+    int score =
+        pvs(board, depth - 1, alpha, beta, next, mv.first, mv.second, false, evalFn, thread);
+    board->undoMove(ui);
+    if (thread.aborted()) return ROOT_ABORTED;
+
+    updateBestAndBounds(true, score, mv, bestScore, bestMove, alpha, beta);
+    if (alpha >= beta) break;  // fail high: the caller widens the window
+  }
+
+  storeTT(engine, key, symmetry, depth, bestMove, bestScore, alpha0, beta);
+  bestMoveOut = bestMove;
+  bestScoreOut = bestScore;
+  return ROOT_COMPLETED;
+}
+
+// Window bound `delta` away from `center`, or the open bound once it gets that wide.
+inline int aspirationBound(int center, int delta, bool upper) {
+  long long bound = (long long)center + (upper ? delta : -delta);
+  if (delta >= MINIMAX_TERMINATION || bound >= std::numeric_limits<int>::max() ||
+      bound <= std::numeric_limits<int>::min())
+    return upper ? std::numeric_limits<int>::max() : std::numeric_limits<int>::min();
+  return (int)bound;
+}
 
-  SearchResult bestSoFar;  // Store best result from completed depths
+// Runs the threat solver on the root: a forced win by fours, then by fours and threes.
+bool rootThreatWin(Board *board, SearchThread &thread, std::pair<int, int> &move) {
+  static const ThreatSearch::Mode modes[2] = {ThreatSearch::VCF, ThreatSearch::VCT};
+  static const int depths[2] = {VCF_MAX_DEPTH, VCT_MAX_DEPTH};
+  static const char *names[2] = {"VCF", "VCT"};
+  for (int i = 0; i < 2; ++i) {
+    bool found = thread.threats.findWin(board, modes[i], depths[i], THREAT_NODE_LIMIT, move);
+    thread.nodes += thread.threats.nodes();
+    if (found) {
+      std::cout << names[i] << " win found at root: (" << move.first << "," << move.second << ")"
+                << std::endl;
+      return true;
+    }
+  }
+  return false;
+}
 
-  initKillerMoves();  // Initialize killers at the start of ID
+std::pair<int, int> iterativeDeepening(EngineContext &engine, Board *board, int maxDepth,
+                                       const SearchLimits &limits, EvalFn evalFn, int threads) {
+  beginSearch(engine, board, evalFn);
+  // Monotonic timekeeping so helper threads do not eat into the budget
+  TimeManager timer;
+  timer.start(limits);
+  SearchThread mainThread(engine);  // Fresh killers and history at the start of ID
+  mainThread.timer = &timer;
+
+  SearchResult &searchResult = engine.result;
+  searchResult = SearchResult();
+  std::pair<int, int> threatMove;
+  if (rootThreatWin(board, mainThread, threatMove)) {
+    addThreadStats(mainThread);
+    searchResult.bestMove = threatMove;
+    searchResult.score = GOMOKU;
+    return threatMove;
+  }
+  HelperPool helpers(board, threads, maxDepth, evalFn, SEARCH_PVS, /*rootMaximizing=*/true,
+                     mainThread);
 
-  int root_alpha = std::numeric_limits<int>::min();
-  int root_beta = std::numeric_limits<int>::max();
+  // Leaf scores rate the last move for the side that played it, so odd and even
+  // depths score from opposite sides. Each window is centered on the result of
+  // the iteration two plies back.
+  SearchResult completed[MAX_DEPTH + 1];
+  SearchResult bestSoFar;
 
   for (int d = 1; d <= maxDepth; ++d) {
-    int bestScore;
+    int alpha = std::numeric_limits<int>::min();
+    int beta = std::numeric_limits<int>::max();
+    int center = 0;
+    int delta = ASPIRATION_WINDOW;
+    bool aspirate = d > 2 && completed[d - 2].depthSearched == d - 2 &&
+                    std::abs(completed[d - 2].score) < MINIMAX_TERMINATION;
+    if (aspirate) {
+      center = completed[d - 2].score;
+      alpha = aspirationBound(center, delta, false);
+      beta = aspirationBound(center, delta, true);
+    }
+
     std::pair<int, int> bestMove(kInvalidMove);
-    bool timedOut = false;
+    int bestScore = 0;
+    RootResult result;
+    for (;;) {
+      result = pvsRoot(board, d, alpha, beta, bestMove, bestScore, evalFn, mainThread);
+      if (result != ROOT_COMPLETED) break;
+      bool failLow = bestScore <= alpha && alpha != std::numeric_limits<int>::min();
+      bool failHigh = bestScore >= beta && beta != std::numeric_limits<int>::max();
+      if (!failLow && !failHigh) break;
+      // Widen only the side that failed.
+      delta *= 4;
+      if (failLow) alpha = aspirationBound(center, delta, false);
+      if (failHigh) beta = aspirationBound(center, delta, true);
+    }
 
-    // 1) First search with the *current* window
-    bool cutoff = rootSearch(board, d, root_alpha, root_beta,
-                             true,  // maximizing
-                             bestMove, bestScore, start, limit, timedOut, evalFn);
+    if (result == ROOT_ABORTED) {
+      std::cout << "Search limit reached during depth " << d << std::endl;
+      break;
+    }
+    if (result == ROOT_NO_MOVES) {
+      std::cout << "No moves available." << std::endl;
+      break;
+    }
+    if (result == ROOT_HEURISTIC_WIN) {
+      std::cout << "Immediate heuristic win found at root: (" << bestMove.first << ","
+                << bestMove.second << ")" << std::endl;
+      searchResult.bestMove = bestMove;
+      searchResult.score = bestScore;
+      searchResult.depthSearched = d;
+      return bestMove;
+    }
 
-    if (timedOut) break;  // ran out of time
+    std::cout << "Depth " << d << " completed: (" << bestMove.first << "," << bestMove.second
+              << ") score " << bestScore << std::endl;
+    completed[d].bestMove = bestMove;
+    completed[d].score = bestScore;
+    completed[d].depthSearched = d;
+    bestSoFar = completed[d];
+    if (engine.progress != NULL) {
+      SearchProgress progress;
+      progress.depth = d;
+      progress.bestMove = bestMove;
+      progress.score = bestScore;
+      progress.nodes = mainThread.nodes;
+      progress.elapsedMs = timer.elapsedMs();
+      engine.progress(progress, engine.progressArg);
+    }
+    if (bestScore >= MINIMAX_TERMINATION) break;  // a forced win does not improve with depth
+    if (d < maxDepth && !timer.canStartIteration(mainThread.nodes)) {
+      std::cout << "Soft time target reached after depth " << d << std::endl;
+      break;
+    }
+  }
 
-    // 2) If no cutoff *and* score is outside [α,β], re-search full window
-    if (!cutoff && (bestScore <= root_alpha || bestScore >= root_beta)) {
-      root_alpha = std::numeric_limits<int>::min();
-      root_beta = std::numeric_limits<int>::max();
+  searchResult = bestSoFar;
+  // Not even depth 1 finished: fall back to the best-ordered root move.
+  if (bestSoFar.bestMove.first < 0 && !mainThread.scoredStack[1].empty())
+    return mainThread.scoredStack[1][0].move;
+  return bestSoFar.bestMove;  // Return best move from the deepest fully completed search
+}
 
-      cutoff = rootSearch(board, d, root_alpha, root_beta, true, bestMove, bestScore, start, limit,
-                          timedOut, evalFn);
-      if (timedOut) break;  // time’s up in the full‐window search
+// True when the side to move must answer a threat: the opponent has a five or an
+// open four to play, or a capture that reaches the goal. Passing would lose.
+bool facesThreat(const Board *board, int player) {
+  int opponent = OPPONENT(player);
+  int captureRoom = board->getEnableCapture()
+                        ? board->getGoal() - board->getLastPlayerScore()
+                        : std::numeric_limits<int>::max();
+  uint64_t candidates[BOARD_SIZE];
+  board->getCandidateMask(candidates);
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    for (uint64_t bits = candidates[row]; bits; bits &= bits - 1) {
+      int col = __builtin_ctzll(bits);
+      int pairs = 0;
+      for (int axis = 0; axis < 4; ++axis) {
+        const Evaluation::PatternEntry &entry = Evaluation::lookupPattern(
+            board->getLineCode(col, row, DIRECTIONS[axis][0], DIRECTIONS[axis][1]), opponent);
+        if (entry.gomokuCount || entry.openFourCount) return true;
+        pairs += entry.captureCount;
+      }
+      if (pairs >= captureRoom) return true;
     }
+  }
+  return false;
+}
 
-    // 3) If we cut off early (by TT or heuristic‐win), return immediately
-    if (cutoff) return bestMove;
-
-    // 4) Otherwise, record the fully completed result
-    bestSoFar.bestMove = bestMove;
-    bestSoFar.score = bestScore;
-    bestSoFar.depthSearched = d;
+// A move that neither makes nor blocks a four, an open three or a capture.
+bool isQuietMove(const Board *board, int player, const std::pair<int, int> &mv) {
+  int opponent = OPPONENT(player);
+  for (int axis = 0; axis < 4; ++axis) {
+    unsigned int code =
+        board->getLineCode(mv.first, mv.second, DIRECTIONS[axis][0], DIRECTIONS[axis][1]);
+    const Evaluation::PatternEntry &own = Evaluation::lookupPattern(code, player);
+    if (own.gomokuCount || own.openFourCount || own.closedFourCount || own.openThreeCount ||
+        own.captureCount)
+      return false;
+    const Evaluation::PatternEntry &theirs = Evaluation::lookupPattern(code, opponent);
+    if (theirs.gomokuCount || theirs.openFourCount || theirs.closedFourCount ||
+        theirs.openThreeCount)
+      return false;
   }
+  return true;
+}
 
-  return bestSoFar.bestMove;  // Return best move from the deepest fully completed search
+// Plies to cut from the `index`-th ordered move of a null-window search.
+inline int lateMoveReduction(const SearchTuning &tuning, const Board *board, int player,
+                             const ScoredMove &move, size_t index, int depth) {
+  if (!tuning.lateMoveReductions || depth < tuning.lmrMinDepth ||
+      (int)index < tuning.lmrFullDepthMoves || move.is_killer ||
+      depth - 1 - tuning.lmrReduction < 0 || !isQuietMove(board, player, move.move))
+    return 0;
+  return tuning.lmrReduction;
+}
+
+// Null-move pruning is tried away from the principal variation and from mate
+// scores, never twice in a row (the pass leaves lastX at -1), and never while
+// the side to move is under threat.
+inline bool tryNullMove(const SearchTuning &tuning, const Board *board, int depth, int alpha,
+                        int beta, int currentPlayer, int lastX) {
+  return tuning.nullMove && depth >= tuning.nullMoveMinDepth &&
+         depth - 1 - tuning.nullMoveReduction >= 1 && lastX != -1 &&
+         (long long)beta - alpha <= 1 && std::abs(alpha) < MINIMAX_TERMINATION &&
+         std::abs(beta) < MINIMAX_TERMINATION && !facesThreat(board, currentPlayer);
 }
 
 int pvs(Board *board, int depth, int alpha, int beta, int currentPlayer, int lastX, int lastY,
-        bool isMaximizing, EvalFn evalFn) {
+        bool isMaximizing, EvalFn evalFn, SearchThread &thread) {
+  EngineContext &engine = *thread.context;
+  thread.nodes++;
+  pollLimits(thread);
+  if (thread.aborted()) {
+    board->flushCaptures();
+    return 0;
+  }
   int alphaOrig = alpha;  // for TT flag
-  uint64_t hash = board->getHash();
+  int symmetry;
+  uint64_t key = positionKey(engine, board, symmetry);
   std::pair<int, int> ttMove(kInvalidMove);
   int ttScore;
 
   // ---- 1.  TT probe ---------------------------------------
-  if (probeTT(board, depth, alpha, beta, ttMove, ttScore)) return ttScore;
+  if (probeTT(engine, board, depth, alpha, beta, ttMove, ttScore)) return ttScore;
 
   // ---- 2.  Terminal / quiescence --------------------------
   int playerJustMoved = (currentPlayer == PLAYER_1) ? PLAYER_2 : PLAYER_1;
-  int eval = (*evalFn)(board, playerJustMoved, lastX, lastY);
-  if ((lastX != -1 && eval >= MINIMAX_TERMINATION) || depth == 0) {
-    board->flushCaptures();
-    return eval;
-  }
+  int eval = evaluate(board, playerJustMoved, lastX, lastY, evalFn, thread);
   board->flushCaptures();
+  if (lastX != -1 && eval >= MINIMAX_TERMINATION) return terminalScore(eval, isMaximizing);
+  if (depth == 0) return leafScore(board, eval, isMaximizing, thread);
+
+  // ---- 2b. Threat probe: a forced VCF settles the node ----
+  if (depth >= THREAT_PROBE_MIN_DEPTH) {
+    std::pair<int, int> threatMove;
+    bool won = thread.threats.findWin(board, ThreatSearch::VCF, VCF_PROBE_DEPTH,
+                                      THREAT_PROBE_NODE_LIMIT, threatMove);
+    thread.nodes += thread.threats.nodes();
+    if (won) {
+      int score = isMaximizing ? GOMOKU : -GOMOKU;  // a win for the side to move
+      storeTT(engine, key, symmetry, depth, threatMove, score, alphaOrig, beta);
+      return score;
+    }
+  }
+
+  // ---- 2c. Null move: pass and search a reduced null window ----
+  const SearchTuning &tuning = engine.tuning;
+  if (tryNullMove(tuning, board, depth, alpha, beta, currentPlayer, lastX)) {
+    int nullDepth = depth - 1 - tuning.nullMoveReduction;
+    int opponent = OPPONENT(currentPlayer);
+    board->switchTurn();
+    int score = isMaximizing
+                    ? pvs(board, nullDepth, beta - 1, beta, opponent, -1, -1, false, evalFn, thread)
+                    : pvs(board, nullDepth, alpha, alpha + 1, opponent, -1, -1, true, evalFn,
+                          thread);
+    board->switchTurn();
+    if (thread.aborted()) return initialExtreme(isMaximizing);
+    // Still out of the window after giving a move away: the node fails the same way.
+    if (isMaximizing ? score >= beta : score <= alpha) {
+      storeTT(engine, key, symmetry, depth, ttMove, score, alphaOrig, beta);
+      return score;
+    }
+  }
 
   // ---- 3.  Generate & order moves -------------------------
-  std::vector<std::pair<int, int> > moves = generateCandidateMoves(board);
+  MoveList &moves = thread.moveStack[depth];
+  generateCandidateMoves(board, moves, thread.finder);
   if (moves.empty()) {  // stalemate – evaluate statically
     board->flushCaptures();
-    return (*evalFn)(board, currentPlayer, lastX, lastY);
+    return evaluate(board, currentPlayer, lastX, lastY, evalFn, thread);
   }
-  std::vector<ScoredMove> scored;
-  scoreAndSortMoves(board, moves, currentPlayer, depth, isMaximizing, scored, evalFn);
+  ScoredMoveList &scored = thread.scoredStack[depth];
+  scoreAndSortMoves(board, moves, currentPlayer, depth, isMaximizing, lastX, lastY, scored, evalFn,
+                    thread);
 
   bool firstChild = true;
   std::pair<int, int> bestMove(kInvalidMove);
@@ -611,6 +1358,8 @@ int pvs(Board *board, int depth, int alpha, int beta, int currentPlayer, int las
 
   for (size_t i = 0; i < scored.size(); ++i) {
     const std::pair<int, int> &mv = scored[i].move;
+    int reduction =
+        firstChild ? 0 : lateMoveReduction(tuning, board, currentPlayer, scored[i], i, depth);
 
     // Killer-move bookkeeping handled in tryMoveAndCutoff, so just call it.
     UndoInfo ui = board->makeMove(mv.first, mv.second);
@@ -619,49 +1368,56 @@ int pvs(Board *board, int depth, int alpha, int beta, int currentPlayer, int las
     int score;
     if (firstChild) {
       // full window
-      score = pvs(board, depth - 1, alpha, beta, next, mv.first, mv.second, !isMaximizing, evalFn);
+      score = pvs(board, depth - 1, alpha, beta, next, mv.first, mv.second, !isMaximizing, evalFn,
+                  thread);
       firstChild = false;
     } else {
-      // null window (width-0: alpha = beta = alpha + 1)
-      score = pvs(board, depth - 1, alpha + 1, alpha + 1, next, mv.first, mv.second, !isMaximizing,
-                  evalFn);
+      // null window on the bound the side to move must beat
+      int probeAlpha = isMaximizing ? alpha : beta - 1;
+      score = pvs(board, depth - 1 - reduction, probeAlpha, probeAlpha + 1, next, mv.first,
+                  mv.second, !isMaximizing, evalFn, thread);
+      // a reduced move that may improve on the node goes again at full depth
+      if (reduction > 0 && (isMaximizing ? score > alpha : score < beta))
+        score = pvs(board, depth - 1, probeAlpha, probeAlpha + 1, next, mv.first, mv.second,
+                    !isMaximizing, evalFn, thread);
       // if it produced something interesting, re-search
       if (score > alpha && score < beta) {
-        score =
-            pvs(board, depth - 1, alpha, beta, next, mv.first, mv.second, !isMaximizing, evalFn);
+        score = pvs(board, depth - 1, alpha, beta, next, mv.first, mv.second, !isMaximizing,
+                    evalFn, thread);
       }
     }
 
     board->undoMove(ui);
+    if (thread.aborted()) return bestEval;
 
     // ------- α/β update + best-move tracking -------------
     updateBestAndBounds(isMaximizing, score, mv, bestEval, bestMove, alpha, beta);
     if (alpha >= beta) {  // cut-off
-      // killer-move table
-      if (!isKillerMove(depth, mv)) {
-        killerMoves[depth][1] = killerMoves[depth][0];
-        killerMoves[depth][0] = mv;
-      }
+      // killer, history and countermove tables
+      recordCutoff(thread, board->getNextPlayer(), depth, mv, lastX, lastY);
       break;
     }
   }
 
   // ---- 5.  Store in TT & return ---------------------------
-  storeTT(hash, depth, bestMove, bestEval, alphaOrig, beta);
+  storeTT(engine, key, symmetry, depth, bestMove, bestEval, alphaOrig, beta);
   return bestEval;
 }
 
 // ------------------------------------------------------------
 // One-shot “find best move” helper (no iterative deepening).
 // ------------------------------------------------------------
-std::pair<int, int> getBestMovePVS(Board *board, int depth,
-                                   EvalFn evalFn = &Evaluation::evaluatePositionHard) {
-  initKillerMoves();
-  std::vector<std::pair<int, int> > moves = generateCandidateMoves(board);
+std::pair<int, int> getBestMovePVS(EngineContext &engine, Board *board, int depth, EvalFn evalFn,
+                                   int threads) {
+  beginSearch(engine, board, evalFn);
+  SearchThread mainThread(engine);
+  MoveList &moves = mainThread.moveStack[depth];
+  generateCandidateMoves(board, moves, mainThread.finder);
   if (moves.empty()) return std::make_pair(-1, -1);
 
-  std::vector<ScoredMove> ordered;
-  scoreAndSortMoves(board, moves, board->getNextPlayer(), depth, /*maxSide=*/true, ordered, evalFn);
+  ScoredMoveList &ordered = mainThread.scoredStack[depth];
+  scoreAndSortMoves(board, moves, board->getNextPlayer(), depth, /*maxSide=*/true, -1, -1, ordered,
+                    evalFn, mainThread);
   if (ordered[0].score >= MINIMAX_TERMINATION) {
     return ordered[0].move;
   }
@@ -671,12 +1427,14 @@ std::pair<int, int> getBestMovePVS(Board *board, int depth,
   std::pair<int, int> bestMove(kInvalidMove);
   int bestScore = std::numeric_limits<int>::min();
 
+  HelperPool helpers(board, threads, depth, evalFn, SEARCH_PVS, /*rootMaximizing=*/true,
+                     mainThread);
   for (size_t i = 0; i < ordered.size(); ++i) {
     const std::pair<int, int> &mv = ordered[i].move;
     UndoInfo ui = board->makeMove(mv.first, mv.second);
     int next = board->getNextPlayer();
     int score = pvs(board, depth - 1, alpha, beta, next, mv.first, mv.second,
-                    /*isMaximizing=*/false, evalFn);
+                    /*isMaximizing=*/false, evalFn, mainThread);
 
     board->undoMove(ui);
     if (score >= MINIMAX_TERMINATION) {
@@ -0,0 +1,426 @@
+#include "OpeningBook.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <boost/random/mersenne_twister.hpp>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Evaluation.hpp"
+#include "Minimax.hpp"
+
+namespace OpeningBook {
+
+namespace {
+
+const char kMagic[8] = {'G', 'M', 'K', 'B', 'O', 'O', 'K', '\0'};
+const uint32_t kByteOrderMark = 0x01020304u;
+// Book keys come from their own fixed-seed generator: they are color-relative,
+// and a new ZOBRIST_KEY_VERSION for the search keys leaves built books valid.
+const uint32_t kKeySeed = 0x9e3779b9u;
+const int kMaxScoreKey = 7;  // capture scores covered by the key table
+
+// File layout: header, then Entry[entryCount], in the writer's native byte order.
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t entryCount;
+  uint32_t entrySize;
+  uint64_t keySeed;
+  uint64_t checksum;  // FNV-1a over the entries
+};
+
+struct KeyTable {
+  uint64_t stones[BOARD_SIZE * BOARD_SIZE][2];  // [cell][0 = side to move, 1 = opponent]
+  uint64_t scores[2][kMaxScoreKey + 1];
+  uint64_t rules;
+
+  KeyTable() {
+    boost::random::mt19937 rng(kKeySeed);
+    for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; ++i)
+      for (int side = 0; side < 2; ++side) stones[i][side] = next(rng);
+    for (int side = 0; side < 2; ++side)
+      for (int score = 0; score <= kMaxScoreKey; ++score) scores[side][score] = next(rng);
+    rules = next(rng);
+  }
+
+  static uint64_t next(boost::random::mt19937 &rng) {
+    uint64_t high = rng();
+    return (high << 32) | rng();
+  }
+};
+
+const KeyTable &keys() {
+  static const KeyTable table;
+  return table;
+}
+
+// Rules are mixed in, so one file can hold books for several rule sets.
+uint64_t rulesKey(const Board &board) {
+  uint64_t rules = (uint64_t)board.getGoal() | (board.getEnableCapture() ? 1u << 8 : 0) |
+                   (board.getEnableDoubleThreeRestriction() ? 1u << 9 : 0);
+  uint64_t key = keys().rules * (rules + 1);
+  return key ^ (key >> 29);
+}
+
+uint64_t fnv1a(const void *data, size_t size) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  uint64_t hash = 1469598103934665603ULL;
+  for (size_t i = 0; i < size; ++i) hash = (hash ^ p[i]) * 1099511628211ULL;
+  return hash;
+}
+
+bool entryBefore(const Entry &a, const Entry &b) {
+  if (a.key != b.key) return a.key < b.key;
+  return a.weight > b.weight;
+}
+
+bool keyBefore(const Entry &entry, uint64_t key) { return entry.key < key; }
+
+const Entry *bookEntries = NULL;
+size_t bookSize = 0;
+
+}  // namespace
+
+bool canonicalKey(const Board &board, uint64_t &key, int &symmetry) {
+  int lastScore = board.getLastPlayerScore();
+  int nextScore = board.getNextPlayerScore();
+  if (lastScore < 0 || lastScore > kMaxScoreKey || nextScore < 0 || nextScore > kMaxScoreKey)
+    return false;
+
+  uint64_t occupancy[BOARD_SIZE];
+  board.getOccupancy(occupancy);
+  int stones = 0;
+  for (int row = 0; row < BOARD_SIZE; ++row) stones += __builtin_popcountll(occupancy[row]);
+  if (stones > OPENING_BOOK_MAX_STONES) return false;
+
+  const KeyTable &table = keys();
+  uint64_t base = rulesKey(board) ^ table.scores[0][nextScore] ^ table.scores[1][lastScore];
+  uint64_t candidates[BOARD_SYMMETRIES];
+  for (int s = 0; s < BOARD_SYMMETRIES; ++s) candidates[s] = base;
+  int toMove = board.getNextPlayer();
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    for (uint64_t bits = occupancy[row]; bits; bits &= bits - 1) {
+      int col = __builtin_ctzll(bits);
+      int side = board.getValueBit(col, row) == toMove ? 0 : 1;
+      for (int s = 0; s < BOARD_SYMMETRIES; ++s) {
+        std::pair<int, int> cell = symmetricMove(s, col, row);
+        candidates[s] ^= table.stones[cell.second * BOARD_SIZE + cell.first][side];
+      }
+    }
+  }
+
+  symmetry = 0;
+  for (int s = 1; s < BOARD_SYMMETRIES; ++s)
+    if (candidates[s] < candidates[symmetry]) symmetry = s;
+  key = candidates[symmetry];
+  return true;
+}
+
+bool lookup(const Board &board, std::pair<int, int> &move) {
+  if (bookSize == 0) return false;
+  uint64_t key;
+  int symmetry;
+  if (!canonicalKey(board, key, symmetry)) return false;
+  const Entry *end = bookEntries + bookSize;
+  const Entry *entry = std::lower_bound(bookEntries, end, key, keyBefore);
+  if (entry == end || entry->key != key) return false;
+
+  // A symmetric position ties several transforms; any of them maps to an
+  // equivalent move. The square is still checked, in case of a key collision.
+  move = inverseSymmetricMove(symmetry, entry->col, entry->row);
+  return board.getValueBit(move.first, move.second) == EMPTY_SPACE;
+}
+
+size_t entryCount() { return bookSize; }
+
+bool mapBook(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Opening book: cannot open " << path << std::endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FileHeader)) {
+    std::cerr << "Opening book: " << path << " is too short" << std::endl;
+    close(fd);
+    return false;
+  }
+  size_t fileBytes = (size_t)st.st_size;
+  // MAP_SHARED read-only, like the pattern tables: server processes share the pages.
+  void *mem = mmap(NULL, fileBytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    std::cerr << "Opening book: mmap of " << path << " failed" << std::endl;
+    return false;
+  }
+
+  const FileHeader *header = static_cast<const FileHeader *>(mem);
+  const Entry *entries =
+      reinterpret_cast<const Entry *>(static_cast<const char *>(mem) + sizeof(FileHeader));
+
+  const char *problem = NULL;
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0)
+    problem = "not an opening book file";
+  else if (header->version != OPENING_BOOK_FILE_VERSION)
+    problem = "version mismatch";
+  else if (header->byteOrder != kByteOrderMark || header->entrySize != sizeof(Entry) ||
+           fileBytes != sizeof(FileHeader) + (size_t)header->entryCount * sizeof(Entry))
+    problem = "layout mismatch";
+  else if (header->keySeed != kKeySeed)
+    problem = "built with different keys";
+  else if (header->checksum != fnv1a(entries, header->entryCount * sizeof(Entry)))
+    problem = "checksum mismatch";
+  if (problem) {
+    std::cerr << "Opening book: " << path << ": " << problem << std::endl;
+    munmap(mem, fileBytes);
+    return false;
+  }
+
+  // The mapping lives for the rest of the process.
+  bookEntries = entries;
+  bookSize = header->entryCount;
+  return true;
+}
+
+void initBook(const char *path) {
+  if (path && *path && mapBook(path)) {
+    std::cout << "Opening book: mapped " << path << " (" << bookSize << " entries)" << std::endl;
+    return;
+  }
+  std::cout << "Opening book: none" << std::endl;
+}
+
+// ---- Builder ----------------------------------------------------------------
+
+namespace {
+
+struct BookPosition {
+  Board board;
+  uint64_t key;
+  int symmetry;
+};
+
+// One search result, as a worker process writes it.
+struct WorkerResult {
+  int32_t index;
+  int32_t col;
+  int32_t row;
+  int32_t score;
+};
+
+bool writeBook(const char *path, std::vector<Entry> &entries) {
+  std::sort(entries.begin(), entries.end(), entryBefore);
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = OPENING_BOOK_FILE_VERSION;
+  header.byteOrder = kByteOrderMark;
+  header.entryCount = (uint32_t)entries.size();
+  header.entrySize = sizeof(Entry);
+  header.keySeed = kKeySeed;
+  const Entry *data = entries.empty() ? NULL : &entries[0];
+  header.checksum = fnv1a(data, entries.size() * sizeof(Entry));
+
+  // Write next to the target and rename, so a running server never maps a partial file.
+  std::string tmpPath = std::string(path) + ".tmp";
+  FILE *out = std::fopen(tmpPath.c_str(), "wb");
+  if (!out) {
+    std::cerr << "Opening book: cannot open " << tmpPath << " for writing" << std::endl;
+    return false;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+            (entries.empty() || std::fwrite(data, sizeof(Entry), entries.size(), out) ==
+                                    entries.size());
+  ok = (std::fclose(out) == 0) && ok;
+  if (!ok || std::rename(tmpPath.c_str(), path) != 0) {
+    std::cerr << "Opening book: failed to write " << path << std::endl;
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::string partPath(const char *path, int worker) {
+  std::ostringstream name;
+  name << path << ".part" << worker;
+  return name.str();
+}
+
+// Worker process: searches every `workers`-th position from `first` and writes
+// the results to its part file. Search logs go to /dev/null.
+void runWorker(const std::vector<BookPosition> &level, int first, int workers,
+               const SearchLimits &limits, const std::string &out) {
+  int devNull = open("/dev/null", O_WRONLY);
+  if (devNull >= 0) {
+    std::cout.flush();
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+  }
+  FILE *file = std::fopen(out.c_str(), "wb");
+  if (!file) _exit(1);
+  EngineContext engine;
+  for (size_t i = first; i < level.size(); i += workers) {
+    Board board(level[i].board);
+    std::pair<int, int> move = Minimax::iterativeDeepening(engine, &board, MAX_DEPTH, limits,
+                                                           &Evaluation::evaluatePositionHard);
+    WorkerResult result;
+    result.index = (int32_t)i;
+    result.col = move.first;
+    result.row = move.second;
+    result.score = Minimax::lastSearchResult(engine).score;
+    if (std::fwrite(&result, sizeof(result), 1, file) != 1) _exit(1);
+  }
+  _exit(std::fclose(file) == 0 ? 0 : 1);
+}
+
+// Searches one level of positions in parallel; `results` is indexed like `level`
+// and keeps col -1 for positions without a result.
+bool searchLevel(const char *path, const std::vector<BookPosition> &level,
+                 const BuildOptions &options, std::vector<WorkerResult> &results) {
+  int workers = std::max(1, std::min(options.workers, (int)level.size()));
+  std::vector<pid_t> pids;
+  for (int w = 0; w < workers; ++w) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "Opening book: fork failed" << std::endl;
+      break;
+    }
+    if (pid == 0) runWorker(level, w, workers, options.limits, partPath(path, w));
+    pids.push_back(pid);
+  }
+
+  bool ok = (int)pids.size() == workers;
+  for (size_t w = 0; w < pids.size(); ++w) {
+    int status = 0;
+    if (waitpid(pids[w], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      ok = false;
+  }
+
+  WorkerResult none;
+  none.index = -1;
+  none.col = none.row = -1;
+  none.score = 0;
+  results.assign(level.size(), none);
+  for (size_t w = 0; w < pids.size(); ++w) {
+    std::string part = partPath(path, (int)w);
+    FILE *file = std::fopen(part.c_str(), "rb");
+    WorkerResult result;
+    while (file && std::fread(&result, sizeof(result), 1, file) == 1)
+      if (result.index >= 0 && (size_t)result.index < level.size()) results[result.index] = result;
+    if (file) std::fclose(file);
+    std::remove(part.c_str());
+  }
+  if (!ok) std::cerr << "Opening book: a search worker failed" << std::endl;
+  return ok;
+}
+
+int stoneCount(const Board &board) {
+  uint64_t occupancy[BOARD_SIZE];
+  board.getOccupancy(occupancy);
+  int stones = 0;
+  for (int row = 0; row < BOARD_SIZE; ++row) stones += __builtin_popcountll(occupancy[row]);
+  return stones;
+}
+
+// Adds `board` to `next` unless a symmetric copy is already there; repeats only
+// add to the position's weight.
+void addPosition(const Board &board, std::vector<BookPosition> &next,
+                 std::map<uint64_t, int> &weights) {
+  BookPosition position = {board, 0, 0};
+  if (!canonicalKey(board, position.key, position.symmetry)) return;
+  if (weights[position.key]++ == 0) next.push_back(position);
+}
+
+// Every reply of the side to move on `board`, each one as a new position.
+void addReplies(const Board &board, std::vector<BookPosition> &next,
+                std::map<uint64_t, int> &weights) {
+  Board scratch(board);
+  Board *scratchPtr = &scratch;
+  MoveList replies;
+  CForbiddenPointFinder finder;
+  Minimax::generateCandidateMoves(scratchPtr, replies, finder);
+  for (size_t i = 0; i < replies.size(); ++i) {
+    Board child(board);
+    child.makeMove(replies[i].first, replies[i].second);
+    child.flushCaptures();
+    addPosition(child, next, weights);
+  }
+}
+
+}  // namespace
+
+BuildOptions::BuildOptions()
+    : maxStones(OPENING_BOOK_BUILD_STONES),
+      workers(1),
+      limits(SearchLimits::fromTime(OPENING_BOOK_SEARCH_MS)) {}
+
+bool build(const char *path, const BuildOptions &options) {
+  if (options.maxStones < 2 || options.maxStones > OPENING_BOOK_MAX_STONES) {
+    std::cerr << "Opening book: positions of 2 to " << OPENING_BOOK_MAX_STONES << " stones"
+              << std::endl;
+    return false;
+  }
+
+  // Seeds: the engine answering the center opening, and the engine's center
+  // stone answered by the opponent.
+  const int center = BOARD_SIZE / 2;
+  Board root(5, PLAYER_2, PLAYER_1, 0, 0, true, true);
+  root.makeMove(center, center);
+  std::map<uint64_t, int> weights;
+  std::vector<BookPosition> level;
+  addPosition(root, level, weights);
+  addReplies(root, level, weights);
+
+  std::vector<Entry> entries;
+  bool ok = true;
+  while (!level.empty()) {
+    std::cout << "Opening book: searching " << level.size() << " positions with "
+              << stoneCount(level[0].board) << "+ stones" << std::endl;
+    std::vector<WorkerResult> results;
+    ok = searchLevel(path, level, options, results) && ok;
+
+    std::vector<BookPosition> next;
+    for (size_t i = 0; i < level.size(); ++i) {
+      const BookPosition &position = level[i];
+      if (results[i].col < 0 || position.board.getValueBit(results[i].col, results[i].row) !=
+                                    EMPTY_SPACE)
+        continue;
+      std::pair<int, int> stored = symmetricMove(position.symmetry, results[i].col,
+                                                 results[i].row);
+      Entry entry;
+      entry.key = position.key;
+      entry.score = results[i].score;
+      entry.weight = (uint16_t)std::min(weights[position.key], 0xFFFF);
+      entry.col = (uint8_t)stored.first;
+      entry.row = (uint8_t)stored.second;
+      entries.push_back(entry);
+
+      // The engine's move, then every reply: the next position where it is to move.
+      if (stoneCount(position.board) + 2 > options.maxStones) continue;
+      Board afterMove(position.board);
+      afterMove.makeMove(results[i].col, results[i].row);
+      afterMove.flushCaptures();
+      addReplies(afterMove, next, weights);
+    }
+    level.swap(next);
+  }
+
+  if (!writeBook(path, entries)) return false;
+  std::cout << "Opening book: " << entries.size() << " entries written to " << path << std::endl;
+  return ok;
+}
+
+}  // namespace OpeningBook
@@ -0,0 +1,508 @@
+#include "ThreatSearch.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+#include "Evaluation.hpp"
+#include "Rules.hpp"
+
+namespace ThreatSearch {
+
+namespace {
+
+// ---- Result cache -------------------------------------------------------------
+//
+// data layout: move(16) | depth(8) | win(1) | valid(1)
+
+const size_t kCacheSize = (size_t)1 << THREAT_CACHE_BITS;
+
+const uint64_t kModeSalt[2] = {0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL};
+
+inline uint64_t cacheKey(uint64_t hash, Mode mode) { return hash ^ kModeSalt[mode]; }
+
+// ---- Pattern helpers ----------------------------------------------------------
+
+const uint64_t kRowMask = (1ULL << BOARD_SIZE) - 1;
+const unsigned int kCenterBit = 1u << SIDE_WINDOW_SIZE;
+
+// Number of `player` stones in a combined window code (center excluded).
+inline int ownStones(unsigned int code, int player) {
+  unsigned int lo = code & 0x15555;
+  unsigned int hi = (code >> 1) & 0x15555;
+  return __builtin_popcount(player == PLAYER_1 ? (lo & ~hi) : (hi & ~lo));
+}
+
+inline unsigned int axisCode(const Board *board, int col, int row, int axis) {
+  return board->getLineCode(col, row, DIRECTIONS[axis][0], DIRECTIONS[axis][1]);
+}
+
+inline const Evaluation::PatternEntry &axisPattern(const Board *board, int player, int col,
+                                                   int row, int axis) {
+  return Evaluation::lookupPattern(axisCode(board, col, row, axis), player);
+}
+
+// True when `player` completes five or more on `axis` at (col, row). The game
+// counts overlines as wins, which the pattern table's gomokuCount does not.
+// Each side of the window holds four cells, so any five runs through the center.
+inline bool makesFiveOnAxis(const Board *board, int player, int col, int row, int axis) {
+  unsigned int stones = lineCellMask(axisCode(board, col, row, axis), player) | kCenterBit;
+  return (stones & (stones >> 1) & (stones >> 2) & (stones >> 3) & (stones >> 4)) != 0;
+}
+
+// Empty cells of the window on `axis` around (col, row), center excluded; see
+// lineCellMask. Visited from the highest bit, they run from k = -4 to k = 4.
+inline unsigned int emptyAround(const Board *board, int col, int row, int axis) {
+  return lineCellMask(axisCode(board, col, row, axis), EMPTY_SPACE) & ~kCenterBit;
+}
+
+bool makesFive(const Board *board, int player, int col, int row) {
+  for (int axis = 0; axis < 4; ++axis)
+    if (makesFiveOnAxis(board, player, col, row, axis)) return true;
+  return false;
+}
+
+// Without the capture rule a move removes nothing, yet makeMove still takes the
+// pairs it would capture. Fives are unaffected, but the solver plays no such
+// threat, and a defender reply of this kind leaves the line unproven.
+inline bool capturesDespiteRule(Board *board, int player, int col, int row) {
+  return !board->getEnableCapture() &&
+         Rules::detectCaptureStonesNotStore(*board, col, row, player);
+}
+
+// Pairs `player` would capture at (col, row).
+int capturesAt(const Board *board, int player, int col, int row) {
+  int pairs = 0;
+  for (int axis = 0; axis < 4; ++axis)
+    pairs += axisPattern(board, player, col, row, axis).captureCount;
+  return pairs;
+}
+
+bool hasCaptureMove(const Board *board, int player) {
+  uint64_t candidates[BOARD_SIZE];
+  board->getCandidateMask(candidates);
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    for (uint64_t bits = candidates[row]; bits; bits &= bits - 1)
+      if (capturesAt(board, player, __builtin_ctzll(bits), row)) return true;
+  }
+  return false;
+}
+
+inline void addUnique(ThreatMoveList &list, int col, int row) {
+  std::pair<int, int> move(col, row);
+  for (int i = 0; i < list.count; ++i)
+    if (list.items[i] == move) return;
+  list.push_back(move);
+}
+
+// Empty squares where `player` completes five, up to `limit` of them. A five
+// point touches a stone of the line, so the candidate mask holds all of them.
+void collectFivePoints(const Board *board, int player, ThreatMoveList &out, int limit) {
+  uint64_t candidates[BOARD_SIZE];
+  board->getCandidateMask(candidates);
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    for (uint64_t bits = candidates[row]; bits; bits &= bits - 1) {
+      int col = __builtin_ctzll(bits);
+      if (!makesFive(board, player, col, row)) continue;
+      out.push_back(std::make_pair(col, row));
+      if (out.count >= limit) return;
+    }
+  }
+}
+
+// Adds the empty ends of the pair at (x, y), (x + dx, y + dy): squares where
+// `defender` captures it, or threatens to.
+void addPairAttacks(const Board *board, int defender, int x, int y, int dx, int dy,
+                    uint64_t listed[BOARD_SIZE], ThreatMoveList &replies) {
+  int bx = x - dx, by = y - dy;
+  int ax = x + 2 * dx, ay = y + 2 * dy;
+  int before = board->getValueBit(bx, by);
+  int after = board->getValueBit(ax, ay);
+  if (before == EMPTY_SPACE && (after == EMPTY_SPACE || after == defender) &&
+      !((listed[by] >> bx) & 1)) {
+    listed[by] |= 1ULL << bx;
+    replies.push_back(std::make_pair(bx, by));
+  }
+  if (after == EMPTY_SPACE && (before == EMPTY_SPACE || before == defender) &&
+      !((listed[ay] >> ax) & 1)) {
+    listed[ay] |= 1ULL << ax;
+    replies.push_back(std::make_pair(ax, ay));
+  }
+}
+
+// Five points of `player` on the four axes through its stone at (col, row): the
+// four that stone made.
+void collectFivePointsAround(const Board *board, int player, int col, int row,
+                             ThreatMoveList &out) {
+  for (int axis = 0; axis < 4; ++axis) {
+    for (unsigned int empty = emptyAround(board, col, row, axis); empty;) {
+      int bit = 31 - __builtin_clz(empty);
+      empty ^= 1u << bit;
+      int x = col + (SIDE_WINDOW_SIZE - bit) * DIRECTIONS[axis][0];
+      int y = row + (SIDE_WINDOW_SIZE - bit) * DIRECTIONS[axis][1];
+      if (makesFiveOnAxis(board, player, x, y, axis)) addUnique(out, x, y);
+    }
+  }
+}
+
+// Axes (bit mask) on which the stone at (col, row) left `player` an open-four point:
+// the open threes it made.
+int openThreeAxes(const Board *board, int player, int col, int row) {
+  int axes = 0;
+  for (int axis = 0; axis < 4; ++axis) {
+    for (unsigned int empty = emptyAround(board, col, row, axis); empty;) {
+      int bit = 31 - __builtin_clz(empty);
+      empty ^= 1u << bit;
+      int x = col + (SIDE_WINDOW_SIZE - bit) * DIRECTIONS[axis][0];
+      int y = row + (SIDE_WINDOW_SIZE - bit) * DIRECTIONS[axis][1];
+      if (axisPattern(board, player, x, y, axis).openFourCount) {
+        axes |= 1 << axis;
+        break;
+      }
+    }
+  }
+  return axes;
+}
+
+// After `player` completed five through (col, row): true when the opponent can
+// neither capture a stone of it nor reach the capture goal with any capture.
+bool fiveStands(const Board *board, int player, int col, int row) {
+  if (!board->getEnableCapture()) return true;
+  int opponent = OPPONENT(player);
+
+  for (int axis = 0; axis < 4; ++axis) {
+    int dx = DIRECTIONS[axis][0];
+    int dy = DIRECTIONS[axis][1];
+    int back = 0;
+    while (board->getValueBit(col - (back + 1) * dx, row - (back + 1) * dy) == player) ++back;
+    int forward = 0;
+    while (board->getValueBit(col + (forward + 1) * dx, row + (forward + 1) * dy) == player)
+      ++forward;
+    if (back + forward + 1 < 5) continue;
+
+    for (int k = -back; k <= forward; ++k) {
+      int x = col + k * dx;
+      int y = row + k * dy;
+      for (int d = 0; d < 8; ++d) {
+        int ddx = DIRECTIONS[d][0];
+        int ddy = DIRECTIONS[d][1];
+        if (board->getValueBit(x + ddx, y + ddy) != player) continue;
+        int before = board->getValueBit(x - ddx, y - ddy);
+        int after = board->getValueBit(x + 2 * ddx, y + 2 * ddy);
+        if ((before == opponent && after == EMPTY_SPACE) ||
+            (before == EMPTY_SPACE && after == opponent))
+          return false;
+      }
+    }
+    // After the move the opponent is the side to move.
+    return board->getNextPlayerScore() + 1 < board->getGoal() || !hasCaptureMove(board, opponent);
+  }
+  return false;
+}
+
+}  // namespace
+
+Cache::Cache() : slots_(static_cast<Slot *>(std::calloc(kCacheSize, sizeof(Slot)))) {
+  if (!slots_) throw std::runtime_error("Threat cache allocation failed");
+}
+
+Cache::~Cache() { std::free(slots_); }
+
+void Cache::clear() {
+  for (size_t i = 0; i < kCacheSize; ++i) {
+    __atomic_store_n(&slots_[i].data, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&slots_[i].check, 0, __ATOMIC_RELAXED);
+  }
+}
+
+bool Cache::probe(uint64_t key, int symmetry, int depth, bool &win,
+                  std::pair<int, int> &move) const {
+  const Slot &slot = slots_[key & (kCacheSize - 1)];
+  uint64_t data = __atomic_load_n(&slot.data, __ATOMIC_RELAXED);
+  uint64_t check = __atomic_load_n(&slot.check, __ATOMIC_RELAXED);
+  if ((check ^ data) != key || !(data & 1)) return false;
+  win = (data >> 1) & 1;
+  int storedDepth = (int)((data >> 2) & 0xFF);
+  if (win ? storedDepth > depth : storedDepth < depth) return false;
+  int index = (int)((data >> 10) & 0xFFFF);
+  move = inverseSymmetricMove(symmetry, index % BOARD_SIZE, index / BOARD_SIZE);
+  return true;
+}
+
+void Cache::store(uint64_t key, int symmetry, int depth, bool win,
+                  const std::pair<int, int> &move) {
+  std::pair<int, int> stored = win ? symmetricMove(symmetry, move.first, move.second) : move;
+  int index = win ? stored.second * BOARD_SIZE + stored.first : 0;
+  uint64_t data = 1 | ((uint64_t)win << 1) | ((uint64_t)(depth & 0xFF) << 2) |
+                  ((uint64_t)index << 10);
+  Slot &slot = slots_[key & (kCacheSize - 1)];
+  __atomic_store_n(&slot.data, data, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot.check, key ^ data, __ATOMIC_RELAXED);
+}
+
+Solver::Solver(Cache &cache)
+    : cache_(cache), mode_(VCF), nodes_(0), nodeLimit_(0), aborted_(false), rootMove_(-1, -1) {}
+
+bool Solver::findWin(Board *board, Mode mode, int maxDepth, unsigned long long nodeLimit,
+                     std::pair<int, int> &move) {
+  mode_ = mode;
+  nodes_ = 0;
+  nodeLimit_ = nodeLimit;
+  aborted_ = false;
+  rootMove_ = std::make_pair(-1, -1);
+  if (maxDepth > VCF_MAX_DEPTH) maxDepth = VCF_MAX_DEPTH;
+  if (!attack(board, maxDepth, 0)) return false;
+  move = rootMove_;
+  return true;
+}
+
+bool Solver::isForbidden(Board *board, int player, int col, int row) {
+  if (!board->getEnableDoubleThreeRestriction()) return false;
+  uint64_t cells[BOARD_SIZE] = {0};
+  uint64_t forbidden[BOARD_SIZE];
+  cells[row] = 1ULL << col;
+  Rules::detectDoublethreeMask(*board, player, cells, forbidden, finder_);
+  return forbidden[row] != 0;
+}
+
+// A win for the side to move on this very move: five, or reaching the capture
+// goal. `strict` also requires the five to stand and the move to be legal; the
+// loose form answers "can the defender win here?" and errs on its side.
+bool Solver::findImmediateWin(Board *board, bool strict, std::pair<int, int> *move) {
+  int player = board->getNextPlayer();
+  uint64_t candidates[BOARD_SIZE];
+  board->getCandidateMask(candidates);
+
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    for (uint64_t bits = candidates[row]; bits; bits &= bits - 1) {
+      int col = __builtin_ctzll(bits);
+      if (!makesFive(board, player, col, row)) continue;
+      if (!strict) return true;
+      if (isForbidden(board, player, col, row)) continue;
+      UndoInfo ui = board->makeMove(col, row);
+      board->flushCaptures();
+      bool stands = fiveStands(board, player, col, row);
+      board->undoMove(ui);
+      if (stands) {
+        *move = std::make_pair(col, row);
+        return true;
+      }
+    }
+  }
+
+  if (!board->getEnableCapture()) return false;
+  int score = board->getNextPlayerScore();
+  for (int row = 0; row < BOARD_SIZE; ++row) {
+    for (uint64_t bits = candidates[row]; bits; bits &= bits - 1) {
+      int col = __builtin_ctzll(bits);
+      if (score + capturesAt(board, player, col, row) < board->getGoal()) continue;
+      if (!strict) return true;
+      if (isForbidden(board, player, col, row)) continue;
+      *move = std::make_pair(col, row);
+      return true;
+    }
+  }
+  return false;
+}
+
+// The defender (side to move) passes: does the attacker then win on one of
+// `fivePoints`? Only such a four forces a reply.
+bool Solver::winsAfterPass(Board *board, const ThreatMoveList &fivePoints) {
+  board->switchTurn();
+  int attacker = board->getNextPlayer();
+  bool wins = false;
+  for (size_t i = 0; i < fivePoints.size() && !wins; ++i) {
+    int col = fivePoints[i].first;
+    int row = fivePoints[i].second;
+    if (isForbidden(board, attacker, col, row)) continue;
+    UndoInfo ui = board->makeMove(col, row);
+    board->flushCaptures();
+    wins = fiveStands(board, attacker, col, row);
+    board->undoMove(ui);
+  }
+  board->switchTurn();
+  return wins;
+}
+
+// Attacker (side to move) node: win now, or make a threat every reply loses to.
+bool Solver::attack(Board *board, int depth, int ply) {
+  if (++nodes_ > nodeLimit_) {
+    aborted_ = true;
+    return false;
+  }
+  int attacker = board->getNextPlayer();
+  int defender = OPPONENT(attacker);
+  int symmetry;
+  uint64_t key = cacheKey(board->getCanonicalHash(symmetry), mode_);
+  bool cachedWin;
+  std::pair<int, int> move(-1, -1);
+  if (cache_.probe(key, symmetry, depth, cachedWin, move)) {
+    if (cachedWin && ply == 0) rootMove_ = move;
+    return cachedWin;
+  }
+
+  if (findImmediateWin(board, true, &move)) {
+    if (ply == 0) rootMove_ = move;
+    cache_.store(key, symmetry, 0, true, move);
+    return true;
+  }
+  if (depth == 0) return false;
+
+  // A four of the defender must be blocked; two cannot be.
+  ThreatMoveList &candidates = lists_[ply];
+  candidates.clear();
+  collectFivePoints(board, defender, candidates, 2);
+  if (candidates.count > 1) {
+    cache_.store(key, symmetry, depth, false, move);
+    return false;
+  }
+
+  if (candidates.count == 0) {
+    uint64_t occupancy[BOARD_SIZE];
+    board->getOccupancy(occupancy);
+    for (int row = 0; row < BOARD_SIZE; ++row) {
+      for (uint64_t bits = ~occupancy[row] & kRowMask; bits; bits &= bits - 1) {
+        int col = __builtin_ctzll(bits);
+        for (int axis = 0; axis < 4; ++axis) {
+          unsigned int code = axisCode(board, col, row, axis);
+          if (ownStones(code, attacker) >= 3 ||
+              (mode_ == VCT && Evaluation::lookupPattern(code, attacker).openThreeCount)) {
+            candidates.push_back(std::make_pair(col, row));
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  // Fours first: they leave the defender the fewest replies.
+  int passes = (mode_ == VCT) ? 2 : 1;
+  for (int pass = 0; pass < passes; ++pass) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      int col = candidates[i].first;
+      int row = candidates[i].second;
+      if (isForbidden(board, attacker, col, row) || capturesDespiteRule(board, attacker, col, row))
+        continue;
+      UndoInfo ui = board->makeMove(col, row);
+      board->flushCaptures();
+      bool won = defend(board, col, row, depth, pass == 1, ply + 1);
+      board->undoMove(ui);
+      if (won) {
+        if (ply == 0) rootMove_ = candidates[i];
+        cache_.store(key, symmetry, depth, true, candidates[i]);
+        return true;
+      }
+      if (aborted_) return false;
+    }
+  }
+  cache_.store(key, symmetry, depth, false, move);
+  return false;
+}
+
+// Defender (side to move) node after the attacker's stone at (col, row). False
+// unless that stone made the threat this pass looks for and every reply loses.
+bool Solver::defend(Board *board, int col, int row, int depth, bool threes, int ply) {
+  ++nodes_;
+  int defender = board->getNextPlayer();
+  int attacker = OPPONENT(defender);
+
+  ThreatMoveList &replies = lists_[ply];
+  replies.clear();
+  collectFivePointsAround(board, attacker, col, row, replies);
+  int threeAxes = 0;
+  if (!threes) {
+    if (replies.count == 0 || !winsAfterPass(board, replies)) return false;
+  } else {
+    if (replies.count > 0) return false;  // a four: tried in the first pass
+    threeAxes = openThreeAxes(board, attacker, col, row);
+    if (!threeAxes) return false;
+  }
+  if (findImmediateWin(board, false, NULL)) return false;
+  int fivePoints = replies.count;
+
+  uint64_t listed[BOARD_SIZE] = {0};
+  for (size_t i = 0; i < replies.size(); ++i) listed[replies[i].second] |= 1ULL << replies[i].first;
+
+  if (threes) {
+    // Any square of the three's line, or a four of the defender's own.
+    for (int axis = 0; axis < 4; ++axis) {
+      if (!(threeAxes & (1 << axis))) continue;
+      for (int k = -5; k <= 5; ++k) {
+        int x = col + k * DIRECTIONS[axis][0];
+        int y = row + k * DIRECTIONS[axis][1];
+        if (board->getValueBit(x, y) != EMPTY_SPACE || (listed[y] >> x) & 1) continue;
+        listed[y] |= 1ULL << x;
+        replies.push_back(std::make_pair(x, y));
+      }
+    }
+    uint64_t occupancy[BOARD_SIZE];
+    board->getOccupancy(occupancy);
+    ThreatMoveList &fours = lists_[ply + 1];
+    for (int y = 0; y < BOARD_SIZE; ++y) {
+      for (uint64_t bits = ~occupancy[y] & ~listed[y] & kRowMask; bits; bits &= bits - 1) {
+        int x = __builtin_ctzll(bits);
+        bool mayFour = false;
+        for (int axis = 0; axis < 4 && !mayFour; ++axis)
+          mayFour = ownStones(axisCode(board, x, y, axis), defender) >= 3;
+        if (!mayFour) continue;
+        if (capturesDespiteRule(board, defender, x, y)) return false;
+        UndoInfo ui = board->makeMove(x, y);
+        board->flushCaptures();
+        fours.clear();
+        collectFivePointsAround(board, defender, x, y, fours);
+        board->undoMove(ui);
+        if (fours.count == 0) continue;
+        listed[y] |= 1ULL << x;
+        replies.push_back(std::make_pair(x, y));
+      }
+    }
+  }
+
+  if (board->getEnableCapture()) {
+    // Capture, or threaten to capture, a pair holding a stone near the threat.
+    // Once one more pair reaches the goal, every attacker pair counts.
+    bool anyPair = board->getNextPlayerScore() + 1 >= board->getGoal();
+    for (int y = 0; y < BOARD_SIZE; ++y) {
+      for (int x = 0; x < BOARD_SIZE; ++x) {
+        if (board->getValueBit(x, y) != attacker) continue;
+        int dx = x - col;
+        int dy = y - row;
+        bool nearThreat = (dx == 0 || dy == 0 || dx == dy || dx == -dy) && std::abs(dx) <= 4 &&
+                          std::abs(dy) <= 4;
+        if (!anyPair && !nearThreat) continue;
+        for (int d = 0; d < 8; ++d) {
+          if (board->getValueBit(x + DIRECTIONS[d][0], y + DIRECTIONS[d][1]) == attacker)
+            addPairAttacks(board, defender, x, y, DIRECTIONS[d][0], DIRECTIONS[d][1], listed,
+                           replies);
+        }
+      }
+    }
+    // The stone that completes a four can itself end up in a captured pair.
+    for (int i = 0; i < fivePoints; ++i) {
+      int x = replies[i].first;
+      int y = replies[i].second;
+      for (int d = 0; d < 8; ++d) {
+        if (board->getValueBit(x + DIRECTIONS[d][0], y + DIRECTIONS[d][1]) == attacker)
+          addPairAttacks(board, defender, x, y, DIRECTIONS[d][0], DIRECTIONS[d][1], listed,
+                         replies);
+      }
+    }
+  }
+
+  bool anyLegal = false;
+  for (size_t i = 0; i < replies.size(); ++i) {
+    int x = replies[i].first;
+    int y = replies[i].second;
+    if (isForbidden(board, defender, x, y)) continue;
+    if (capturesDespiteRule(board, defender, x, y)) return false;
+    anyLegal = true;
+    UndoInfo ui = board->makeMove(x, y);
+    board->flushCaptures();
+    bool won = attack(board, depth - 1, ply + 1);
+    board->undoMove(ui);
+    if (!won) return false;
+  }
+  // Against a four the attacker already showed a standing five.
+  return anyLegal || !threes;
+}
+
+}  // namespace ThreatSearch
@@ -0,0 +1,48 @@
+#include "TimeManager.hpp"
+
+#include <time.h>
+
+TimeManager::TimeManager()
+    : startMs_(nowMs()), startNodes_(0), nextPollNodes_(0), stopped_(false), pondering_(false) {}
+
+double TimeManager::nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+void TimeManager::start(const SearchLimits &limits) {
+  limits_ = limits;
+  startMs_ = nowMs();
+  startNodes_ = 0;
+  nextPollNodes_ = 0;
+  stopped_ = false;
+  pondering_ = limits.ponderHit != NULL && !loadFlag(limits.ponderHit);
+}
+
+bool TimeManager::takePonderHit(unsigned long long nodes) {
+  if (!loadFlag(limits_.ponderHit)) return false;
+  // The opponent played the predicted move: this is the real search, and its
+  // clock and node count start now.
+  pondering_ = false;
+  startMs_ = nowMs();
+  startNodes_ = nodes;
+  return true;
+}
+
+void TimeManager::pollPonder(unsigned long long nodes) {
+  if (!takePonderHit(nodes) && limits_.ponderMs > 0.0 && clockDue(nodes) &&
+      elapsedMs() >= limits_.ponderMs)
+    stopped_ = true;
+}
+
+double TimeManager::elapsedMs() const { return nowMs() - startMs_; }
+
+bool TimeManager::canStartIteration(unsigned long long nodes) {
+  if (stopped_) return false;
+  if (pondering_ && !takePonderHit(nodes))
+    return limits_.ponderMs <= 0.0 || elapsedMs() < limits_.ponderMs;
+  double elapsed = elapsedMs();
+  if (limits_.hardMs > 0.0 && elapsed >= limits_.hardMs) return false;
+  return limits_.softMs <= 0.0 || elapsed < limits_.softMs;
+}
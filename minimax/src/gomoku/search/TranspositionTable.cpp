@@ -0,0 +1,374 @@
+#include "TranspositionTable.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Gomoku.hpp"
+
+namespace {
+
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+// data layout: score(32) | move(16) | depth(8) | bound(2) | generation(6)
+inline uint64_t packData(const TTEntry &e, uint8_t generation) {
+  uint64_t move = 0;  // 0 = no move, else index + 1
+  if (e.bestMove.first >= 0 && e.bestMove.second >= 0)
+    move = (uint64_t)(e.bestMove.first * BOARD_SIZE + e.bestMove.second + 1);
+  int depth = e.depth < 0 ? 0 : (e.depth > 255 ? 255 : e.depth);
+  return (uint64_t)(uint32_t)e.score | (move << 32) | ((uint64_t)depth << 48) |
+         ((uint64_t)e.flag << 56) | ((uint64_t)(generation & 63) << 58);
+}
+
+inline int dataMove(uint64_t data) { return (int)((data >> 32) & 0xFFFF); }
+inline int dataDepth(uint64_t data) { return (int)((data >> 48) & 0xFF); }
+inline BoundType dataBound(uint64_t data) { return (BoundType)((data >> 56) & 3); }
+inline uint8_t dataGeneration(uint64_t data) { return (uint8_t)(data >> 58); }
+
+inline void unpackData(uint64_t data, TTEntry &out) {
+  out.score = (int)(int32_t)(uint32_t)data;
+  out.depth = dataDepth(data);
+  out.flag = dataBound(data);
+  int move = dataMove(data);
+  if (move == 0)
+    out.bestMove = std::make_pair(-1, -1);
+  else
+    out.bestMove = std::make_pair((move - 1) / BOARD_SIZE, (move - 1) % BOARD_SIZE);
+}
+
+inline uint64_t withGeneration(uint64_t data, uint8_t generation) {
+  return (data & ~(63ULL << 58)) | ((uint64_t)(generation & 63) << 58);
+}
+
+inline uint64_t loadWord(const uint64_t *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+inline void storeWord(uint64_t *p, uint64_t v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+
+const char kSnapshotMagic[8] = {'G', 'M', 'K', 'T', 'T', 'S', 'N', 'P'};
+const uint32_t kByteOrderMark = 0x01020304u;
+
+// File layout: header, then entryCount (key, data) word pairs in the writer's
+// native byte order.
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t tag;
+  uint32_t rules;
+  uint32_t entrySize;
+  uint64_t entryCount;
+  uint64_t checksum;  // FNV-1a over this header (checksum 0) and the entry words
+};
+
+uint64_t fnv1aWords(const uint64_t *words, size_t count, uint64_t hash) {
+  for (size_t i = 0; i < count; ++i) hash = (hash ^ words[i]) * 1099511628211ULL;
+  return hash;
+}
+
+uint64_t snapshotChecksum(const SnapshotHeader &header, const std::vector<uint64_t> &words) {
+  SnapshotHeader unsummed = header;
+  unsummed.checksum = 0;
+  uint64_t headerWords[sizeof(SnapshotHeader) / sizeof(uint64_t)];
+  std::memcpy(headerWords, &unsummed, sizeof(headerWords));
+  uint64_t hash = fnv1aWords(headerWords, sizeof(headerWords) / sizeof(uint64_t),
+                             1469598103934665603ULL);
+  return fnv1aWords(words.empty() ? NULL : &words[0], words.size(), hash);
+}
+
+// A snapshot entry as (key, data), for merging snapshots.
+typedef std::pair<uint64_t, uint64_t> SnapshotEntry;
+
+bool byKeyDeepestFirst(const SnapshotEntry &a, const SnapshotEntry &b) {
+  if (a.first != b.first) return a.first < b.first;
+  return dataDepth(a.second) > dataDepth(b.second);
+}
+
+bool samePosition(const SnapshotEntry &a, const SnapshotEntry &b) { return a.first == b.first; }
+
+bool deeper(const SnapshotEntry &a, const SnapshotEntry &b) {
+  return dataDepth(a.second) > dataDepth(b.second);
+}
+
+// Bytes from the current position of `in` to its end, or -1.
+long remainingBytes(FILE *in) {
+  long start = std::ftell(in);
+  if (start < 0 || std::fseek(in, 0, SEEK_END) != 0) return -1;
+  long end = std::ftell(in);
+  if (end < 0 || std::fseek(in, start, SEEK_SET) != 0) return -1;
+  return end - start;
+}
+
+}  // namespace
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+    : buckets_(NULL), bucketCount_(0), mapped_(false), hugePages_(false), generation_(0) {
+  if (!resize(megabytes)) throw std::runtime_error("Transposition table allocation failed");
+}
+
+TranspositionTable::~TranspositionTable() { release(); }
+
+bool TranspositionTable::resize(size_t megabytes, bool hugePages) {
+  if (megabytes == 0) megabytes = 1;
+  size_t maxBuckets = (megabytes << 20) / sizeof(Bucket);
+  size_t count = 1;
+  while (count * 2 <= maxBuckets) count *= 2;
+
+  Bucket *oldBuckets = buckets_;
+  size_t oldCount = bucketCount_;
+  bool oldMapped = mapped_;
+  bool oldHuge = hugePages_;
+
+  if (!allocate(count * sizeof(Bucket), hugePages)) {
+    buckets_ = oldBuckets;
+    bucketCount_ = oldCount;
+    mapped_ = oldMapped;
+    hugePages_ = oldHuge;
+    return false;
+  }
+  bucketCount_ = count;
+
+  if (oldBuckets) {
+    if (oldMapped)
+      munmap(oldBuckets, oldCount * sizeof(Bucket));
+    else
+      std::free(oldBuckets);
+  }
+  generation_ = 0;
+  return true;
+}
+
+bool TranspositionTable::allocate(size_t bytes, bool hugePages) {
+  void *mem = NULL;
+#ifdef MAP_HUGETLB
+  if (hugePages && bytes % kHugePageSize == 0) {
+    mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1,
+               0);
+    if (mem != MAP_FAILED) {
+      buckets_ = static_cast<Bucket *>(mem);  // anonymous mappings start zeroed
+      mapped_ = true;
+      hugePages_ = true;
+      return true;
+    }
+  }
+#endif
+  // No reserved huge pages: fall back to an aligned heap block and ask for
+  // transparent huge pages instead.
+  size_t alignment = (hugePages && bytes >= kHugePageSize) ? kHugePageSize : sizeof(Bucket);
+  if (posix_memalign(&mem, alignment, bytes) != 0) return false;
+  hugePages_ = false;
+#ifdef MADV_HUGEPAGE
+  if (hugePages && bytes >= kHugePageSize) hugePages_ = (madvise(mem, bytes, MADV_HUGEPAGE) == 0);
+#endif
+  std::memset(mem, 0, bytes);
+  buckets_ = static_cast<Bucket *>(mem);
+  mapped_ = false;
+  return true;
+}
+
+void TranspositionTable::release() {
+  if (!buckets_) return;
+  if (mapped_)
+    munmap(buckets_, bucketCount_ * sizeof(Bucket));
+  else
+    std::free(buckets_);
+  buckets_ = NULL;
+  bucketCount_ = 0;
+}
+
+void TranspositionTable::clear() {
+  std::memset(buckets_, 0, bucketCount_ * sizeof(Bucket));
+  generation_ = 0;
+}
+
+void TranspositionTable::newSearch() { generation_ = (uint8_t)((generation_ + 1) & 63); }
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &out) const {
+  const Bucket &bucket = buckets_[key & (bucketCount_ - 1)];
+  for (int i = 0; i < TT_BUCKET_ENTRIES; ++i) {
+    uint64_t data = loadWord(&bucket.slots[i].data);
+    uint64_t check = loadWord(&bucket.slots[i].check);
+    if ((check ^ data) == key && (check | data) != 0) {
+      unpackData(data, out);
+      return true;
+    }
+  }
+  return false;
+}
+
+void TranspositionTable::store(uint64_t key, const TTEntry &entry) {
+  insert(key, packData(entry, generation_));
+}
+
+void TranspositionTable::insert(uint64_t key, uint64_t data) {
+  Bucket &bucket = buckets_[key & (bucketCount_ - 1)];
+  Slot *victim = NULL;
+  uint64_t victimData = 0;
+  bool sameKey = false;
+  int victimValue = INT_MAX;
+
+  for (int i = 0; i < TT_BUCKET_ENTRIES; ++i) {
+    Slot &slot = bucket.slots[i];
+    uint64_t slotData = loadWord(&slot.data);
+    uint64_t check = loadWord(&slot.check);
+    if ((check | slotData) == 0) {  // empty slot
+      if (victimValue > INT_MIN) {
+        victim = &slot;
+        victimValue = INT_MIN;
+      }
+      continue;
+    }
+    if ((check ^ slotData) == key) {
+      victim = &slot;
+      victimData = slotData;
+      sameKey = true;
+      break;
+    }
+    // Prefer to evict shallow entries from older searches.
+    int age = (generation_ - dataGeneration(slotData)) & 63;
+    int value = dataDepth(slotData) - 8 * age;
+    if (value < victimValue) {
+      victim = &slot;
+      victimValue = value;
+    }
+  }
+
+  // An exact score from this search outlives a much shallower bound or score,
+  // e.g. from a null-window probe or a reduced re-search of the same position.
+  if (sameKey && dataBound(victimData) == EXACT && dataGeneration(victimData) == generation_ &&
+      dataDepth(data) < dataDepth(victimData) - TT_EXACT_KEEP_MARGIN)
+    return;
+  // Keep the previous best move when the new result has none.
+  if (sameKey && dataMove(data) == 0)
+    data |= (uint64_t)dataMove(victimData) << 32;
+  storeWord(&victim->data, data);
+  storeWord(&victim->check, key ^ data);
+}
+
+void TranspositionTable::collectSnapshot(int minDepth, TTSnapshot &out) const {
+  for (size_t b = 0; b < bucketCount_; ++b) {
+    for (int i = 0; i < TT_BUCKET_ENTRIES; ++i) {
+      const Slot &slot = buckets_[b].slots[i];
+      if ((slot.check | slot.data) == 0 || dataDepth(slot.data) < minDepth) continue;
+      out.words.push_back(slot.check ^ slot.data);
+      out.words.push_back(slot.data);
+    }
+  }
+}
+
+void TranspositionTable::keepDeepest(TTSnapshot &snapshot, size_t maxEntries) {
+  std::vector<SnapshotEntry> entries(snapshot.entryCount());
+  for (size_t i = 0; i < entries.size(); ++i)
+    entries[i] = SnapshotEntry(snapshot.words[2 * i], snapshot.words[2 * i + 1]);
+  // One entry per position, the deepest; then the deepest positions that fit.
+  std::sort(entries.begin(), entries.end(), byKeyDeepestFirst);
+  entries.erase(std::unique(entries.begin(), entries.end(), samePosition), entries.end());
+  if (entries.size() > maxEntries) {
+    std::nth_element(entries.begin(), entries.begin() + maxEntries, entries.end(), deeper);
+    entries.resize(maxEntries);
+  }
+  snapshot.words.resize(2 * entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    snapshot.words[2 * i] = entries[i].first;
+    snapshot.words[2 * i + 1] = entries[i].second;
+  }
+}
+
+bool TranspositionTable::saveSnapshot(const char *path, int minDepth, uint64_t tag,
+                                      uint32_t rules) const {
+  TTSnapshot snapshot;
+  snapshot.rules = rules;
+  collectSnapshot(minDepth, snapshot);
+  return writeSnapshot(path, tag, snapshot);
+}
+
+bool TranspositionTable::writeSnapshot(const char *path, uint64_t tag,
+                                       const TTSnapshot &snapshot) {
+  const std::vector<uint64_t> &words = snapshot.words;
+  SnapshotHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+  header.version = TT_SNAPSHOT_FILE_VERSION;
+  header.byteOrder = kByteOrderMark;
+  header.tag = tag;
+  header.rules = snapshot.rules;
+  header.entrySize = 2 * sizeof(uint64_t);
+  header.entryCount = snapshot.entryCount();
+  header.checksum = snapshotChecksum(header, words);
+  const uint64_t *data = words.empty() ? NULL : &words[0];
+
+  // Write next to the target and rename, so a crash mid-write keeps the old snapshot.
+  std::string tmpPath = std::string(path) + ".tmp";
+  FILE *out = std::fopen(tmpPath.c_str(), "wb");
+  if (!out) {
+    std::cerr << "TT snapshot: cannot open " << tmpPath << " for writing" << std::endl;
+    return false;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+            (words.empty() ||
+             std::fwrite(data, sizeof(uint64_t), words.size(), out) == words.size());
+  ok = (std::fclose(out) == 0) && ok;
+  if (!ok || std::rename(tmpPath.c_str(), path) != 0) {
+    std::cerr << "TT snapshot: failed to write " << path << std::endl;
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool TranspositionTable::readSnapshot(const char *path, uint64_t tag, size_t maxEntries,
+                                      TTSnapshot &out) {
+  FILE *in = std::fopen(path, "rb");
+  if (!in) return false;
+  SnapshotHeader header;
+  const char *problem = NULL;
+  std::vector<uint64_t> words;
+  if (std::fread(&header, sizeof(header), 1, in) != 1 ||
+      std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0)
+    problem = "not a snapshot file";
+  else if (header.version != TT_SNAPSHOT_FILE_VERSION)
+    problem = "version mismatch";
+  else if (header.byteOrder != kByteOrderMark || header.entrySize != 2 * sizeof(uint64_t))
+    problem = "layout mismatch";
+  else if (header.tag != tag)
+    problem = "built with different keys or scores";
+  else if (header.entryCount > maxEntries)
+    problem = "more entries than the table holds";
+  else if (remainingBytes(in) != (long)(header.entryCount * header.entrySize))
+    problem = "entry count does not match the file size";
+  if (!problem) {
+    // The count is bounded by the table and the file by now; a failed allocation
+    // still only means a cold start.
+    try {
+      words.resize(2 * header.entryCount);
+    } catch (const std::exception &) {
+      problem = "out of memory";
+    }
+  }
+  if (!problem) {
+    if (!words.empty() && std::fread(&words[0], sizeof(uint64_t), words.size(), in) != words.size())
+      problem = "truncated";
+    else if (header.checksum != snapshotChecksum(header, words))
+      problem = "checksum mismatch";
+  }
+  std::fclose(in);
+  if (problem) {
+    std::cerr << "TT snapshot: " << path << ": " << problem << std::endl;
+    return false;
+  }
+  out.words.swap(words);
+  out.rules = header.rules;
+  return true;
+}
+
+void TranspositionTable::restoreSnapshot(const TTSnapshot &snapshot) {
+  const std::vector<uint64_t> &words = snapshot.words;
+  for (size_t i = 0; i + 1 < words.size(); i += 2)
+    insert(words[i], withGeneration(words[i + 1], generation_));
+}
@@ -1,6 +1,12 @@
+#include <unistd.h>
+
 #include <csignal>
+#include <cstdlib>
 
+#include "OpeningBook.hpp"
 #include "dotenv.hpp"
+#include "engine_pool.hpp"
+#include "request_handlers.hpp"
 #include "server.hpp"
 
 volatile std::sig_atomic_t stopFlag = 0;
@@ -10,15 +16,60 @@ void handleSignal(int signal) {
   stopFlag = 1;
 }
 
-int main() {
+int main(int argc, char** argv) {
+  // Build step: `minimax --write-pattern-tables <file>` serializes the evaluation tables for
+  // MINIMAX_PATTERN_TABLES and exits.
+  if (argc == 3 && std::string(argv[1]) == "--write-pattern-tables") {
+    Evaluation::initCombinedPatternScoreTables();
+    Evaluation::initCombinedPatternScoreTablesHard();
+    if (!Evaluation::writePatternTables(argv[2])) return 1;
+    std::cout << "Pattern tables written to " << argv[2] << std::endl;
+    return 0;
+  }
+
+  // Offline step: `minimax --build-opening-book <file> [max-stones] [workers] [ms-per-position]`
+  // searches the openings and writes a book for MINIMAX_OPENING_BOOK.
+  if (argc >= 3 && argc <= 6 && std::string(argv[1]) == "--build-opening-book") {
+    OpeningBook::BuildOptions options;
+    options.workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (argc > 3) options.maxStones = std::atoi(argv[3]);
+    if (argc > 4) options.workers = std::atoi(argv[4]);
+    if (argc > 5) options.limits = SearchLimits::fromTime(std::atoi(argv[5]));
+    initZobrist();
+    Evaluation::initPatternTables(std::getenv("MINIMAX_PATTERN_TABLES"));
+    return OpeningBook::build(argv[2], options) ? 0 : 1;
+  }
+
   // Register signal handlers for graceful shutdown.
   dotenv::init();
   std::signal(SIGINT, handleSignal);
   std::signal(SIGTERM, handleSignal);
 
   try {
-    Server server(dotenv::envToInt("MINIMAX_PORT", dotenv::envToInt("LOCAL_MINIMAX")));
+    const char* snapshot = std::getenv("MINIMAX_TT_SNAPSHOT");
+    bool snapshots = snapshot && *snapshot;
+    int workers = dotenv::envToInt("MINIMAX_WORKERS", 0);  // 0 = one per core
+    if (workers < 1) workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    Server server(dotenv::envToInt("MINIMAX_PORT", dotenv::envToInt("LOCAL_MINIMAX")),
+                  dotenv::envToInt("MINIMAX_THREADS", 1), workers < 1 ? 1 : workers);
+    // Each session searches with its own tables, allocated as sessions need
+    // them; a warm restart loads the snapshot into every one of them.
+    if (!configureEnginePool(
+            dotenv::envToInt("MINIMAX_SESSIONS", ENGINE_POOL_DEFAULT_SESSIONS),
+            dotenv::envToInt("MINIMAX_TT_MB", TT_DEFAULT_MB),
+            dotenv::envToInt("MINIMAX_EVAL_CACHE_MB", EVAL_CACHE_DEFAULT_MB),
+            snapshots ? snapshot : ""))
+      throw std::runtime_error("engine context allocation failed (MINIMAX_TT_MB, "
+                               "MINIMAX_EVAL_CACHE_MB)");
+    // Budget of the search on the opponent's time after each medium or hard move.
+    setPonderTime(dotenv::envToInt("MINIMAX_PONDER_MS", PONDER_DEFAULT_MS));
+    if (snapshots)
+      server.setTTSnapshot(snapshot, dotenv::envToInt("MINIMAX_TT_SNAPSHOT_SECONDS", 0));
     server.run(stopFlag);
+    // Graceful shutdown (SIGINT/SIGTERM): keep the deep entries for the next start.
+    if (snapshots && saveEngineSnapshot(snapshot))
+      std::cout << "TT snapshot: saved to " << snapshot << std::endl;
+    destroyEnginePool();
   } catch (const std::exception& ex) {
     std::cerr << "Server initialization failed: " << ex.what() << std::endl;
     return 1;
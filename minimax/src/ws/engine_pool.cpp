@@ -0,0 +1,112 @@
+#include "engine_pool.hpp"
+
+#include <exception>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct PooledEngine {
+  EngineContext *engine;
+  int sessions;       // connections using it
+  psd_debug *holder;  // the session whose worker job searches on it, if any
+
+  explicit PooledEngine(EngineContext *context) : engine(context), sessions(0), holder(NULL) {}
+};
+
+std::vector<PooledEngine> engines;  // allocated as sessions need them, kept for reuse
+size_t maxEngines = 0;
+size_t poolTTMegabytes = 0;
+size_t poolEvalCacheMegabytes = 0;
+// The startup snapshot, restored into each context as it is allocated; dropped
+// once all of them are.
+TTSnapshot startSnapshot;
+
+PooledEngine *findEngine(EngineContext *engine) {
+  for (size_t i = 0; i < engines.size(); ++i)
+    if (engines[i].engine == engine) return &engines[i];
+  return NULL;
+}
+
+// Allocates one more context and warms it with the startup snapshot.
+EngineContext *createEngine() {
+  EngineContext *engine = NULL;
+  try {
+    engine = new EngineContext(poolTTMegabytes, poolEvalCacheMegabytes);
+  } catch (const std::exception &ex) {
+    std::cerr << "Engine context: " << ex.what() << std::endl;
+    return NULL;
+  }
+  engines.push_back(PooledEngine(engine));
+  std::cout << "Engine context " << engines.size() << ": transposition table "
+            << (engine->transTable.sizeInBytes() >> 20) << " MB, "
+            << engine->transTable.entryCount() << " entries"
+            << (engine->transTable.usesHugePages() ? " (huge pages)" : "")
+            << ", evaluation cache " << (engine->evalCache.sizeInBytes() >> 20) << " MB"
+            << std::endl;
+  if (startSnapshot.entryCount() > 0) Minimax::restoreTTSnapshot(*engine, startSnapshot);
+  if (engines.size() == maxEngines) std::vector<uint64_t>().swap(startSnapshot.words);
+  return engine;
+}
+
+}  // namespace
+
+bool configureEnginePool(int maxSessions, size_t ttMegabytes, size_t evalCacheMegabytes,
+                         const std::string &snapshotPath) {
+  if (!engines.empty()) return true;
+  maxEngines = maxSessions < 1 ? 1 : maxSessions;
+  poolTTMegabytes = ttMegabytes;
+  poolEvalCacheMegabytes = evalCacheMegabytes;
+  EngineContext *first = createEngine();
+  if (first == NULL) return false;
+  // Warm start: what the tables learned before the last shutdown, read once and
+  // kept for the contexts allocated later.
+  if (!snapshotPath.empty() &&
+      Minimax::readTTSnapshot(*first, snapshotPath.c_str(), startSnapshot)) {
+    Minimax::restoreTTSnapshot(*first, startSnapshot);
+    if (engines.size() == maxEngines) std::vector<uint64_t>().swap(startSnapshot.words);
+  }
+  return true;
+}
+
+EngineContext *acquireEngine() {
+  PooledEngine *least = NULL;
+  for (size_t i = 0; i < engines.size(); ++i)
+    if (least == NULL || engines[i].sessions < least->sessions) least = &engines[i];
+  if (least == NULL) return NULL;
+  // Every context is in use: add one while the pool may grow.
+  if (least->sessions > 0 && engines.size() < maxEngines && createEngine() != NULL)
+    least = &engines.back();
+  if (least->sessions > 0)
+    std::cout << "Engine contexts: all in use, sharing one between " << least->sessions + 1
+              << " sessions" << std::endl;
+  ++least->sessions;
+  return least->engine;
+}
+
+void releaseEngine(EngineContext *engine) {
+  PooledEngine *pooled = findEngine(engine);
+  if (pooled != NULL) --pooled->sessions;
+}
+
+bool claimEngine(EngineContext *engine, psd_debug *psd) {
+  PooledEngine *pooled = findEngine(engine);
+  if (pooled->holder != NULL && pooled->holder != psd) return false;
+  pooled->holder = psd;
+  return true;
+}
+
+void unclaimEngine(EngineContext *engine) { findEngine(engine)->holder = NULL; }
+
+psd_debug *engineHolder(EngineContext *engine) { return findEngine(engine)->holder; }
+
+bool saveEngineSnapshot(const char *path) {
+  std::vector<const EngineContext *> contexts;
+  for (size_t i = 0; i < engines.size(); ++i) contexts.push_back(engines[i].engine);
+  return Minimax::saveTTSnapshot(contexts, path);
+}
+
+void destroyEnginePool() {
+  for (size_t i = 0; i < engines.size(); ++i) delete engines[i].engine;
+  engines.clear();
+}
@@ -195,3 +195,23 @@ ParseResult parseEvaluateRequest(const rapidjson::Document& doc, Board*& pBoard,
 
   return PARSE_OK;
 }
+
+int parseSearchThreads(const rapidjson::Document& doc, int maxThreads) {
+  if (!doc.HasMember("threads") || !doc["threads"].IsInt()) return maxThreads;
+  int threads = doc["threads"].GetInt();
+  if (threads < 1) return 1;
+  return threads > maxThreads ? maxThreads : threads;
+}
+
+SearchLimits parseSearchLimits(const rapidjson::Document& doc, const SearchLimits& defaults) {
+  SearchLimits limits = defaults;
+  if (doc.HasMember("timeLimitMs") && doc["timeLimitMs"].IsInt() &&
+      doc["timeLimitMs"].GetInt() > 0) {
+    int ms = doc["timeLimitMs"].GetInt();
+    limits = SearchLimits::fromTime(ms > MAX_REQUEST_TIME_LIMIT_MS ? MAX_REQUEST_TIME_LIMIT_MS : ms);
+    limits.nodes = defaults.nodes;
+  }
+  if (doc.HasMember("nodeLimit") && doc["nodeLimit"].IsInt64() && doc["nodeLimit"].GetInt64() > 0)
+    limits.nodes = (unsigned long long)doc["nodeLimit"].GetInt64();
+  return limits;
+}
@@ -1,29 +1,54 @@
 #include "request_handlers.hpp"
 
-#include <ctime>
 #include <iostream>
 
 #include "Evaluation.hpp"
 #include "Minimax.hpp"
+#include "OpeningBook.hpp"
 #include "Rules.hpp"
 #include "json_parser.hpp"
 #include "response_builder.hpp"
 
 namespace {
 
-std::pair<int, int> selectBestMove(Board* board, int last_x, int last_y,
-                                   const std::string& difficulty) {
+int searchThreads = 1;
+int ponderTimeMs = PONDER_DEFAULT_MS;
+
+// Limits a request puts on the search; medium and hard keep their own time budgets
+// unless the request overrides them.
+SearchLimits requestLimits(const rapidjson::Document& doc, const std::string& difficulty) {
+  if (difficulty == "hard") return parseSearchLimits(doc, SearchLimits::fromTime(HARD_TIME_LIMIT_MS));
+  if (difficulty == "medium")
+    return parseSearchLimits(doc, SearchLimits::fromTime(MEDIUM_TIME_LIMIT_MS));
+  return parseSearchLimits(doc, SearchLimits());
+}
+
+EvalFn searchEvaluator(const std::string& difficulty) {
+  return difficulty == "hard" ? &Evaluation::evaluatePositionHard : &Evaluation::evaluatePosition;
+}
+
+std::pair<int, int> selectBestMove(EngineContext& engine, Board* board, int last_x, int last_y,
+                                   const std::string& difficulty, int threads,
+                                   const SearchLimits& limits) {
   if (last_x == -1 && last_y == -1) {
     std::cout << board->getLastPlayer() << " " << board->getNextPlayer() << std::endl;
     std::cout << "no lastplay" << std::endl;
     return std::make_pair(BOARD_SIZE / 2, BOARD_SIZE / 2);
   }
 
-  if (difficulty == "hard")
-    return Minimax::getBestMovePVS(board, MAX_DEPTH, &Evaluation::evaluatePositionHard);
-  if (difficulty == "medium")
-    return Minimax::iterativeDeepening(board, MAX_DEPTH, 0.4, &Evaluation::evaluatePosition);
-  if (difficulty == "easy") return Minimax::getBestMove(board, 5, &Evaluation::evaluatePosition);
+  // The book is built from hard searches; easy keeps its shallow search.
+  std::pair<int, int> bookMove;
+  if ((difficulty == "hard" || difficulty == "medium") && OpeningBook::lookup(*board, bookMove)) {
+    std::cout << "Opening book move: (" << bookMove.first << "," << bookMove.second << ")"
+              << std::endl;
+    return bookMove;
+  }
+
+  if (difficulty == "hard" || difficulty == "medium")
+    return Minimax::iterativeDeepening(engine, board, MAX_DEPTH, limits,
+                                       searchEvaluator(difficulty), threads);
+  if (difficulty == "easy")
+    return Minimax::getBestMove(engine, board, 5, &Evaluation::evaluatePosition, threads, limits);
 
   return std::make_pair(-1, -1);
 }
@@ -35,13 +60,77 @@ void applyMoveAndCapture(Board* board, int x, int y) {
   }
 }
 
-double computeExecutionTimeSeconds(std::clock_t start, std::clock_t end) {
-  return static_cast<double>(end - start) / CLOCKS_PER_SEC;
+// The position to ponder after the AI plays `move` on `board`: that move followed
+// by the reply the search expects. NULL when it expects none, or when the opening
+// book answers that position anyway.
+PonderSearch* predictPonderPosition(const EngineContext& engine, const Board* board,
+                                    const std::pair<int, int>& move,
+                                    const std::string& difficulty, int threads,
+                                    const SearchLimits& limits) {
+  // Played like the search plays its moves, so the keys match its TT entries.
+  Board* next = new Board(*board);
+  next->makeMove(move.first, move.second);
+  std::pair<int, int> reply;
+  if (!Minimax::predictReply(engine, next, reply)) {
+    delete next;
+    return NULL;
+  }
+  next->flushCaptures();
+  next->makeMove(reply.first, reply.second);
+  next->flushCaptures();
+  std::pair<int, int> bookMove;
+  if (OpeningBook::lookup(*next, bookMove)) {
+    delete next;
+    return NULL;
+  }
+  SearchLimits requestLimits = limits;
+  requestLimits.cancel = NULL;
+  return new PonderSearch(next, reply, difficulty, threads, requestLimits);
+}
+
+// Monotonic seconds; std::clock() would add up the CPU time of every search thread.
+double monotonicSeconds() { return TimeManager::nowMs() / 1000.0; }
+
+double computeExecutionTimeSeconds(double start, double end) { return end - start; }
+
+// EngineContext::progress of a connection's searches: streams each completed
+// iteration to the client, unless the search has been cancelled. A ponder search
+// streams nothing before its request arrives.
+void postSearchProgress(const SearchProgress& progress, void* arg) {
+  RequestJob* job = static_cast<RequestJob*>(arg);
+  bool quiet = job->type == "ponder"
+                   ? !loadFlag(&job->ponder->hit) || loadFlag(&job->ponder->stop)
+                   : loadFlag(&job->psd->cancelSearch);
+  if (quiet) return;
+  postWorkerMessage(job->psd, constructProgressResponse(progress));
+}
+
+void runPonderSearch(RequestJob& job) {
+  PonderSearch& ponder = *job.ponder;
+  SearchLimits limits = ponder.limits;
+  limits.cancel = &ponder.stop;
+  limits.ponderHit = &ponder.hit;
+  limits.ponderMs = ponderTimeMs;
+  // The connection compares requests with ponder.board while this runs.
+  Board board(*ponder.board);
+  std::cout << "Pondering on (" << ponder.reply.first << ", " << ponder.reply.second << ")"
+            << std::endl;
+  ponder.move = Minimax::iterativeDeepening(*job.psd->engine, &board, MAX_DEPTH, limits,
+                                            searchEvaluator(ponder.difficulty), ponder.threads);
 }
 
 }  // namespace
 
-int handleMoveRequest(struct lws* wsi, const rapidjson::Document& doc, psd_debug* psd) {
+void setSearchThreads(int threads) {
+  if (threads < 1) threads = 1;
+  if (threads > MAX_SEARCH_THREADS) threads = MAX_SEARCH_THREADS;
+  searchThreads = threads;
+}
+
+void setPonderTime(int ms) { ponderTimeMs = ms < 0 ? 0 : ms; }
+
+int handleMoveRequest(const rapidjson::Document& doc, psd_debug* psd, std::string& reply,
+                      PonderSearch*& ponder) {
   Board* pBoard = NULL;
   std::string error;
   int last_x;
@@ -52,8 +141,8 @@ int handleMoveRequest(struct lws* wsi, const rapidjson::Document& doc, psd_debug
   ParseResult result = parseMoveRequest(doc, pBoard, error, &last_x, &last_y, difficulty);
 
   if (result != PARSE_OK) {
-    std::cout << constructErrorResponse(result, error) << std::endl;
-    sendErrorResponse(wsi, result, error);
+    reply = constructErrorResponse(result, error);
+    std::cout << reply << std::endl;
     return -1;
   }
 
@@ -63,23 +152,29 @@ int handleMoveRequest(struct lws* wsi, const rapidjson::Document& doc, psd_debug
     else {
       std::cout << "difficulty changed from" << psd->difficulty << " to " << difficulty
                 << std::endl;
-
-      transTable.clear();
     }
     psd->difficulty = difficulty;
   }
 
-  std::clock_t start = std::clock();
-  predict = selectBestMove(pBoard, last_x, last_y, difficulty);
+  SearchLimits limits = requestLimits(doc, difficulty);
+  limits.cancel = &psd->cancelSearch;
+  int threads = parseSearchThreads(doc, searchThreads);
+  double start = monotonicSeconds();
+  predict = selectBestMove(*psd->engine, pBoard, last_x, last_y, difficulty, threads, limits);
+  if (loadFlag(&psd->cancelSearch)) {
+    delete pBoard;
+    return 0;  // replaced by a `cancelled` reply
+  }
   if (predict.first == -1 && predict.second == -1) {
-    std::string error_response = constructErrorResponse(ERROR_GAME_DIFFICULTY, "");
-    std::cout << error_response << std::endl;
-    sendJsonResponse(wsi, error_response);
+    reply = constructErrorResponse(ERROR_GAME_DIFFICULTY, "");
+    std::cout << reply << std::endl;
     return -1;
   }
 
   char ai_stone = pBoard->getNextPlayer() == 1 ? 'X' : 'O';
-  std::clock_t end = std::clock();
+  double end = monotonicSeconds();
+  if (ponderTimeMs > 0 && (difficulty == "hard" || difficulty == "medium"))
+    ponder = predictPonderPosition(*psd->engine, pBoard, predict, difficulty, threads, limits);
   applyMoveAndCapture(pBoard, predict.first, predict.second);
   std::cout << "AI played: (" << predict.first << ", " << predict.second << ") by " << ai_stone
             << std::endl;
@@ -91,12 +186,52 @@ int handleMoveRequest(struct lws* wsi, const rapidjson::Document& doc, psd_debug
   std::cout << "Execution time: " << executionTime << " s, " << elapsed_ms << " ms, " << elapsed_ns
             << " ns" << std::endl;
 
-  responseSuccessMove(wsi, *pBoard, predict.first, predict.second, executionTime);
+  reply = constructMoveResponse(*pBoard, predict.first, predict.second, executionTime);
   delete pBoard;
   return 0;
 }
 
-int handleEvaluateRequest(struct lws* wsi, const rapidjson::Document& doc) {
+bool ponderMatches(const PonderSearch& ponder, const rapidjson::Document& doc) {
+  Board* pBoard = NULL;
+  std::string error;
+  int last_x;
+  int last_y;
+  std::string difficulty;
+  if (parseMoveRequest(doc, pBoard, error, &last_x, &last_y, difficulty) != PARSE_OK) {
+    delete pBoard;
+    return false;
+  }
+  // The hash covers the stones, the captures and the side to move.
+  const Board& predicted = *ponder.board;
+  SearchLimits limits = requestLimits(doc, difficulty);
+  bool match = std::make_pair(last_x, last_y) == ponder.reply &&
+               difficulty == ponder.difficulty && pBoard->getHash() == predicted.getHash() &&
+               pBoard->getGoal() == predicted.getGoal() &&
+               pBoard->getEnableCapture() == predicted.getEnableCapture() &&
+               pBoard->getEnableDoubleThreeRestriction() ==
+                   predicted.getEnableDoubleThreeRestriction() &&
+               parseSearchThreads(doc, searchThreads) == ponder.threads &&
+               limits.hardMs == ponder.limits.hardMs && limits.softMs == ponder.limits.softMs &&
+               limits.nodes == ponder.limits.nodes;
+  delete pBoard;
+  return match;
+}
+
+bool handlePonderHit(const PonderSearch& ponder, std::string& reply) {
+  if (ponder.move.first == -1 && ponder.move.second == -1) return false;
+  Board board(*ponder.board);
+  char ai_stone = board.getNextPlayer() == 1 ? 'X' : 'O';
+  applyMoveAndCapture(&board, ponder.move.first, ponder.move.second);
+  std::cout << "AI played: (" << ponder.move.first << ", " << ponder.move.second << ") by "
+            << ai_stone << " (ponder hit)" << std::endl;
+  // What the client waited: the search ran before the request arrived.
+  double executionTime = computeExecutionTimeSeconds(ponder.hitMs / 1000.0, monotonicSeconds());
+  std::cout << "Execution time: " << executionTime << " s" << std::endl;
+  reply = constructMoveResponse(board, ponder.move.first, ponder.move.second, executionTime);
+  return true;
+}
+
+int handleEvaluateRequest(const rapidjson::Document& doc, std::string& reply) {
   Board* pBoard = NULL;
   std::string error;
   int eval_x;
@@ -104,8 +239,8 @@ int handleEvaluateRequest(struct lws* wsi, const rapidjson::Document& doc) {
   ParseResult result = parseEvaluateRequest(doc, pBoard, error, &eval_x, &eval_y);
 
   if (result != PARSE_OK) {
-    std::cout << constructErrorResponse(result, error) << std::endl;
-    sendErrorResponse(wsi, result, error);
+    reply = constructErrorResponse(result, error);
+    std::cout << reply << std::endl;
     return -1;
   }
 
@@ -116,15 +251,14 @@ int handleEvaluateRequest(struct lws* wsi, const rapidjson::Document& doc) {
   int o_percentage = Evaluation::getEvaluationPercentage(o_scores);
   std::cout << "x_scores: " << x_scores << " y_scores: " << o_scores << std::endl;
   std::cout << "x_percentage: " << x_percentage << " y_percentage: " << o_percentage << std::endl;
-  responseSuccessEvaluate(wsi, x_scores, o_scores);
+  reply = constructEvaluateResponse(x_scores, o_scores);
 
   delete pBoard;
   return 0;
 }
 
-int handleTestRequest(struct lws* wsi, const rapidjson::Document& doc) {
-  initZobrist();
-  transTable.clear();
+int handleTestRequest(const rapidjson::Document& doc, psd_debug* psd, std::string& reply) {
+  psd->engine->transTable.clear();
 
   Board* pBoard = NULL;
   std::string error;
@@ -134,15 +268,23 @@ int handleTestRequest(struct lws* wsi, const rapidjson::Document& doc) {
   ParseResult result = parseMoveRequest(doc, pBoard, error, &last_x, &last_y, difficulty);
 
   if (result != PARSE_OK) {
-    std::cout << constructErrorResponse(result, error) << std::endl;
-    sendErrorResponse(wsi, result, error);
+    reply = constructErrorResponse(result, error);
+    std::cout << reply << std::endl;
     return -1;
   }
 
-  std::clock_t start = std::clock();
+  SearchLimits limits = requestLimits(doc, "hard");
+  limits.cancel = &psd->cancelSearch;
+  double start = monotonicSeconds();
   std::pair<int, int> a =
-      Minimax::getBestMovePVS(pBoard, MAX_DEPTH, &Evaluation::evaluatePositionHard);
-  std::clock_t end = std::clock();
+      Minimax::iterativeDeepening(*psd->engine, pBoard, MAX_DEPTH, limits,
+                                  &Evaluation::evaluatePositionHard,
+                                  parseSearchThreads(doc, searchThreads));
+  double end = monotonicSeconds();
+  if (loadFlag(&psd->cancelSearch)) {
+    delete pBoard;
+    return 0;  // replaced by a `cancelled` reply
+  }
 
   char ai_stone = pBoard->getNextPlayer() == 1 ? 'X' : 'O';
   applyMoveAndCapture(pBoard, a.first, a.second);
@@ -155,13 +297,59 @@ int handleTestRequest(struct lws* wsi, const rapidjson::Document& doc) {
   std::cout << "Execution time: " << executionTime << " s, " << elapsed_ms << " ms, " << elapsed_ns
             << " ns" << std::endl;
 
-  responseSuccessMove(wsi, *pBoard, a.first, a.second, executionTime);
+  reply = constructMoveResponse(*pBoard, a.first, a.second, executionTime);
   delete pBoard;
   return 0;
 }
 
 void handleResetRequest(psd_debug* psd) {
   psd->difficulty = "";
-  initZobrist();
-  transTable.clear();
+}
+
+void handleWorkerRequest(RequestJob& job) {
+  const std::string& type = job.type;
+  // Evaluations leave the engine context alone; they may run beside a ponder search.
+  EngineContext* engine = type == "evaluate" ? NULL : job.psd->engine;
+  if (engine != NULL) {
+    engine->progress = &postSearchProgress;
+    engine->progressArg = &job;
+  }
+  int status;
+  try {
+    if (type == "ponder") {
+      runPonderSearch(job);
+      status = 0;
+    } else if (type == "move") {
+      status = handleMoveRequest(job.doc, job.psd, job.reply, job.ponder);
+    } else if (type == "evaluate") {
+      status = handleEvaluateRequest(job.doc, job.reply);
+    } else {
+      status = handleTestRequest(job.doc, job.psd, job.reply);
+    }
+  } catch (const std::exception& ex) {
+    // Nothing above the worker would catch it; fail this connection only.
+    std::cerr << "Request failed: " << ex.what() << std::endl;
+    job.reply = constructErrorResponse(ERROR_UNKNOWN, ex.what());
+    status = -1;
+  }
+  if (engine != NULL) {
+    engine->progress = NULL;
+    engine->progressArg = NULL;
+  }
+  if (type == "ponder") {
+    if (status != 0) storeFlag(&job.ponder->stop, true);  // no result to keep
+    job.reply.clear();
+    return;
+  }
+  job.close = status != 0;
+  bool cancelled = loadFlag(&job.psd->cancelSearch);
+  if (cancelled) {
+    job.reply = constructCancelledResponse(type);
+    job.close = false;
+  }
+  // Nobody waits for the position after a move that failed or was not sent.
+  if (job.close || cancelled) {
+    delete job.ponder;
+    job.ponder = NULL;
+  }
 }
@@ -0,0 +1,156 @@
+#include "request_workers.hpp"
+
+#include <pthread.h>
+
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+
+#include "Board.hpp"
+#include "request_handlers.hpp"
+
+namespace {
+
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t jobQueued = PTHREAD_COND_INITIALIZER;
+struct lws_context *serviceContext = NULL;
+std::vector<pthread_t> threads;
+std::deque<RequestJob *> queued;
+std::vector<RequestJob *> finished;
+std::vector<WorkerMessage> messages;
+std::vector<RequestJob *> ponderJobs;  // "ponder" jobs queued or running
+int running = 0;  // jobs taken by a worker and not yet finished
+bool stopping = false;
+
+void forgetPonderJob(RequestJob *job) {
+  for (size_t i = 0; i < ponderJobs.size(); ++i) {
+    if (ponderJobs[i] == job) {
+      ponderJobs.erase(ponderJobs.begin() + i);
+      return;
+    }
+  }
+}
+
+void *workerMain(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&mutex);
+  for (;;) {
+    while (queued.empty() && !stopping) pthread_cond_wait(&jobQueued, &mutex);
+    if (stopping) break;
+    RequestJob *job = queued.front();
+    queued.pop_front();
+    ++running;
+    pthread_mutex_unlock(&mutex);
+
+    handleWorkerRequest(*job);
+
+    pthread_mutex_lock(&mutex);
+    --running;
+    if (job->type == "ponder") forgetPonderJob(job);
+    finished.push_back(job);
+    lws_cancel_service(serviceContext);
+  }
+  pthread_mutex_unlock(&mutex);
+  return NULL;
+}
+
+}  // namespace
+
+PonderSearch::PonderSearch(Board *position, const std::pair<int, int> &predicted,
+                           const std::string &level, int searchThreads,
+                           const SearchLimits &requestLimits)
+    : board(position),
+      reply(predicted),
+      difficulty(level),
+      threads(searchThreads),
+      limits(requestLimits),
+      move(-1, -1),
+      hit(false),
+      stop(false),
+      hitMs(0.0) {}
+
+PonderSearch::~PonderSearch() { delete board; }
+
+void startRequestWorkers(struct lws_context *context, int workers) {
+  serviceContext = context;
+  stopping = false;
+  for (int i = 0; i < workers; ++i) {
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, workerMain, NULL) != 0) {
+      std::cerr << "Request workers: failed to start worker " << i << std::endl;
+      break;
+    }
+    threads.push_back(tid);
+  }
+  if (threads.empty()) throw std::runtime_error("Request workers: no worker thread started");
+  std::cout << "Request workers: " << threads.size() << std::endl;
+}
+
+void stopRequestWorkers() {
+  pthread_mutex_lock(&mutex);
+  stopping = true;
+  for (size_t i = 0; i < ponderJobs.size(); ++i) storeFlag(&ponderJobs[i]->ponder->stop, true);
+  ponderJobs.clear();
+  pthread_cond_broadcast(&jobQueued);
+  pthread_mutex_unlock(&mutex);
+  for (size_t i = 0; i < threads.size(); ++i) pthread_join(threads[i], NULL);
+  threads.clear();
+
+  pthread_mutex_lock(&mutex);
+  finished.insert(finished.end(), queued.begin(), queued.end());
+  queued.clear();
+  pthread_mutex_unlock(&mutex);
+}
+
+void submitRequest(RequestJob *job) {
+  pthread_mutex_lock(&mutex);
+  queued.push_back(job);
+  // Pondering only uses workers nobody else needs.
+  if (running + queued.size() > threads.size()) {
+    for (size_t i = 0; i < ponderJobs.size(); ++i) {
+      PonderSearch *ponder = ponderJobs[i]->ponder;
+      if (!loadFlag(&ponder->hit) && !loadFlag(&ponder->stop)) {
+        storeFlag(&ponder->stop, true);
+        break;
+      }
+    }
+  }
+  pthread_cond_signal(&jobQueued);
+  pthread_mutex_unlock(&mutex);
+}
+
+bool submitPonder(RequestJob *job) {
+  pthread_mutex_lock(&mutex);
+  bool idle = !stopping && running + queued.size() < threads.size();
+  if (idle) {
+    queued.push_back(job);
+    ponderJobs.push_back(job);
+    pthread_cond_signal(&jobQueued);
+  }
+  pthread_mutex_unlock(&mutex);
+  return idle;
+}
+
+void postWorkerMessage(psd_debug *psd, const std::string &json) {
+  pthread_mutex_lock(&mutex);
+  messages.push_back(WorkerMessage(psd, json));
+  lws_cancel_service(serviceContext);
+  pthread_mutex_unlock(&mutex);
+}
+
+void takeWorkerResults(std::vector<WorkerMessage> &messagesOut,
+                       std::vector<RequestJob *> &finishedOut) {
+  pthread_mutex_lock(&mutex);
+  messagesOut.insert(messagesOut.end(), messages.begin(), messages.end());
+  messages.clear();
+  finishedOut.insert(finishedOut.end(), finished.begin(), finished.end());
+  finished.clear();
+  pthread_mutex_unlock(&mutex);
+}
+
+bool requestWorkersIdle() {
+  pthread_mutex_lock(&mutex);
+  bool idle = queued.empty() && running == 0;
+  pthread_mutex_unlock(&mutex);
+  return idle;
+}
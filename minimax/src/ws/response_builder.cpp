@@ -8,8 +8,7 @@
 
 #include "Evaluation.hpp"
 
-void responseSuccessMove(struct lws* wsi, Board& board, int aiPlayX, int aiPlayY,
-                         double executionTime) {
+std::string constructMoveResponse(Board& board, int aiPlayX, int aiPlayY, double executionTime) {
   rapidjson::Document response;
   response.SetObject();
   rapidjson::Document::AllocatorType& allocator = response.GetAllocator();
@@ -31,7 +30,7 @@ void responseSuccessMove(struct lws* wsi, Board& board, int aiPlayX, int aiPlayY
   }
   response.AddMember("lastPlay", lastPlay, allocator);
 
-  const std::vector<CapturedStone>& captured = board.getCapturedStones();
+  const CaptureList& captured = board.getCapturedStones();
   rapidjson::Value capturedStones(rapidjson::kArrayType);
   for (size_t i = 0; i < captured.size(); ++i) {
     rapidjson::Value capturedObj(rapidjson::kObjectType);
@@ -55,11 +54,10 @@ void responseSuccessMove(struct lws* wsi, Board& board, int aiPlayX, int aiPlayY
   rapidjson::StringBuffer buffer;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
   response.Accept(writer);
-  std::string json_response = buffer.GetString();
-  sendJsonResponse(wsi, json_response);
+  return buffer.GetString();
 }
 
-void responseSuccessEvaluate(struct lws* wsi, int evalScoreX, int evalScoreY) {
+std::string constructEvaluateResponse(int evalScoreX, int evalScoreY) {
   rapidjson::Document response;
   response.SetObject();
   rapidjson::Document::AllocatorType& allocator = response.GetAllocator();
@@ -84,8 +82,36 @@ void responseSuccessEvaluate(struct lws* wsi, int evalScoreX, int evalScoreY) {
   rapidjson::StringBuffer buffer;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
   response.Accept(writer);
-  std::string json_response = buffer.GetString();
-  sendJsonResponse(wsi, json_response);
+  return buffer.GetString();
+}
+
+std::string constructProgressResponse(const SearchProgress& progress) {
+  rapidjson::Document response;
+  response.SetObject();
+  rapidjson::Document::AllocatorType& allocator = response.GetAllocator();
+
+  response.AddMember("type", "progress", allocator);
+  response.AddMember("depth", progress.depth, allocator);
+
+  rapidjson::Value bestMove(rapidjson::kObjectType);
+  bestMove.AddMember("x", progress.bestMove.first, allocator);
+  bestMove.AddMember("y", progress.bestMove.second, allocator);
+  response.AddMember("bestMove", bestMove, allocator);
+
+  response.AddMember("score", progress.score, allocator);
+  response.AddMember("nodes", static_cast<uint64_t>(progress.nodes), allocator);
+  double nps = progress.elapsedMs > 0.0 ? progress.nodes * 1000.0 / progress.elapsedMs : 0.0;
+  response.AddMember("nps", nps, allocator);
+  response.AddMember("elapsedMs", progress.elapsedMs, allocator);
+
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  response.Accept(writer);
+  return buffer.GetString();
+}
+
+std::string constructCancelledResponse(const std::string& requestType) {
+  return "{\"type\":\"cancelled\",\"request\":\"" + requestType + "\"}";
 }
 
 std::string constructErrorResponse(ParseResult result, const std::string& details) {
@@ -114,8 +140,3 @@ std::string constructErrorResponse(ParseResult result, const std::string& detail
   oss << "\"}";
   return oss.str();
 }
-
-void sendErrorResponse(struct lws* wsi, ParseResult result, const std::string& details) {
-  std::string error_response = constructErrorResponse(result, details);
-  sendJsonResponse(wsi, error_response);
-}
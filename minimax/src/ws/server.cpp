@@ -1,5 +1,9 @@
 #include "server.hpp"
 
+#include "engine_pool.hpp"
+#include "request_handlers.hpp"
+#include "request_workers.hpp"
+
 // Include headers for port checking
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -30,12 +34,12 @@ static bool isPortAvailable(int port) {
 // ─── protocol table ────────────────────────────────────────────────
 static struct lws_protocols protocols[] = {
     {"debug-protocol", callbackWebsocket,
-     sizeof(psd_debug),  // ← allocate this many bytes per connection
-     0,                  // rx buffer size (unused)
+     sizeof(psd_debug *),  // ← per connection: a pointer to its heap state
+     0,                    // rx buffer size (unused)
      0, NULL, 0},
     {NULL, NULL, 0, 0, 0, NULL, 0}};
 
-Server::Server(int port) {
+Server::Server(int port, int searchThreads, int workers) : ttSnapshotSeconds(0) {
   // Check if the port is available before proceeding.
   if (!isPortAvailable(port)) {
     std::ostringstream oss;
@@ -70,17 +74,42 @@ Server::Server(int port) {
     throw std::runtime_error("Libwebsockets context creation failed!");
   }
 
-  // Initialize evaluation tables.
-  Evaluation::initCombinedPatternScoreTables();
-  Evaluation::initCombinedPatternScoreTablesHard();
+  // Zobrist keys are seeded once per process so TT entries stay valid across
+  // games, and a released engine context can serve the next connection.
+  initZobrist();
+
+  // Evaluation tables: map the prebuilt file when one is configured, else generate.
+  Evaluation::initPatternTables(std::getenv("MINIMAX_PATTERN_TABLES"));
+  OpeningBook::initBook(std::getenv("MINIMAX_OPENING_BOOK"));
+
+  setSearchThreads(searchThreads);
+  std::cout << "Search threads: " << searchThreads << std::endl;
+  startRequestWorkers(context, workers);
 
   std::cout << "WebSocket Server running on ws://localhost:" << port << "/ws" << std::endl;
 }
 
+void Server::setTTSnapshot(const std::string& path, int seconds) {
+  ttSnapshotPath = path;
+  ttSnapshotSeconds = seconds;
+}
+
 void Server::run(volatile std::sig_atomic_t& stopFlag) {
+  double lastSnapshot = TimeManager::nowMs();
   while (!stopFlag) {
     lws_service(context, 100);
+    // Workers take jobs only from this thread, so once they are idle no search
+    // can start while the snapshot is written.
+    double now = TimeManager::nowMs();
+    if (ttSnapshotSeconds > 0 && now - lastSnapshot >= ttSnapshotSeconds * 1000.0 &&
+        requestWorkersIdle()) {
+      saveEngineSnapshot(ttSnapshotPath.c_str());
+      lastSnapshot = now;
+    }
   }
+  // Finish the running searches and hand their connections back before closing them.
+  stopRequestWorkers();
+  completeWorkerRequests();
   lws_context_destroy(context);
   std::cout << "Server shut down gracefully." << std::endl;
 }
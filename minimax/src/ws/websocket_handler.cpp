@@ -1,15 +1,261 @@
 #include "websocket_handler.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
+#include "engine_pool.hpp"
 #include "json_parser.hpp"
 #include "Minimax.hpp"
 #include "request_handlers.hpp"
 #include "response_builder.hpp"
 
+namespace {
+
+// Connections whose next search waits for an engine context that another
+// session sharing it is searching on (see engine_pool.hpp).
+std::vector<psd_debug *> engineWaiters;
+
+bool isSearchRequest(const std::string &type) { return type == "move" || type == "test"; }
+
+// Claims the connection's engine context for a search. While another session
+// holds it, the connection waits in `engineWaiters`; a ponder search holding it
+// is stopped, since a request now needs the context.
+bool claimSessionEngine(psd_debug *psd) {
+  if (claimEngine(psd->engine, psd)) return true;
+  psd_debug *holder = engineHolder(psd->engine);
+  if (holder->pondering && !loadFlag(&holder->ponder->hit))
+    storeFlag(&holder->ponder->stop, true);
+  if (std::find(engineWaiters.begin(), engineWaiters.end(), psd) == engineWaiters.end())
+    engineWaiters.push_back(psd);
+  return false;
+}
+
+void dropRequests(psd_debug *psd) {
+  for (size_t i = 0; i < psd->requests.size(); ++i) delete psd->requests[i];
+  psd->requests.clear();
+}
+
+void destroySession(psd_debug *psd) {
+  engineWaiters.erase(std::remove(engineWaiters.begin(), engineWaiters.end(), psd),
+                      engineWaiters.end());
+  dropRequests(psd);
+  delete psd->ponder;
+  releaseEngine(psd->engine);
+  delete psd;
+}
+
+// A finished ponder search is dropped now, a running one once its worker is done.
+void dropPonder(psd_debug *psd) {
+  if (psd->pondering) {
+    storeFlag(&psd->ponder->stop, true);
+  } else {
+    delete psd->ponder;
+    psd->ponder = NULL;
+  }
+}
+
+// Searches the position `ponder` predicts on an idle worker, unless the next
+// request is already here.
+void startPondering(psd_debug *psd, PonderSearch *ponder) {
+  if (!psd->requests.empty() || psd->ponder != NULL || !claimEngine(psd->engine, psd)) {
+    delete ponder;
+    return;
+  }
+  RequestJob *job = new RequestJob(psd);
+  job->type = "ponder";
+  job->ponder = ponder;
+  psd->ponder = ponder;
+  psd->pondering = submitPonder(job);
+  if (!psd->pondering) {
+    unclaimEngine(psd->engine);
+    delete job;
+    dropPonder(psd);
+  }
+}
+
+void queueReply(psd_debug *psd, const std::string &json, bool close) {
+  if (json.empty() && !close) return;
+  psd->replies.push_back(PendingReply(json, close));
+  // Nothing after a failed request is answered.
+  if (close) dropRequests(psd);
+}
+
+RequestJob *parseRequest(psd_debug *psd, const std::string &message) {
+  RequestJob *job = new RequestJob(psd);
+  if (job->doc.Parse(message.c_str()).HasParseError())
+    job->error = "JSON Parse Error";
+  else if (!job->doc.HasMember("type") || !job->doc["type"].IsString())
+    job->error = "Invalid 'type' field";
+  else
+    job->type = job->doc["type"].GetString();
+  return job;
+}
+
+// Stops the running search and marks the queued ones; each still gets a
+// `cancelled` reply in its place.
+void cancelSearches(psd_debug *psd) {
+  if (psd->running != NULL && isSearchRequest(psd->running->type)) {
+    storeFlag(&psd->cancelSearch, true);
+    // The ponder search answers `running`.
+    if (psd->pondering && loadFlag(&psd->ponder->hit)) storeFlag(&psd->ponder->stop, true);
+  }
+  for (size_t i = 0; i < psd->requests.size(); ++i)
+    if (isSearchRequest(psd->requests[i]->type)) psd->requests[i]->cancelled = true;
+}
+
+// Hands the search request at the front of the queue to the ponder search when
+// it is the predicted one. Returns false while the request has to wait: for the
+// ponder search it now belongs to, or for a mispredicted one to stop.
+bool takePonder(psd_debug *psd) {
+  RequestJob *job = psd->requests.front();
+  PonderSearch *ponder = psd->ponder;
+  bool hit = !loadFlag(&ponder->stop) && job->type == "move" && ponderMatches(*ponder, job->doc);
+  if (hit) ponder->hitMs = TimeManager::nowMs();
+  if (psd->pondering) {
+    if (!hit) {
+      storeFlag(&ponder->stop, true);
+      return false;
+    }
+    // The running search becomes this request's; it answers when its worker is done.
+    psd->requests.pop_front();
+    psd->running = job;
+    storeFlag(&psd->cancelSearch, false);
+    // Released last: the worker sees the fields above once it sees the hit.
+    storeFlag(&ponder->hit, true);
+    return false;
+  }
+  std::string reply;
+  if (hit && handlePonderHit(*ponder, reply)) {
+    psd->requests.pop_front();
+    queueReply(psd, reply, false);
+    delete job;
+  }
+  dropPonder(psd);
+  return true;
+}
+
+// Handles the connection's queued requests in order until one goes to a worker.
+// Searches and evaluations run there; the rest is answered right away.
+void dispatchRequests(psd_debug *psd) {
+  while (psd->running == NULL && !psd->requests.empty()) {
+    RequestJob *job = psd->requests.front();
+    if (psd->ponder != NULL && job->error.empty() && !job->cancelled &&
+        isSearchRequest(job->type)) {
+      if (!takePonder(psd)) break;
+      continue;
+    }
+    if (job->error.empty() && !job->cancelled && isSearchRequest(job->type) &&
+        !claimSessionEngine(psd))
+      break;
+    psd->requests.pop_front();
+    if (!job->error.empty()) {
+      queueReply(psd, constructErrorResponse(ERROR_UNKNOWN, job->error), true);
+    } else if (job->cancelled) {
+      queueReply(psd, constructCancelledResponse(job->type), false);
+    } else if (isSearchRequest(job->type) || job->type == "evaluate") {
+      psd->running = job;
+      storeFlag(&psd->cancelSearch, false);
+      submitRequest(job);
+      break;
+    } else if (job->type == "ping") {
+      queueReply(psd, "{\"type\":\"pong\"}", false);
+    } else if (job->type == "reset") {
+      handleResetRequest(psd);
+      if (psd->ponder != NULL) dropPonder(psd);
+    } else {
+      queueReply(psd, constructErrorResponse(ERROR_UNKNOWN, "Unknown type"), true);
+    }
+    delete job;
+  }
+  if (!psd->replies.empty()) lws_callback_on_writable(psd->wsi);
+}
+
+// A search on `engine` has ended: hands the context to the connections waiting
+// for it, in turn, until one of them starts a search.
+void releaseSessionEngine(EngineContext *engine) {
+  unclaimEngine(engine);
+  for (size_t i = 0; i < engineWaiters.size() && engineHolder(engine) == NULL;) {
+    psd_debug *psd = engineWaiters[i];
+    if (psd->engine != engine) {
+      ++i;
+      continue;
+    }
+    engineWaiters.erase(engineWaiters.begin() + i);
+    dispatchRequests(psd);
+  }
+}
+
+// A ponder job is back from its worker. Answers the request it was converted for,
+// or keeps its result for the predicted request unless it was stopped.
+void completePonder(psd_debug *psd) {
+  PonderSearch *ponder = psd->ponder;
+  RequestJob *request = NULL;
+  psd->pondering = false;
+  releaseSessionEngine(psd->engine);
+  bool hit = loadFlag(&ponder->hit);
+  if (hit) {
+    request = psd->running;
+    psd->running = NULL;
+  }
+  if (psd->wsi == NULL) {
+    delete request;
+    if (psd->running == NULL) destroySession(psd);
+    return;
+  }
+  if (request != NULL) {
+    std::string reply;
+    if (loadFlag(&psd->cancelSearch)) {
+      queueReply(psd, constructCancelledResponse(request->type), false);
+    } else if (handlePonderHit(*ponder, reply)) {
+      queueReply(psd, reply, false);
+    } else {
+      psd->requests.push_front(request);  // no move found: search it the usual way
+      request = NULL;
+    }
+    delete request;
+  }
+  if (hit || loadFlag(&ponder->stop)) dropPonder(psd);
+  dispatchRequests(psd);
+}
+
+}  // namespace
+
+void completeWorkerRequests() {
+  std::vector<WorkerMessage> messages;
+  std::vector<RequestJob *> finished;
+  takeWorkerResults(messages, finished);
+  // A job's messages come before the job, so their connection is still allocated.
+  for (size_t i = 0; i < messages.size(); ++i) {
+    psd_debug *psd = messages[i].psd;
+    if (psd->wsi == NULL) continue;
+    queueReply(psd, messages[i].json, false);
+    lws_callback_on_writable(psd->wsi);
+  }
+  for (size_t i = 0; i < finished.size(); ++i) {
+    RequestJob *job = finished[i];
+    psd_debug *psd = job->psd;
+    if (job->type == "ponder") {
+      completePonder(psd);
+    } else {
+      psd->running = NULL;
+      if (isSearchRequest(job->type)) releaseSessionEngine(psd->engine);
+      if (psd->wsi == NULL) {
+        delete job->ponder;
+        if (!psd->pondering) destroySession(psd);  // closed while its request was running
+      } else {
+        queueReply(psd, job->reply, job->close);
+        if (job->ponder != NULL) startPondering(psd, job->ponder);
+        dispatchRequests(psd);
+      }
+    }
+    delete job;
+  }
+}
+
 int callbackWebsocket(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in,
                       size_t len) {
-  psd_debug *psd = static_cast<psd_debug *>(user);  // <-- persistent!
+  psd_debug **session = static_cast<psd_debug **>(user);  // <-- persistent!
   switch (reason) {
     case LWS_CALLBACK_FILTER_PROTOCOL_CONNECTION: {
       // only taking uri of /ws and /ws/debug
@@ -23,54 +269,66 @@ int callbackWebsocket(struct lws *wsi, enum lws_callback_reasons reason, void *u
         std::cerr << "Rejected: invalid URI: " << uri << std::endl;
         return 1;  // Reject connection
       }
-
-      new (&psd->difficulty) std::string();  // placement-new
       break;
     }
 
     case LWS_CALLBACK_ESTABLISHED:
       std::cout << "WebSocket `/ws` connected!" << std::endl;
-      psd->difficulty.clear();  // starts empty for this client
-      initZobrist();
-      // testZobristHashingLogic();
-      transTable.clear();
+      // Allocated only once the handshake is done: LWS_CALLBACK_CLOSED, which
+      // frees it, is not raised for a connection that fails before this point.
+      // Zobrist keys outlive connections (see Server::Server); the engine context
+      // is this connection's until it closes, shared once every context is in use.
+      *session = new psd_debug(wsi, acquireEngine());
       break;
     case LWS_CALLBACK_RECEIVE: {
       std::string received_msg((char *)in, len);
       std::cout << "Received: " << received_msg << std::endl;
-
-      rapidjson::Document doc;
-      if (doc.Parse(received_msg.c_str()).HasParseError()) {
-        sendErrorResponse(wsi, ERROR_UNKNOWN, "JSON Parse Error");
-        return -1;
-      }
-
-      if (!doc.HasMember("type") || !doc["type"].IsString()) {
-        sendErrorResponse(wsi, ERROR_UNKNOWN, "Invalid 'type' field");
-        return -1;
+      psd_debug *psd = *session;
+      RequestJob *job = parseRequest(psd, received_msg);
+      if (job->type == "cancel") {
+        // Takes effect now rather than in turn; it has no reply of its own.
+        cancelSearches(psd);
+        dispatchRequests(psd);  // answers searches still waiting for the engine context
+        delete job;
+        break;
       }
+      // A new search supersedes the ones still running or queued.
+      if (isSearchRequest(job->type)) cancelSearches(psd);
+      psd->requests.push_back(job);
+      dispatchRequests(psd);
+      break;
+    }
 
-      std::string type = doc["type"].GetString();
-      if (type == "move") {
-        return handleMoveRequest(wsi, doc, psd);
-      } else if (type == "evaluate") {
-        return handleEvaluateRequest(wsi, doc);
-      } else if (type == "test") {
-        return handleTestRequest(wsi, doc);
-      } else if (type == "ping") {
-        sendJsonResponse(wsi, "{\"type\":\"pong\"}");
-        return 0;
-      } else if (type == "reset") {
-        handleResetRequest(psd);
-      } else {
-        sendErrorResponse(wsi, ERROR_UNKNOWN, "Unknown type");
-        return -1;
-      }
+    case LWS_CALLBACK_SERVER_WRITEABLE: {
+      // One write per callback, as libwebsockets expects; ask again for the rest.
+      psd_debug *psd = *session;
+      if (psd == NULL || psd->replies.empty()) break;
+      PendingReply reply = psd->replies.front();
+      psd->replies.pop_front();
+      sendJsonResponse(wsi, reply.json);
+      if (reply.close) return -1;
+      if (!psd->replies.empty()) lws_callback_on_writable(wsi);
       break;
     }
 
+    case LWS_CALLBACK_EVENT_WAIT_CANCELLED:
+      // Raised by lws_cancel_service: a worker posted progress or finished a request.
+      completeWorkerRequests();
+      break;
+
     case LWS_CALLBACK_CLOSED:
-      psd->difficulty.~basic_string();  // manual dtor
+      if (*session != NULL) {
+        psd_debug *psd = *session;
+        psd->wsi = NULL;
+        if (psd->running == NULL && !psd->pondering) {
+          destroySession(psd);
+        } else {
+          // Nobody is waiting for the results.
+          storeFlag(&psd->cancelSearch, true);
+          if (psd->pondering) storeFlag(&psd->ponder->stop, true);
+        }
+        *session = NULL;
+      }
       std::cout << "WebSocket connection closed." << std::endl;
       break;
 